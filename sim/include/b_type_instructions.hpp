@@ -35,25 +35,25 @@ class BTypeInstructionInterface : public InstructionInterface {
   void MemoryAccess() final;
   void WriteBack() final;
 
-  Register& Rs1() { return *Rs1_; }
-  Register& Rs2() { return *Rs2_; }
-  const Register& Rs1() const { return *Rs1_; }
-  const Register& Rs2() const { return *Rs2_; }
+  Register& Rs1() { return Rs1_; }
+  Register& Rs2() { return Rs2_; }
+  const Register& Rs1() const { return Rs1_; }
+  const Register& Rs2() const { return Rs2_; }
 
   bool WillBranch() { return branch_; }
 
   OpCode GetOpCode() const final { return OpCode::Bxx; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
   PcPtr pc_;
   mem_addr_t target_addr_;
   bool branch_;
-  RegPtr Rs1_;
-  RegPtr Rs2_;
+  Register Rs1_;
+  Register Rs2_;
   int imm_;
 };
 
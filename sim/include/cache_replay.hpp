@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <memory_trace.hpp>
+#include <sweep.hpp>
+
+// Replays a recorded MemoryTrace through instruction and data caches built
+// from each sweep configuration, without running a CPU. Caches are clocked
+// to the recorded cycle of every access, so hit and miss counts are exact for
+// the recorded access stream while latencies are those a CPU would see if it
+// issued the same stream at the same times.
+class CacheReplay {
+ public:
+  struct PortStats {
+    std::size_t accesses = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t latency = 0;  // sum of access latencies in cycles
+  };
+
+  struct Result {
+    Sweep::Config config;
+    PortStats instr;
+    PortStats data;
+    double seconds = 0.0;
+  };
+
+  CacheReplay(MemoryTracePtr trace, const Sweep::Ranges& ranges);
+
+  // Replays every configuration on num_threads threads (0 uses every
+  // hardware thread), streaming a CSV header and one row per run.
+  std::vector<Result> Run(std::size_t num_threads, std::ostream& csv_stream);
+
+  const std::vector<Sweep::Config>& Configurations() const { return configs_; }
+
+  // Replays a single configuration on the calling thread
+  static Result ReplayConfiguration(const MemoryTrace& trace,
+                                    const Sweep::Config& config);
+
+  static void WriteCsvHeader(std::ostream& csv_stream);
+  static void WriteCsvRow(const Result& result, std::ostream& csv_stream);
+
+ private:
+  MemoryTracePtr trace_;
+  std::vector<Sweep::Config> configs_;
+};
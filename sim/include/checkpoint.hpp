@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <cpu.hpp>
+#include <memory.hpp>
+
+// Saves and restores the full simulator state to a versioned binary file:
+// registers, PC, simulation mode, cycle and instruction counts, the contents
+// of every main memory and the lines, tags and replacement state of every
+// cache in front of them.
+//
+// The pipeline is drained before saving, so a checkpoint never holds
+// instructions in flight and restores into an empty pipeline.
+//
+// Only non-zero memory pages are stored. They sit page aligned in the file so
+// restoring maps the file and copies pages straight out of the mapping.
+//
+// Layout: FileHeader, then num_sections sections, each a SectionHeader
+// followed by size bytes of payload. Multi-byte fields use host byte order.
+class Checkpoint {
+ public:
+  static constexpr uint32_t kVersion{2};
+
+  static void Save(CPU& cpu, const std::string& path);
+
+  // The CPU must have been built with the same memory sizes and cache
+  // geometry as the one that was saved. Breakpoints are kept.
+  static void Restore(CPU& cpu, const std::string& path);
+
+ private:
+  enum SectionType : uint32_t {
+    Section_Cpu,
+    Section_Memory,  // id: 0 instruction, 1 data
+    Section_Cache,   // id: port * kMaxCacheLevels + level
+  };
+
+  struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t num_sections;
+  };
+
+  struct SectionHeader {
+    uint32_t type;
+    uint32_t id;
+    uint64_t size;
+  };
+
+  struct CpuState {
+    uint32_t mode;
+    uint32_t pc;
+    uint32_t regs[RegisterFile::NumCPURegisters];
+    uint64_t cycles;
+    uint64_t instructions;
+  };
+
+  // Followed by num_pages uint32_t page indices. Page data starts at the
+  // absolute file offset data_offset.
+  struct MemoryState {
+    uint64_t size;
+    uint64_t data_offset;
+    uint32_t page_size;
+    uint32_t num_pages;
+  };
+
+  // Followed by ways * sets lines, each a CacheLineState and line_size bytes
+  // of data padded to 8 bytes, then the policy_words words of replacement
+  // policy state padded to 8 bytes.
+  struct CacheState {
+    uint64_t line_size;
+    uint64_t sets;
+    uint64_t ways;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cycles;
+    uint32_t replacement_policy;
+    uint32_t policy_words;
+  };
+
+  struct CacheLineState {
+    uint64_t tag;
+    uint64_t swapin_counter;
+    uint8_t valid;
+    uint8_t dirty;
+    uint8_t reserved[6];
+  };
+
+  static constexpr uint32_t kPageSize{4096};
+  static constexpr uint32_t kMaxCacheLevels{16};
+  static constexpr char kMagic[4] = {'J', 'F', 'C', 'K'};
+
+  class Writer;
+  class Reader;
+};
@@ -36,6 +36,9 @@ class CommandInterpreter {
       Command_DeleteBreakpoint,
       Command_ShowBreakpoints,
       Command_Stats,
+      Command_Mode,
+      Command_Checkpoint,
+      Command_Restore,
     };
 
     CommandPtr Create(std::string command_string);
@@ -66,5 +69,8 @@ class CommandInterpreter {
       "\tbr [address] : set breakpoint\n"
       "\tdel [breakpoint number] : delete breakpoint\n"
       "\tsbr : show all breakpoints\n"
-      "\tstat: show sim stats\n\n"};
+      "\tstat: show sim stats\n"
+      "\tmode [functional|cycle] : switch simulation mode\n"
+      "\tckpt [file] : save checkpoint\n"
+      "\trestore [file] : restore checkpoint\n\n"};
 };
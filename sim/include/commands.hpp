@@ -94,6 +94,39 @@ class ContinueCommand : public CommandBase {
   CpuPtr cpu_;
 };
 
+class ModeCommand : public CommandBase {
+ public:
+  ModeCommand(const std::string& command, CpuPtr cpu);
+  ~ModeCommand() override = default;
+
+  void RunCommand() final;
+
+ private:
+  CpuPtr cpu_;
+};
+
+class CheckpointCommand : public CommandBase {
+ public:
+  CheckpointCommand(const std::string& command, CpuPtr cpu);
+  ~CheckpointCommand() override = default;
+
+  void RunCommand() final;
+
+ private:
+  CpuPtr cpu_;
+};
+
+class RestoreCommand : public CommandBase {
+ public:
+  RestoreCommand(const std::string& command, CpuPtr cpu);
+  ~RestoreCommand() override = default;
+
+  void RunCommand() final;
+
+ private:
+  CpuPtr cpu_;
+};
+
 class ResetCommand : public CommandBase {
  public:
   ResetCommand(const std::string& command, CpuPtr cpu);
@@ -2,8 +2,10 @@
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <memory>
 
+#include <functional_core.hpp>
 #include <hardware_object.hpp>
 #include <hazard_detection.hpp>
 #include <instructions.hpp>
@@ -15,14 +17,43 @@ class CPU;
 using CpuPtr = std::shared_ptr<CPU>;
 using Breakpoint = std::pair<int, mem_addr_t>;
 
+// Functional mode retires one instruction per cycle on the functional core.
+// Cycle mode runs the pipeline, caches and hazard units.
+enum class SimulationMode { Functional, Cycle };
+
 class CPU : public HardwareObject {
  public:
-  CPU(MemoryPtr instr_mem, MemoryPtr data_mem);
+  // code_mem is the memory functional mode decodes from when the instruction
+  // port's misses end up in data memory, e.g. through a unified L2
+  CPU(MemoryPtr instr_mem, MemoryPtr data_mem,
+      SimulationMode mode = SimulationMode::Cycle,
+      MemoryPtr code_mem = nullptr);
   ~CPU() override = default;
 
   // Override of HardwareObject methods
   void ExecuteCycle() final;
   void Reset() final;
+  // Cycle mode only: the soonest event of the pipeline and memories
+  std::size_t CyclesUntilEvent() const final;
+  void SkipCycles(std::size_t num_cycles) final;
+
+  // Executes until max_instructions have completed, a breakpoint is reached or
+  // the program halts.
+  FunctionalCore::StopReason Run(
+      std::size_t max_instructions = std::numeric_limits<std::size_t>::max());
+
+  // Switching modes drains the pipeline and flushes the caches first, so the
+  // new mode starts from the architectural state left by the old one.
+  void SetMode(SimulationMode mode);
+  SimulationMode GetMode() const;
+
+  // Executes num_instructions functionally with fetches, loads and stores
+  // routed through the caches, then switches to cycle mode without flushing
+  // so detailed simulation starts on warm caches. Requires functional mode.
+  FunctionalCore::StopReason WarmUp(std::size_t num_instructions);
+
+  // Functional mode runs translated host code instead of interpreting
+  void SetJitEnabled(bool enabled);
 
   // Debug
   void SetBreakpoint(mem_addr_t breakpoint_address);
@@ -34,20 +65,41 @@ class CPU : public HardwareObject {
   RegFilePtr GetRegFile() const;
   PcPtr GetPC() const;
   PipelinePtr GetPipeline() const;
+  MemoryPtr GetInstrMem() const;
+  MemoryPtr GetDataMem() const;
   HazardDetectionPtr GetDataHazardDetector() const;
   HazardDetectionPtr GetControlHazardDetector() const;
 
   // Stat functions
   double GetCPI() const;
+  std::size_t InstructionsCompleted() const;
 
  private:
+  friend class Checkpoint;
+
+  // Each mode is its own specialization so the run loop is free of mode
+  // checks. Step advances one cycle without checking breakpoints and returns
+  // true if the program halted.
+  template <SimulationMode mode>
+  FunctionalCore::StopReason RunMode(std::size_t max_instructions);
+  template <SimulationMode mode>
+  bool Step();
+
+  bool AtBreakpoint() const;
+  void DrainPipeline();
+  // Jumps over cycles in which every component is waiting, so a stall costs
+  // one skip rather than a tick per cycle
+  void SkipIdleCycles();
+
   RegFilePtr reg_file_;
   PcPtr pc_;
   PipelinePtr pipeline_;
   HazardDetectionPtr data_hazard_detector_;
   HazardDetectionPtr control_hazard_detector_;
+  FunctionalCorePtr functional_core_;
   MemoryPtr instr_mem_;
   MemoryPtr data_mem_;
   std::vector<Breakpoint> bkpts_;
   bool at_bkpt_ = false;
+  SimulationMode mode_;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <instruction_factory.hpp>
+#include <instructions.hpp>
+#include <memory.hpp>
+#include <register_file.hpp>
+#include <riscv_defs.hpp>
+
+// Directly mapped, PC indexed cache of decoded instruction objects which sits
+// in front of InstructionFactory. Each entry is tagged with both the address
+// and the raw instruction word it was decoded from, so a store into
+// instruction memory invalidates the entry the next time that PC is fetched.
+//
+// The cache owns every decoded object it hands out. Each entry keeps a small
+// pool of copies so a PC that is fetched again while still in the pipeline
+// (e.g. a tight loop) gets a spare copy, and steady state fetches allocate
+// nothing.
+class DecodedInstructionCache {
+ public:
+  DecodedInstructionCache(RegFilePtr reg_file, PcPtr pc, MemoryPtr data_mem,
+                          std::size_t num_entries = kDefaultNumEntries);
+
+  // Returns a decoded instruction object for instr, which was fetched from
+  // instr_addr. The first pooled copy not in flight in the pipeline is handed
+  // back; a new copy is decoded only if all of them are. The object stays
+  // valid while it is in flight, even if its entry is replaced meanwhile.
+  InstructionInterface* Fetch(mem_addr_t instr_addr, instr_t instr);
+
+  void Invalidate(mem_addr_t instr_addr);
+  void Clear();
+
+  std::size_t Hits() const { return num_hits_; }
+  std::size_t Misses() const { return num_misses_; }
+
+ private:
+  struct Entry {
+    mem_addr_t instr_addr = 0;
+    instr_t instr = 0;
+    std::vector<InstructionPtr> decoded;  // pooled copies
+  };
+
+  // Enough entries to cover the default 32k instruction memory
+  static constexpr std::size_t kDefaultNumEntries{1 << 13};
+
+  Entry& Lookup(mem_addr_t instr_addr);
+  // Drops the entry's copies, keeping those still in flight alive
+  void Retire(Entry& entry);
+  // Moves the entry's copies still in flight to retired_, dropping the rest
+  void ReleaseCopies(Entry& entry);
+  // Frees retired copies that have left the pipeline
+  void SweepRetired();
+
+  InstructionFactory instruction_factory_;
+  std::vector<Entry> entries_;
+  std::vector<InstructionPtr> retired_;
+  std::size_t index_mask_;
+  std::size_t num_hits_ = 0;
+  std::size_t num_misses_ = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <memory.hpp>
+#include <riscv_defs.hpp>
+
+// A little endian ELF32 RISC-V executable. Its PT_LOAD segments are placed
+// at their virtual addresses: every segment in data memory, so loads see
+// initialized and read only data, and executable ones in instruction memory
+// as well. Bytes a segment reserves beyond its file contents (.bss) are
+// zeroed. Function and object symbols are kept for looking up addresses.
+class ElfImage {
+ public:
+  struct Symbol {
+    std::string name;
+    mem_addr_t addr;
+    uint32_t size;
+  };
+
+  explicit ElfImage(const std::string& path);
+
+  static bool IsElf(const std::string& path);
+
+  // Builds the instruction memory for the program at path, loading any
+  // data it carries into data_mem. Programs are ELF executables, starting
+  // at their entry point, or flat binaries placed at and starting from
+  // address 0. An ELF's instruction memory starts at the page holding its
+  // lowest executable segment and only spans its code.
+  static MemoryPtr LoadProgram(const std::string& path, std::size_t latency,
+                               MainMemoryBase& data_mem,
+                               mem_addr_t& entry_point);
+
+  void Load(MainMemoryBase& instr_mem, MainMemoryBase& data_mem) const;
+
+  mem_addr_t EntryPoint() const { return entry_point_; }
+  // Start of the lowest executable segment
+  mem_addr_t CodeBase() const;
+  // End of the highest executable segment
+  std::size_t CodeEnd() const;
+
+  // Sorted by address
+  const std::vector<Symbol>& Symbols() const { return symbols_; }
+  // Symbol whose extent covers addr, or nullptr
+  const Symbol* SymbolAt(mem_addr_t addr) const;
+  const Symbol* FindSymbol(const std::string& name) const;
+
+ private:
+  struct Segment {
+    mem_addr_t addr;
+    std::size_t file_offset;
+    std::size_t file_size;
+    std::size_t mem_size;
+    bool executable;
+  };
+
+  template <typename header_t>
+  header_t ReadHeader(std::size_t offset) const;
+  void LoadSegment(const Segment& segment, MainMemoryBase& mem) const;
+  void ReadSymbols(std::size_t section_offset, std::size_t num_sections,
+                   std::size_t section_size);
+
+  std::string path_;
+  std::vector<uint8_t> file_;
+  mem_addr_t entry_point_ = 0;
+  std::vector<Segment> segments_;
+  std::vector<Symbol> symbols_;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Event tracing for the simulator's hot paths. Events are grouped in
+// categories that are switched on at run time, and each enabled event is
+// stored as one fixed size binary record in a ring buffer owned by the
+// recording thread. Rings are dumped to a file and decoded offline, so a
+// trace costs no formatting while the simulation runs.
+//
+// TRACE_EVENT compiles to nothing unless the simulator is built with
+// RISCV_SIM_TRACE defined (cmake -DENABLE_EVENT_TRACE=ON); its arguments are
+// then not evaluated at all.
+enum class TraceCategory : uint8_t { Fetch, Hazard, Cache, Mem, NumCategories };
+
+enum class TraceEvent : uint8_t {
+  Fetch,      // fetch: arg0 = pc, arg1 = instruction word
+  Retire,     // fetch: arg0 = pc, arg1 = instruction word
+  Forward,    // hazard: arg0 = consumer pc, arg1 = register forwarded
+  LoadUse,    // hazard: arg0 = consumer pc, arg1 = register loaded
+  Flush,      // hazard: arg0 = branch pc, arg1 = stages flushed
+  CacheHit,   // cache: arg0 = address, arg1 = set
+  CacheMiss,  // cache: arg0 = address, arg1 = set filled
+  Writeback,  // cache: arg0 = line address, arg1 = line size
+  Prefetch,   // cache: arg0 = line address, arg1 = cycles until it arrives
+  MemRead,    // mem: arg0 = address, arg1 = access size
+  MemWrite,   // mem: arg0 = address, arg1 = access size
+  NumEvents
+};
+
+struct TraceRecord {
+  uint64_t cycle = 0;
+  uint32_t arg0 = 0;
+  uint32_t arg1 = 0;
+  TraceCategory category = TraceCategory::Fetch;
+  TraceEvent event = TraceEvent::Fetch;
+  uint8_t reserved[6] = {0, 0, 0, 0, 0, 0};
+};
+static_assert(sizeof(TraceRecord) == 24, "Trace record size != 24");
+
+class Tracer {
+ public:
+  // Records kept per thread; older ones are overwritten
+  static constexpr std::size_t kRingSize{1 << 16};
+#ifdef RISCV_SIM_TRACE
+  static constexpr bool kCompiledIn{true};
+#else
+  static constexpr bool kCompiledIn{false};
+#endif
+
+  static bool Enabled(TraceCategory category) {
+    return (enabled_mask_.load(std::memory_order_relaxed) &
+            (1u << static_cast<unsigned>(category))) != 0;
+  }
+  static void Enable(TraceCategory category, bool enabled = true);
+  // Comma separated category names, e.g. "fetch,cache"
+  static void EnableCategories(const std::string& categories);
+
+  static void Record(TraceCategory category, TraceEvent event, uint64_t cycle,
+                     uint32_t arg0, uint32_t arg1);
+
+  // Writes the rings of every thread that recorded, oldest record first.
+  // Recording threads must be idle meanwhile.
+  static void Dump(const std::string& path);
+  // Prints a dump as text, one record per line
+  static void Decode(const std::string& path, std::ostream& out_stream);
+  static void Clear();
+
+  static const char* CategoryName(TraceCategory category);
+  static const char* EventName(TraceEvent event);
+
+ private:
+  struct Ring {
+    std::array<TraceRecord, kRingSize> records;
+    uint64_t num_recorded = 0;
+    uint32_t thread_index = 0;
+  };
+  using RingPtr = std::shared_ptr<Ring>;
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<RingPtr> rings;
+  };
+
+  // A dump is this header followed by each thread's header and records
+  struct FileHeader {
+    char magic[4] = {'J', 'F', 'E', 'V'};
+    uint32_t version = kVersion;
+    uint32_t num_threads = 0;
+    uint32_t reserved = 0;
+  };
+  struct ThreadHeader {
+    uint32_t thread_index = 0;
+    uint32_t reserved = 0;
+    uint64_t num_records = 0;
+  };
+  static constexpr uint32_t kVersion{1};
+
+  static Ring& ThisThread();
+  static Registry& Rings();
+
+  static std::atomic<uint32_t> enabled_mask_;
+};
+
+#ifdef RISCV_SIM_TRACE
+#define TRACE_EVENT(category, event, cycle, arg0, arg1)                    \
+  do {                                                                     \
+    if (Tracer::Enabled(TraceCategory::category)) {                        \
+      Tracer::Record(TraceCategory::category, TraceEvent::event, (cycle), \
+                     static_cast<uint32_t>(arg0),                         \
+                     static_cast<uint32_t>(arg1));                        \
+    }                                                                      \
+  } while (0)
+#else
+#define TRACE_EVENT(category, event, cycle, arg0, arg1) \
+  do {                                                  \
+  } while (0)
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <memory.hpp>
+#include <register_file.hpp>
+#include <riscv_defs.hpp>
+
+class FunctionalCore;
+using FunctionalCorePtr = std::shared_ptr<FunctionalCore>;
+class JitTranslator;
+
+// Instruction accurate RV32I engine. Retires one instruction per iteration of
+// a threaded (computed goto) dispatch loop over a flat register array and
+// pre-decoded instruction table. Loads, stores and fetches go straight to the
+// backing main memories, so there is no pipeline, cache, hazard unit or
+// logging on the hot path. Plain runs can optionally be handed to the
+// JitTranslator instead.
+class FunctionalCore {
+ public:
+  // Code is decoded from code_mem when given, instead of the main memory
+  // behind instr_mem, for hierarchies whose fetches miss to a memory shared
+  // with data. The pre-decoded table spans the code memory from its base, so
+  // it only covers the program's code however high that is linked.
+  FunctionalCore(RegFilePtr reg_file, PcPtr pc, MemoryPtr instr_mem,
+                 MemoryPtr data_mem, MemoryPtr code_mem = nullptr);
+
+  enum class StopReason {
+    InstructionLimit,    // retired max_instructions
+    Breakpoint,          // about to execute a breakpoint address
+    Halt,                // jump to self, ecall or ebreak
+    IllegalInstruction,  // undecodable word or bad control transfer target
+  };
+
+  // Runs until max_instructions have retired or one of the other stop
+  // conditions is reached. Architectural state is read from, and written back
+  // to, the register file and program counter. A breakpoint on the very first
+  // instruction is ignored so execution can resume from it.
+  StopReason Run(std::size_t max_instructions =
+                     std::numeric_limits<std::size_t>::max());
+
+  // Same as Run, but fetches, loads and stores go through the memories the
+  // core was constructed with (e.g. caches) so their tags and replacement
+  // state are warmed. Those memories then hold the up to date data.
+  StopReason Warm(std::size_t max_instructions);
+
+  void SetBreakpoint(mem_addr_t bkpt_addr);
+  void ClearBreakpoint(mem_addr_t bkpt_addr);
+
+  // Drops all pre-decoded instructions (e.g. after instruction memory has been
+  // rewritten from outside the core).
+  void InvalidateDecodedInstructions();
+
+  // Translates plain runs to host code when the host supports it. Warming and
+  // runs with breakpoints set always use the interpreter.
+  void SetJitEnabled(bool enabled);
+  bool JitEnabled() const { return jit_ != nullptr; }
+
+  void Reset();
+
+  std::size_t InstructionsRetired() const { return instructions_retired_; }
+  // Used when restoring a checkpoint
+  void SetInstructionsRetired(std::size_t instructions_retired) {
+    instructions_retired_ = instructions_retired;
+  }
+
+  // Pre-decoded instruction form, shared with the JIT
+  enum Operation : uint8_t {
+    Op_Undecoded,
+    Op_Lui,
+    Op_Auipc,
+    Op_Jal,
+    Op_Jalr,
+    Op_Beq,
+    Op_Bne,
+    Op_Blt,
+    Op_Bge,
+    Op_Bltu,
+    Op_Bgeu,
+    Op_Lb,
+    Op_Lh,
+    Op_Lw,
+    Op_Lbu,
+    Op_Lhu,
+    Op_Sb,
+    Op_Sh,
+    Op_Sw,
+    Op_Addi,
+    Op_Slti,
+    Op_Sltiu,
+    Op_Xori,
+    Op_Ori,
+    Op_Andi,
+    Op_Slli,
+    Op_Srli,
+    Op_Srai,
+    Op_Add,
+    Op_Sub,
+    Op_Sll,
+    Op_Slt,
+    Op_Sltu,
+    Op_Xor,
+    Op_Srl,
+    Op_Sra,
+    Op_Or,
+    Op_And,
+    Op_Fence,
+    Op_Halt,
+    Op_Illegal,
+    Op_Breakpoint,
+    Op_PcOutOfRange,
+    NumOperations
+  };
+
+  struct DecodedInstruction {
+    Operation op = Op_Undecoded;
+    uint8_t rd = 0;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    imm_t imm = 0;
+  };
+
+  // Writes to x0 are redirected to this extra slot so handlers never have to
+  // special case rd == 0.
+  static constexpr std::size_t kZeroSinkRegister{
+      RegisterFile::NumCPURegisters};
+
+ private:
+  friend class JitTranslator;
+
+  template <bool kWarmCaches>
+  StopReason Execute(std::size_t max_instructions);
+  StopReason Interpret(std::size_t max_instructions);
+
+  static DecodedInstruction Decode(instr_t instr);
+  DecodedInstruction& DecodedAt(mem_addr_t instr_addr);
+  // Offset of addr into the code memory. Addresses below its base wrap past
+  // the end, so one unsigned compare bounds checks both sides.
+  mem_addr_t CodeOffset(mem_addr_t addr) const { return addr - code_base_; }
+  // Drops decoded entries overlapping a store when code and data share memory
+  void InvalidateStore(mem_addr_t store_addr, std::size_t num_bytes);
+
+  RegFilePtr reg_file_;
+  PcPtr pc_;
+  MemoryPtr instr_port_;
+  MemoryPtr data_port_;
+  MainMemoryBase* instr_mem_;
+  MainMemoryBase* data_mem_;
+  mem_addr_t code_base_;
+  std::vector<DecodedInstruction> decoded_;
+  std::map<mem_addr_t, DecodedInstruction> breakpoints_;
+  std::size_t instructions_retired_ = 0;
+  std::shared_ptr<JitTranslator> jit_;
+};
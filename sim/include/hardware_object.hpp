@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <memory>
 
 class HardwareObject;
@@ -14,6 +15,17 @@ class HardwareObject {
   virtual void Reset() { cycle_counter_ = 0; }
   std::size_t GetCycles() { return cycle_counter_; }
 
+  // Number of upcoming cycles in which this object does nothing but wait, so
+  // a scheduler may jump over them with SkipCycles(). Objects that only act
+  // when accessed return kIdle; the default of zero means tick every cycle.
+  static constexpr std::size_t kIdle{std::numeric_limits<std::size_t>::max()};
+  virtual std::size_t CyclesUntilEvent() const { return 0; }
+
+  // Same effect as num_cycles calls to ExecuteCycle() while waiting
+  virtual void SkipCycles(std::size_t num_cycles) {
+    cycle_counter_ += num_cycles;
+  }
+
  protected:
   std::size_t cycle_counter_;
 };
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
+
 #include <instructions.hpp>
 #include <pipeline.hpp>
+#include <register_file.hpp>
 
 class Pipeline;
 class IHazardDetectionUnit;
@@ -13,6 +16,8 @@ class IHazardDetectionUnit {
   virtual ~IHazardDetectionUnit() {}
 
   virtual void HandleHazard() = 0;
+  // Forgets state carried between cycles, keeping the statistics
+  virtual void Reset() {}
 
   std::size_t HazardsDetected() const { return hazards_detected_; }
   std::size_t DelayAdded() const { return delay_added_; }
@@ -22,12 +27,12 @@ class IHazardDetectionUnit {
   std::size_t hazards_detected_ = 0;
   std::size_t delay_added_ = 0;
 
-  Register& GetRd(const InstructionPtr& instr) const;
-  Register& GetRs1(const InstructionPtr& instr) const;
-  Register& GetRs2(const InstructionPtr& instr) const;
-  bool WritesToRd(const InstructionPtr& instr) const;
-  bool ReadsFromRs1(const InstructionPtr& instr) const;
-  bool ReadsFromRs2(const InstructionPtr& instr) const;
+  Register& GetRd(InstructionInterface* instr) const;
+  Register& GetRs1(InstructionInterface* instr) const;
+  Register& GetRs2(InstructionInterface* instr) const;
+  bool WritesToRd(InstructionInterface* instr) const;
+  bool ReadsFromRs1(InstructionInterface* instr) const;
+  bool ReadsFromRs2(InstructionInterface* instr) const;
 };
 
 class DataHazardDetectionUnit : public IHazardDetectionUnit {
@@ -37,16 +42,27 @@ class DataHazardDetectionUnit : public IHazardDetectionUnit {
   ~DataHazardDetectionUnit() override = default;
 
   void HandleHazard() final;
+  void Reset() final;
 
  private:
   // 1a type hazard forwards data from EX/MEM buf to ID/EX buf
-  void Handle1aTypeHazard(InstructionPtr& decode_instr,
-                          InstructionPtr& execute_instr);
+  void Handle1aTypeHazard(InstructionInterface* decode_instr,
+                          InstructionInterface* execute_instr);
   // 1b type data hazard forwards data from MEM/WB buf to ID/EX buf
-  void Handle1bTypeHazard(InstructionPtr& decode_instr,
-                          InstructionPtr& memory_access_instr);
-  void HandleLoadHazard(InstructionPtr& execute_instr,
-                        InstructionPtr& decode_instr);
+  void Handle1bTypeHazard(InstructionInterface* decode_instr,
+                          InstructionInterface* memory_access_instr);
+  void HandleLoadHazard(InstructionInterface* execute_instr,
+                        InstructionInterface* decode_instr);
+  // Notes when the register written by the instruction that just accessed
+  // memory gets its data. Only loads from non-blocking caches leave it late.
+  void TrackLoadData(InstructionInterface* memory_access_instr);
+  // Holds an instruction in decode while a register it reads waits for its
+  // load's data, letting older instructions drain ahead of it
+  void HandleMissHazard(InstructionInterface* decode_instr,
+                        InstructionInterface* execute_instr);
+
+  // Pipeline cycle from which each register's load data is available
+  std::array<std::size_t, RegisterFile::NumCPURegisters> ready_cycles_{};
 };
 
 class ControlHazardDetectionUnit : public IHazardDetectionUnit {
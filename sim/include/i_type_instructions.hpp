@@ -30,20 +30,20 @@ class ITypeInstructionInterface : public InstructionInterface {
   void Execute();
   void WriteBack();
 
-  Register& Rd() { return *Rd_; }
-  Register& Rs1() { return *Rs1_; }
-  const Register& Rd() const { return *Rd_; }
-  const Register& Rs1() const { return *Rs1_; }
+  Register& Rd() { return Rd_; }
+  Register& Rs1() { return Rs1_; }
+  const Register& Rd() const { return Rd_; }
+  const Register& Rs1() const { return Rs1_; }
 
   OpCode GetOpCode() const { return OpCode::ITypeArithmeticAndLogical; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
-  RegPtr Rd_;
-  RegPtr Rs1_;
+  Register Rd_;
+  Register Rs1_;
   imm_t imm_;
 };
 
@@ -108,11 +108,16 @@ class LoadInstructionInterface : public ITypeInstructionInterface {
 
   OpCode GetOpCode() const final { return OpCode::Lx; }
 
+  // Cycles from the memory access until the loaded data is available, which
+  // a non-blocking cache may return before
+  std::size_t DataLatency() const { return data_latency_; }
+
  protected:
-  void SetInstructionName() final;
+  void Disassemble(std::ostream& stream) const final;
 
   MemoryPtr mem_;
   mem_addr_t load_addr_;
+  std::size_t data_latency_ = 0;
 };
 
 class LbInstruction : public LoadInstructionInterface {
@@ -2,7 +2,9 @@
 
 #include <bitset>
 #include <cstdint>
+#include <iostream>
 #include <memory>
+#include <string>
 
 #include <glog/logging.h>
 
@@ -22,7 +24,9 @@ enum class OpCode {
   Lx = 0b0000011,   // Load instructions Op
   Sx = 0b0100011,   // Store instructions Op
   ITypeArithmeticAndLogical = 0b0010011,
-  RTypeArithmeticAndLogical = 0b0110011
+  RTypeArithmeticAndLogical = 0b0110011,
+  FENCE = 0b0001111,
+  SYSTEM = 0b1110011  // ecall/ebreak
 };
 
 enum class InstructionTypes {
@@ -83,6 +87,52 @@ enum class Funct7 {
   SRA = 0b0100000
 };
 
+// Identity of a decoded instruction. Disassembly text is only built from it
+// on demand, for logging and debugger views.
+enum class Mnemonic {
+  Nop,
+  Lui,
+  Auipc,
+  Jal,
+  Jalr,
+  Beq,
+  Bne,
+  Blt,
+  Bge,
+  Bltu,
+  Bgeu,
+  Lb,
+  Lh,
+  Lw,
+  Lbu,
+  Lhu,
+  Sb,
+  Sh,
+  Sw,
+  Addi,
+  Slti,
+  Sltiu,
+  Xori,
+  Ori,
+  Andi,
+  Slli,
+  Srli,
+  Srai,
+  Add,
+  Sub,
+  Sll,
+  Slt,
+  Sltu,
+  Xor,
+  Srl,
+  Sra,
+  Or,
+  And
+};
+
+const char* MnemonicName(Mnemonic mnemonic);
+std::ostream& operator<<(std::ostream& stream, Mnemonic mnemonic);
+
 class InstructionInterface;
 using InstructionPtr = std::shared_ptr<InstructionInterface>;
 
@@ -106,8 +156,8 @@ class InstructionInterface {
   // Used to create similar interface to other HardwareObjects.
   void ExecuteCycle(int stage);
 
-  // Pipeline stages
-  // TODO: Figure out name_/instruction_ string (lose one of them)
+  // Pipeline stages. The pipeline traces fetch and retirement, see
+  // event_trace.hpp.
   virtual void Fetch();
   virtual void Decode();
   virtual void Execute();
@@ -116,8 +166,23 @@ class InstructionInterface {
 
   virtual std::size_t GetCyclesForStage() const;
 
-  // Getters used for debugging
-  const std::string& InstructionName() const;
+  // Getters used for debugging. The disassembly is formatted on each call.
+  Mnemonic GetMnemonic() const { return mnemonic_; }
+  instr_t InstructionWord() const { return instr_; }
+  std::string InstructionName() const;
+
+  // Address the instruction was fetched from. Used for PC relative targets
+  // and link values.
+  mem_addr_t InstructionAddress() const { return instr_addr_; }
+  void SetInstructionAddress(mem_addr_t instr_addr) {
+    instr_addr_ = instr_addr;
+  }
+
+  // Number of pipeline slots holding this object. Pooled objects are only
+  // handed out again once they have left the pipeline.
+  bool InFlight() const { return in_flight_ != 0; }
+  void EnterPipeline() { ++in_flight_; }
+  void LeavePipeline() { --in_flight_; }
 
   // Hazard detection interface
   InstructionTypes InstructionType() const;
@@ -130,24 +195,24 @@ class InstructionInterface {
   virtual OpCode GetOpCode() const = 0;
 
  protected:
-  // Filled out in decode stage. Used for debug and logging
-  virtual void SetInstructionName() = 0;
+  // Writes the disassembly, e.g. "addi x1, x2, 5". Used for debug and logging
+  virtual void Disassemble(std::ostream& stream) const = 0;
   virtual std::string RegistersString() = 0;
 
-  std::string name_;
-  std::string instruction_;
+  Mnemonic mnemonic_ = Mnemonic::Nop;
   instr_t instr_;
+  mem_addr_t instr_addr_ = 0;
   InstructionTypes instruction_type_;
   std::size_t cycles_for_stage_ = 0;
+  std::size_t in_flight_ = 0;
 };
 
 class NopInstruction : public InstructionInterface {
  public:
-  explicit NopInstruction() : InstructionInterface(0) { name_ = "nop"; }
+  explicit NopInstruction() : InstructionInterface(0) {}
   ~NopInstruction() override = default;
 
-  // each of below function performs:
-  //   VLOG(2) << "<stage name>: NOP"
+  // Bubbles do nothing in any stage
   virtual void Decode();
   virtual void Execute();
   virtual void MemoryAccess();
@@ -156,6 +221,6 @@ class NopInstruction : public InstructionInterface {
   virtual OpCode GetOpCode() const final { return OpCode::NoOp; }
 
  private:
-  void SetInstructionName() final { instruction_ = "nop"; }
+  void Disassemble(std::ostream& stream) const final { stream << mnemonic_; }
   std::string RegistersString() final { return ""; }
 };
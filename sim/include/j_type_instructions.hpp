@@ -30,17 +30,17 @@ class JalInstruction : public InstructionInterface {
   void MemoryAccess() final;
   void WriteBack() final;
 
-  Register& Rd() { return *Rd_; }
-  const Register& Rd() const { return *Rd_; }
+  Register& Rd() { return Rd_; }
+  const Register& Rd() const { return Rd_; }
 
   OpCode GetOpCode() const final { return OpCode::JAL; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
   PcPtr pc_;
-  RegPtr Rd_;
+  Register Rd_;
   imm_t imm_;
 };
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include <functional_core.hpp>
+#include <register_file.hpp>
+#include <riscv_defs.hpp>
+
+class JitTranslator;
+using JitTranslatorPtr = std::shared_ptr<JitTranslator>;
+
+// Basic block dynamic binary translator from RV32I to x86-64 host code, used
+// by the functional core for plain (non warming, breakpoint free) runs.
+//
+// Guest blocks end at the first branch, jal or jalr and are translated into an
+// mmap'd executable buffer on first use. Guest registers live in a flat array
+// addressed off rbx. Direct exits are patched to jump straight to the
+// successor block once it has been translated and jalr looks its target up in
+// a PC indexed table, so the dispatcher only runs on translation misses and
+// stop conditions. Anything the translator does not handle (ecall, illegal
+// words, out of range accesses) is handed back to the interpreter one
+// instruction at a time so both engines stop in exactly the same way.
+//
+// Only built for x86-64 hosts; see JitTranslator::Supported.
+class JitTranslator {
+ public:
+  explicit JitTranslator(FunctionalCore& core);
+  ~JitTranslator();
+  JitTranslator(const JitTranslator&) = delete;
+  JitTranslator& operator=(const JitTranslator&) = delete;
+
+  static bool Supported();
+
+  FunctionalCore::StopReason Run(std::size_t max_instructions);
+
+  // Drops every translation overlapping [addr, addr + num_bytes)
+  void Invalidate(mem_addr_t addr, std::size_t num_bytes);
+  // Drops every translation
+  void Flush();
+
+ private:
+  // State shared with the generated code. Offsets are baked into the
+  // translations, so this must stay standard layout.
+  struct Context {
+    reg_data_t regs[RegisterFile::NumCPURegisters];
+    uint64_t budget;      // instructions left before returning
+    uint8_t* data;        // host address of guest data memory
+    uint8_t* written;     // written page flags of guest data memory
+    uint8_t** blocks;     // block entry points indexed by pc / 4
+    mem_addr_t pc;        // guest pc on exit
+    mem_addr_t jalr_pc;   // address of the jalr taking an indirect exit
+    mem_addr_t store_addr;
+    uint32_t exit;        // ExitReason or kFirstChainExit + chain exit index
+  };
+
+  enum ExitReason : uint32_t {
+    Exit_Budget,     // next block is longer than the remaining budget
+    Exit_Interpret,  // instruction at pc must run on the interpreter
+    Exit_Indirect,   // jalr target is not translated yet
+    Exit_Halt,       // jump to self at pc
+    Exit_CodeStore,  // store into instruction memory at store_addr
+    kFirstChainExit
+  };
+
+  // Patchable direct exit from a block to a static target
+  struct ChainExit {
+    uint8_t* jump;  // jmp rel32 that is rewritten to chain to the target
+    mem_addr_t target_pc;
+  };
+
+  // Out of line exit taken from the middle of a block
+  struct SideExit {
+    std::size_t jump_rel;  // rel32 of the jcc leading to the exit
+    mem_addr_t pc;
+    uint32_t refund;  // untaken instructions to give back to the budget
+    ExitReason reason;
+  };
+
+  using EntryFn = void (*)(Context*, uint8_t*);
+
+  // Whether pc is in instruction memory, and its slot in the per word tables
+  bool InCode(mem_addr_t pc) const {
+    return core_.CodeOffset(pc) < code_size_;
+  }
+  std::size_t WordIndex(mem_addr_t pc) const {
+    return core_.CodeOffset(pc) / sizeof(instr_t);
+  }
+  uint8_t* BlockAt(mem_addr_t pc);
+  const FunctionalCore::DecodedInstruction& DecodedAt(mem_addr_t pc);
+  uint8_t* Translate(mem_addr_t block_pc);
+  void TranslateInstruction(mem_addr_t pc, uint32_t index, uint32_t length,
+                            std::vector<SideExit>& side_exits);
+  void EmitTrampoline();
+  void EmitChainExit(mem_addr_t target_pc);
+  void EmitExit(mem_addr_t pc, ExitReason reason);
+  void EmitSideExits(const std::vector<SideExit>& side_exits);
+  void Chain(const ChainExit& chain_exit, uint8_t* target);
+
+  // Runs num_instructions on the interpreter from the context state
+  FunctionalCore::StopReason Interpret(std::size_t num_instructions);
+  void LoadContext();
+  void StoreContext();
+
+  // Raw x86-64 emission
+  void Emit8(uint8_t byte);
+  void Emit32(uint32_t word);
+  void EmitBytes(std::initializer_list<uint8_t> bytes);
+  void EmitRegisterAccess(uint8_t opcode, uint8_t host_reg, uint8_t guest_reg);
+  void EmitContextAccess(uint8_t opcode, uint8_t modrm_reg, uint32_t offset);
+  std::size_t EmitJcc(uint8_t condition);
+  void PatchRel32(std::size_t rel_pos, const uint8_t* target);
+
+  FunctionalCore& core_;
+  std::size_t code_size_;
+  std::size_t data_size_;
+  bool code_is_data_;
+
+  uint8_t* buffer_ = nullptr;
+  std::size_t buffer_size_ = 0;
+  std::size_t buffer_used_ = 0;
+  std::size_t blocks_start_ = 0;  // first byte after the trampoline
+  EntryFn enter_ = nullptr;
+  const uint8_t* epilogue_ = nullptr;
+
+  Context context_;
+  std::vector<uint8_t*> blocks_;
+  std::vector<bool> translated_;  // per instruction word
+  // Entry PCs whose block came out empty, left to the interpreter until
+  // their code is stored to
+  std::vector<bool> untranslatable_;
+  std::vector<ChainExit> chain_exits_;
+  std::size_t flushes_ = 0;
+  std::size_t interpreted_ = 0;
+};
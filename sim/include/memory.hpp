@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
@@ -11,7 +13,10 @@
 
 #include <glog/logging.h>
 
+#include <event_trace.hpp>
 #include <hardware_object.hpp>
+#include <prefetcher.hpp>
+#include <replacement_policy.hpp>
 #include <riscv_defs.hpp>
 
 class MemoryBase;
@@ -25,6 +30,18 @@ class MemoryBase : public HardwareObject {
 
   virtual void ExecuteCycle();
   virtual void Reset();
+  std::size_t CyclesUntilEvent() const override { return kIdle; }
+
+  // Writes back and drops any state held in front of main memory so that
+  // main memory is coherent. No-op for memories without such state.
+  virtual void Flush();
+
+  // Memory this one forwards misses or accesses to, nullptr for main memory
+  virtual MemoryBase* NextLevel() const;
+
+  // PC of the instruction making the accesses that follow, for prefetchers.
+  // Ignored by memories without one.
+  virtual void SetRequestPC(mem_addr_t pc) {}
 
   virtual uint8_t ReadByte(mem_addr_t addr) = 0;
   virtual void WriteByte(mem_addr_t addr, uint8_t data) = 0;
@@ -35,24 +52,47 @@ class MemoryBase : public HardwareObject {
   virtual uint32_t ReadWord(mem_addr_t addr) = 0;
   virtual void WriteWord(mem_addr_t addr, uint32_t data) = 0;
 
+  // Moves size bytes starting at addr, e.g. a whole cache line. Defaults to
+  // one byte access at a time.
+  virtual void ReadBlock(mem_addr_t addr, uint8_t* data, std::size_t size);
+  virtual void WriteBlock(mem_addr_t addr, const uint8_t* data,
+                          std::size_t size);
+
   virtual void CoreDump(mem_addr_t start_addr, mem_addr_t end_addr = 0,
                         std::ostream& output_stream = std::cout,
                         std::size_t width = 4);
 
   std::size_t GetLatency();
+  // Cycles the last access held the memory for
   std::size_t GetAccessLatency();
+  // Cycles until the data of the last access is available. Only exceeds the
+  // access latency for caches that let later accesses proceed under misses.
+  virtual std::size_t GetDataLatency() { return last_latency_; }
+  std::size_t GetSize() const { return size_; }
 
  protected:
-  mem_addr_t size_;
+  std::size_t size_;
   std::size_t latency_;
   std::size_t last_latency_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
+// Backed by a host mapping that is only committed page by page as it is
+// touched, so even a memory spanning the whole address space costs host
+// memory in proportion to what the program uses. The memory covers size
+// bytes from a base address, 0 unless given.
 class MainMemoryBase : public MemoryBase {
  public:
-  MainMemoryBase(std::size_t size, std::size_t latency);
-  ~MainMemoryBase() override = default;
+  // Size of a memory covering every mem_addr_t
+  static constexpr std::size_t kAddressSpaceSize{std::size_t{1} << 32};
+  // Writes are tracked by page of 1 << kWrittenPageShift bytes
+  static constexpr unsigned kWrittenPageShift{12};
+
+  MainMemoryBase(std::size_t size, std::size_t latency, mem_addr_t base = 0);
+  MainMemoryBase(MainMemoryBase&& other);
+  MainMemoryBase(const MainMemoryBase&) = delete;
+  MainMemoryBase& operator=(const MainMemoryBase&) = delete;
+  ~MainMemoryBase() override;
 
   uint8_t ReadByte(mem_addr_t addr);
   void WriteByte(mem_addr_t addr, uint8_t data);
@@ -63,8 +103,50 @@ class MainMemoryBase : public MemoryBase {
   uint32_t ReadWord(mem_addr_t addr);
   void WriteWord(mem_addr_t addr, uint32_t data);
 
+  void ReadBlock(mem_addr_t addr, uint8_t* data, std::size_t size) final;
+  void WriteBlock(mem_addr_t addr, const uint8_t* data,
+                  std::size_t size) final;
+
+  mem_addr_t GetBase() const { return base_; }
+  // Raw backing store, from the base address, for engines that bypass the
+  // timing model. Writes made through it must be flagged with MarkWritten.
+  uint8_t* Data() { return mem_; }
+  const uint8_t* Data() const { return mem_; }
+  // The size bytes of the backing store starting at addr, bounds checked and
+  // flagged as written
+  uint8_t* Span(mem_addr_t addr, std::size_t size);
+
+  void MarkWritten(mem_addr_t addr, std::size_t size) {
+    const std::size_t offset = Offset(addr);
+    const std::size_t last_page = (offset + size - 1) >> kWrittenPageShift;
+    for (std::size_t page = offset >> kWrittenPageShift; page <= last_page;
+         ++page) {
+      written_pages_[page] = 1;
+    }
+  }
+  // One flag per tracked page, for generated code marking its own stores
+  uint8_t* WrittenPageFlags() { return written_pages_.data(); }
+
+  // Indices from the base of the page_size byte pages written since the
+  // memory was made or cleared, which include every page holding data. All
+  // other pages read as zero. Host residency plays no part, so swapped out
+  // pages are kept.
+  std::vector<std::size_t> TouchedPages(std::size_t page_size) const;
+  // Zeroes the memory, handing its pages back to the host
+  void Clear();
+
  protected:
-  std::vector<uint8_t> mem_;
+  // Places the first size bytes of the file fd at the base, mapping its
+  // pages copy-on-write where they line up with the memory's
+  void MapImage(int fd, std::size_t size);
+
+  // Offset of addr from the base. Addresses below the base wrap past the end.
+  std::size_t Offset(mem_addr_t addr) const {
+    return static_cast<mem_addr_t>(addr - base_);
+  }
+
+  uint8_t* mem_ = nullptr;
+  mem_addr_t base_ = 0;
 
  private:
   template <typename data_t>
@@ -72,16 +154,25 @@ class MainMemoryBase : public MemoryBase {
 
   template <typename data_t>
   void Write(mem_addr_t mem_addr, data_t data);
+
+  void CheckSpan(mem_addr_t addr, std::size_t size) const;
+
+  std::vector<uint8_t> written_pages_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 class InstructionMemory : public MainMemoryBase {
  public:
+  static constexpr std::size_t kDefaultMemSize{1 << 15};  // 32k
+
+  // Loads a flat binary image at address 0
   InstructionMemory(const std::string& image, std::size_t latency,
                     std::size_t size = kDefaultMemSize);
+  // Starts empty, for loaders that place code themselves
+  InstructionMemory(std::size_t latency, std::size_t size = kDefaultMemSize,
+                    mem_addr_t base = 0);
 
  private:
-  static constexpr std::size_t kDefaultMemSize{1 << 15};  // 32k
   void LoadImage(const std::string& image_name);
 };
 
@@ -96,17 +187,24 @@ class DataMemory : public MainMemoryBase {
 
 enum class CacheWritePolicy { WriteBack, WriteThrough };
 
+// How a cache's contents relate to those of the caches that miss to it.
+// Inclusive levels hold everything above them, invalidating lines above when
+// they evict. Exclusive levels only hold lines evicted from above, handing
+// lines up on a hit. Non-inclusive levels fill and evict independently.
+enum class InclusionPolicy { NonInclusive, Inclusive, Exclusive };
+
 ////////////////////////////////////////////////////////////////////////////////
 class CacheBase : public MemoryBase {
  public:
   CacheBase(MemoryPtr main_mem, std::size_t line_size_bytes,
             std::size_t num_lines, std::size_t set_associativity,
             std::size_t latency, std::size_t subsequent_latency,
-            CacheWritePolicy write_policy);
+            CacheWritePolicy write_policy,
+            ReplacementPolicyType replacement_policy);
   ~CacheBase() override = default;
 
-  void ExecuteCycle() final;
   void Reset() final;
+  void Flush() final;
 
   uint8_t ReadByte(mem_addr_t addr) final;
   void WriteByte(mem_addr_t addr, uint8_t data) final;
@@ -117,19 +215,67 @@ class CacheBase : public MemoryBase {
   uint32_t ReadWord(mem_addr_t addr) final;
   void WriteWord(mem_addr_t addr, uint32_t data) final;
 
+  // Line fills and writebacks from the caches above, and stores drained from
+  // a store buffer, one access per line
+  void ReadBlock(mem_addr_t addr, uint8_t* data, std::size_t size) final;
+  void WriteBlock(mem_addr_t addr, const uint8_t* data,
+                  std::size_t size) final;
+
+  MemoryBase* NextLevel() const final;
+  MemoryPtr GetMainMemory() const { return main_mem_; }
+  void SetRequestPC(mem_addr_t pc) final;
+  std::size_t GetDataLatency() final { return data_latency_; }
+
+  void SetInclusionPolicy(InclusionPolicy inclusion_policy);
+  InclusionPolicy GetInclusionPolicy() const { return inclusion_policy_; }
+  // Registers a cache that misses to this one, which inclusive and exclusive
+  // levels act on. Several caches may share one level below them.
+  void AddUpperLevel(const std::shared_ptr<CacheBase>& upper);
+
+  std::size_t GetHits() const { return num_hits_; }
+  std::size_t GetMisses() const { return num_misses_; }
+  // Lines written to the next level
+  std::size_t GetWritebacks() const { return num_writebacks_; }
+  // Lines dropped because an inclusive level below evicted them
+  std::size_t GetBackInvalidations() const { return num_back_invalidations_; }
+
+  // With MSHRs the cache no longer blocks on misses. A miss takes the hit
+  // latency and fetches its line through a free MSHR, with GetDataLatency()
+  // telling when the data arrives, so later accesses hit under it or start
+  // misses of their own. Accesses to a line still arriving merge into the
+  // MSHR fetching it. A miss finding every MSHR busy waits for the first to
+  // free. Zero MSHRs keep the cache blocking.
+  void SetMSHRs(std::size_t num_mshrs);
+  std::size_t GetMSHRs() const { return mshrs_.size(); }
+  // Accesses served by a miss already outstanding
+  std::size_t GetMSHRMerges() const { return num_mshr_merges_; }
+  // Misses that waited for a free MSHR
+  std::size_t GetMSHRStalls() const { return num_mshr_stalls_; }
+
+  // Prefetches are issued for demand accesses to this cache. Buffer targets
+  // hold buffer_lines lines, replaced first in, first out.
+  void SetPrefetcher(PrefetcherPtr prefetcher,
+                     PrefetchTarget target = PrefetchTarget::Cache,
+                     std::size_t buffer_lines = 0);
+  bool HasPrefetcher() const { return prefetcher_ != nullptr; }
+  // Lines fetched by the prefetcher
+  std::size_t GetPrefetches() const { return num_prefetches_; }
+  // Prefetched lines later demanded, which count as hits
+  std::size_t GetUsefulPrefetches() const { return num_useful_prefetches_; }
+  // Useful prefetches demanded before they arrived
+  std::size_t GetLatePrefetches() const { return num_late_prefetches_; }
+  // Fraction of prefetches that were useful
+  double GetPrefetchAccuracy() const;
+  // Fraction of the misses there would be without prefetching that useful
+  // prefetches removed
+  double GetPrefetchCoverage() const;
+
  protected:
-  struct CacheLine {
-    CacheLine(std::size_t line_size_bytes) : line(line_size_bytes, 0) {}
-    CacheLine(int tag, std::vector<uint8_t> line_vals)
-        : tag(tag), line(line_vals) {}
-
-    std::size_t tag = 0;
-    std::vector<uint8_t> line;
-    bool dirty_bit = false;
-    bool valid_bit = false;
-    std::size_t timestamp = 0;
-    std::size_t swapin_counter = 0;
-  };
+  friend class Checkpoint;
+
+  // Tag of lines holding nothing. Lines are at least a word, so no address
+  // has a tag this large.
+  static constexpr uint32_t kInvalidTag{std::numeric_limits<uint32_t>::max()};
 
   template <typename data_t>
   void Read(mem_addr_t mem_addr, data_t& data);
@@ -145,39 +291,143 @@ class CacheBase : public MemoryBase {
                         std::size_t line_offset);
   mem_addr_t GetBaseAddress(mem_addr_t mem_addr) const;
 
-  // Returns reference to line. First checks for line, if not found then it
+  // Lines are numbered line_idx * set_associativity_ + set, so the lines
+  // competing for an index sit next to each other in every array below.
+  std::size_t LineNumber(std::size_t set, mem_addr_t mem_addr) const;
+
+  // Returns number of line. First checks for line, if not found then it
   // handles swapping in and swapping out process. Updates latency values to
   // reflect actions
-  CacheLine& LocateLine(mem_addr_t mem_addr);
+  std::size_t LocateLine(mem_addr_t mem_addr);
 
   // Returns true if line is found in cache. If found it sets the variable set
   // to the set in which the line is located
   bool FindLine(mem_addr_t mem_addr, std::size_t& set) const;
+  // Returns true if a line at mem_addr's index has the given tag, setting set
+  // to the lowest such set. Finds empty sets given kInvalidTag.
+  bool FindTag(mem_addr_t mem_addr, uint32_t tag, std::size_t& set) const;
+
+  // Fetches the line at line_addr through an MSHR, or merges with the one
+  // already fetching it, returning the cycle the line arrives. Waiting for a
+  // free MSHR adds to last_latency_.
+  std::size_t AllocateMSHR(mem_addr_t line_addr, std::size_t latency);
 
   // Writes out valid, diry lines. Reads in new line and returns set in which
-  // new line is located. Relies on implementation of EvictLine().
+  // new line is located.
   std::size_t HandleCacheMiss(mem_addr_t addr);
 
-  // Wrappers for underlying caches_ structure
-  const CacheLine& Line(std::size_t set, mem_addr_t mem_addr) const;
-  CacheLine& Line(std::size_t set, mem_addr_t mem_addr);
+  // Cycles the line has been filling for, saturating at swapin_counter_max_.
+  // Zero for prefetched lines still on their way.
+  std::size_t FillCycles(std::size_t line) const;
 
-  // Handles reading/writing lines to/from memory
-  void ReadLine(mem_addr_t mem_addr, CacheLine& cache_line);
-  void WriteLine(mem_addr_t mem_addr, const CacheLine& cache_line) const;
+  bool LineValid(std::size_t line) const { return tags_[line] != kInvalidTag; }
+  uint8_t* LineData(std::size_t line) {
+    return data_.data() + line * line_size_bytes_;
+  }
+  const uint8_t* LineData(std::size_t line) const {
+    return data_.data() + line * line_size_bytes_;
+  }
 
-  // Must be implemented by subclasses. Based on new request it determines which
-  // page to evict. This line is uniquely defined by the new_addr and the set
-  // number.
-  virtual std::size_t EvictLine(mem_addr_t new_addr) = 0;
+  // Handles reading/writing lines to/from memory
+  void ReadLine(mem_addr_t mem_addr, std::size_t line);
+  void WriteLine(mem_addr_t mem_addr, std::size_t line);
+
+  // Empties the line in set at new_addr's index: dirty contents go back to
+  // memory, or any contents to an exclusive level below
+  void EvictFromSet(std::size_t set, mem_addr_t new_addr);
+
+  // A level shared by several caches is not ticked by any of them, so it is
+  // brought up to the time of each access made to it instead
+  void CatchUp(std::size_t cycle);
+  // Latency of the last access to the next level
+  std::size_t NextLevelLatency() const;
+
+  // Drops the lines holding the size bytes at addr as the level below evicts
+  // them, copying dirty contents into data. Returns true if any were dirty.
+  bool BackInvalidate(mem_addr_t addr, uint8_t* data, std::size_t size);
+  // Back-invalidates the line at line_addr from the caches above
+  void InvalidateAbove(mem_addr_t line_addr, std::size_t line);
+  // Places a line evicted from above in an exclusive level
+  void InsertVictim(mem_addr_t addr, const uint8_t* data, bool dirty);
+
+  // Empties a set at new_addr's index for it, returning the set. Empty sets
+  // are used first, otherwise the replacement policy picks the victim.
+  std::size_t EvictLine(mem_addr_t new_addr);
+  // The set EvictLine would empty, without emptying it
+  std::size_t VictimSet(mem_addr_t new_addr);
+
+  // Moves a prefetched line from the prefetch buffer into the cache if it
+  // is there, returning true and setting set to where it went
+  bool FillFromPrefetchBuffer(mem_addr_t mem_addr, std::size_t& set);
+  // Runs the prefetcher over the last demand access once it is complete, so
+  // prefetches and any back-invalidations they cause cannot pull its line
+  // out from under it
+  void Prefetch();
+  void IssuePrefetch(mem_addr_t line_addr);
+
+  // Drops state tied to accesses in flight rather than to the lines held, so
+  // none of it outlives lines being replaced from a checkpoint
+  void ResetTransientState();
 
   MemoryPtr main_mem_;
+  // main_mem_ when it is another cache
+  CacheBase* next_cache_ = nullptr;
+  std::vector<std::weak_ptr<CacheBase>> upper_levels_;
+  InclusionPolicy inclusion_policy_ = InclusionPolicy::NonInclusive;
   std::size_t line_size_bytes_;
   std::size_t num_lines_;
   std::size_t set_associativity_;
-  std::vector<std::vector<CacheLine>> caches_;
+  // Line state by line number. tags_ runs past the last line so a probe can
+  // always load whole vectors.
+  std::vector<uint32_t> tags_;
+  std::vector<uint8_t> dirty_;
+  // Cycle each line began filling from memory. Fill progress is derived
+  // from it on access, so time passing costs nothing per line.
+  std::vector<std::size_t> fill_starts_;
+  // Line contents, line_size_bytes_ per line
+  std::vector<uint8_t> data_;
+  // Policy sets are line indices and its ways the sets here
+  ReplacementPolicyPtr replacement_policy_;
+
+  // Prefetch state. Prefetched lines are flagged until first demanded, and
+  // fill_starts_ of lines still arriving lie in the future.
+  struct BufferedLine {
+    mem_addr_t addr = 0;
+    std::size_t fill_start = 0;
+    bool valid = false;
+  };
+  PrefetcherPtr prefetcher_;
+  PrefetchTarget prefetch_target_ = PrefetchTarget::Cache;
+  std::vector<uint8_t> prefetched_;
+  std::vector<BufferedLine> prefetch_buffer_;
+  std::vector<uint8_t> prefetch_buffer_data_;
+  std::size_t prefetch_buffer_next_ = 0;
+  std::vector<mem_addr_t> prefetch_addrs_;
+  Prefetcher::Access prefetch_access_;
+  bool prefetch_pending_ = false;
+  // Extent of the memory behind the cache, outside which nothing is prefetched
+  mem_addr_t prefetch_base_ = 0;
+  std::size_t prefetch_limit_ = 0;
+  mem_addr_t request_pc_ = 0;
+
+  // Outstanding misses of a non-blocking cache, each free once its line has
+  // arrived. Lines fetched through one have fill_starts_ in the future.
+  struct MSHR {
+    mem_addr_t line_addr = 0;
+    std::size_t ready = 0;
+  };
+  std::vector<MSHR> mshrs_;
+  std::size_t data_latency_ = 0;
+
   std::size_t num_misses_ = 0;
   std::size_t num_hits_ = 0;
+  std::size_t num_writebacks_ = 0;
+  std::size_t num_back_invalidations_ = 0;
+  std::size_t num_prefetches_ = 0;
+  std::size_t num_useful_prefetches_ = 0;
+  std::size_t num_late_prefetches_ = 0;
+  std::size_t num_mshr_merges_ = 0;
+  std::size_t num_mshr_stalls_ = 0;
   std::size_t subsequent_latency_ = 0;
   std::size_t swapin_counter_max_ = 0;
   CacheWritePolicy write_policy_;
@@ -190,9 +440,6 @@ class DirectlyMappedCache : public CacheBase {
                       std::size_t num_lines, std::size_t latency,
                       std::size_t subsequent_latency,
                       CacheWritePolicy write_policy);
-
- private:
-  std::size_t EvictLine(mem_addr_t new_addr) final;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -202,9 +449,17 @@ class LRUCache : public CacheBase {
            std::size_t num_lines, std::size_t set_associativity,
            std::size_t latency, std::size_t subsequent_latency,
            CacheWritePolicy write_policy);
+};
 
- private:
-  std::size_t EvictLine(mem_addr_t new_addr) final;
+////////////////////////////////////////////////////////////////////////////////
+// Set associative cache evicting by any ReplacementPolicy
+class SetAssociativeCache : public CacheBase {
+ public:
+  SetAssociativeCache(MemoryPtr main_mem, std::size_t line_size_bytes,
+                      std::size_t num_lines, std::size_t set_associativity,
+                      std::size_t latency, std::size_t subsequent_latency,
+                      CacheWritePolicy write_policy,
+                      ReplacementPolicyType replacement_policy);
 };
 
 //
@@ -215,48 +470,50 @@ class LRUCache : public CacheBase {
 ////////////////////////////////////////////////////////////////////////////////
 template <typename data_t>
 void MainMemoryBase::Read(mem_addr_t mem_addr, data_t& data) const {
-  CHECK(mem_addr < size_) << "Attempting to read from invalid address: "
-                          << std::hex << std::showbase << mem_addr;
+  const std::size_t offset = Offset(mem_addr);
+  CHECK(offset + sizeof(data_t) <= size_)
+      << "Attempting to read from invalid address: " << std::hex
+      << std::showbase << mem_addr;
 
-  const data_t* read_ptr =
-      reinterpret_cast<const data_t*>(mem_.data() + mem_addr);
+  const data_t* read_ptr = reinterpret_cast<const data_t*>(mem_ + offset);
   data = *read_ptr;
-  VLOG(5) << "Read " << std::hex << std::showbase << data << " from address "
-          << mem_addr;
+  TRACE_EVENT(Mem, MemRead, cycle_counter_, mem_addr, sizeof(data_t));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 template <typename data_t>
 void MainMemoryBase::Write(mem_addr_t mem_addr, data_t data) {
-  CHECK(mem_addr < size_) << "Attempting to write to invalid address: "
-                          << std::hex << std::showbase << mem_addr;
+  const std::size_t offset = Offset(mem_addr);
+  CHECK(offset + sizeof(data_t) <= size_)
+      << "Attempting to write to invalid address: " << std::hex
+      << std::showbase << mem_addr;
 
-  data_t* write_ptr = reinterpret_cast<data_t*>(mem_.data() + mem_addr);
+  data_t* write_ptr = reinterpret_cast<data_t*>(mem_ + offset);
   *write_ptr = data;
-  VLOG(5) << std::hex << std::showbase << "Writing " << static_cast<int>(data)
-          << " to address " << mem_addr;
+  MarkWritten(mem_addr, sizeof(data_t));
+  TRACE_EVENT(Mem, MemWrite, cycle_counter_, mem_addr, sizeof(data_t));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 template <typename data_t>
 void CacheBase::Read(mem_addr_t mem_addr, data_t& data) {
-  const CacheLine& cache_line = LocateLine(mem_addr);
+  const std::size_t line = LocateLine(mem_addr);
   const std::size_t line_offset = GetLineOffset(mem_addr);
-  const data_t* data_ptr =
-      reinterpret_cast<const data_t*>(cache_line.line.data() + line_offset);
-  data = *data_ptr;
+  std::memcpy(&data, LineData(line) + line_offset, sizeof(data_t));
+  Prefetch();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 template <typename data_t>
 void CacheBase::Write(mem_addr_t mem_addr, data_t data) {
-  CacheLine& cache_line = LocateLine(mem_addr);
-  cache_line.dirty_bit = true;
+  const std::size_t line = LocateLine(mem_addr);
+  dirty_[line] = true;
   const std::size_t line_offset = GetLineOffset(mem_addr);
-  data_t* data_ptr =
-      reinterpret_cast<data_t*>(cache_line.line.data() + line_offset);
-  *data_ptr = data;
+  std::memcpy(LineData(line) + line_offset, &data, sizeof(data_t));
   if (write_policy_ == CacheWritePolicy::WriteThrough) {
+    if (next_cache_ != nullptr) {
+      next_cache_->CatchUp(cycle_counter_);
+    }
     switch (sizeof(data_t)) {
       case 1:
         main_mem_->WriteByte(mem_addr, data);
@@ -265,8 +522,9 @@ void CacheBase::Write(mem_addr_t mem_addr, data_t data) {
         main_mem_->WriteHalfWord(mem_addr, data);
         break;
       case 4:
-        main_mem_->WriteByte(mem_addr, data);
+        main_mem_->WriteWord(mem_addr, data);
         break;
     }
   }
+  Prefetch();
 }
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <memory.hpp>
+#include <riscv_defs.hpp>
+
+// Binary trace of the accesses the CPU makes to its instruction and data
+// ports. Each record is one info byte (port, direction and access size)
+// followed by the cycle delta and the zigzag address delta from the previous
+// access on the same port as LEB128 varints, so sequential fetches and loop
+// bodies usually take three bytes.
+class MemoryTrace {
+ public:
+  enum class Port : uint8_t { Instruction = 0, Data = 1 };
+  static constexpr std::size_t kNumPorts{2};
+
+  struct Access {
+    uint64_t cycle = 0;
+    mem_addr_t addr = 0;
+    uint8_t size = 0;  // bytes
+    Port port = Port::Instruction;
+    bool write = false;
+  };
+
+  // Streams accesses out to a trace file. The header is rewritten with the
+  // final access count when the writer is destroyed.
+  class Writer {
+   public:
+    explicit Writer(const std::string& path);
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // End address of the memory behind a port, so replay can size its
+    // memories
+    void SetPortSize(Port port, std::size_t size);
+    void Record(const Access& access);
+
+   private:
+    void FlushBuffer();
+
+    std::ofstream stream_;
+    std::vector<uint8_t> buffer_;
+    std::array<uint64_t, kNumPorts> port_sizes_{};
+    std::array<mem_addr_t, kNumPorts> last_addr_{};
+    uint64_t last_cycle_ = 0;
+    uint64_t num_accesses_ = 0;
+  };
+  using WriterPtr = std::shared_ptr<Writer>;
+
+  // Decodes accesses in order. Cursors only read the shared trace, so any
+  // number of threads can replay one trace at once.
+  class Cursor {
+   public:
+    bool Next(Access& access);
+
+   private:
+    friend class MemoryTrace;
+    Cursor(const uint8_t* pos, const uint8_t* end) : pos_(pos), end_(end) {}
+
+    uint64_t ReadVarint();
+
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    std::array<mem_addr_t, kNumPorts> last_addr_{};
+    uint64_t last_cycle_ = 0;
+  };
+
+  // Loads a whole trace file into memory
+  explicit MemoryTrace(const std::string& path);
+
+  Cursor Begin() const;
+  std::size_t NumAccesses() const { return num_accesses_; }
+  std::size_t PortSize(Port port) const {
+    return port_sizes_[static_cast<std::size_t>(port)];
+  }
+
+ private:
+  struct FileHeader {
+    char magic[4] = {'J', 'F', 'T', 'R'};
+    uint32_t version = kVersion;
+    uint64_t port_sizes[kNumPorts] = {0, 0};
+    uint64_t num_accesses = 0;
+  };
+  static constexpr uint32_t kVersion{1};
+
+  std::vector<uint8_t> records_;
+  std::array<std::size_t, kNumPorts> port_sizes_{};
+  std::size_t num_accesses_ = 0;
+};
+
+using MemoryTracePtr = std::shared_ptr<MemoryTrace>;
+
+// Records every access made through it before forwarding it to the wrapped
+// memory, which may be a cache or a main memory. Latencies are those of the
+// wrapped memory, so tracing does not change timing. Accesses are stamped
+// with this object's own cycle count, which Reset() leaves running so stamps
+// stay monotonic across resets.
+class TracingMemory : public MemoryBase {
+ public:
+  TracingMemory(MemoryPtr mem, MemoryTrace::Port port,
+                MemoryTrace::WriterPtr writer);
+  ~TracingMemory() override = default;
+
+  void ExecuteCycle() final;
+  void Reset() final;
+  std::size_t CyclesUntilEvent() const final;
+  void SkipCycles(std::size_t num_cycles) final;
+  void Flush() final;
+  MemoryBase* NextLevel() const final;
+  void SetRequestPC(mem_addr_t pc) final;
+  std::size_t GetDataLatency() final;
+
+  uint8_t ReadByte(mem_addr_t addr) final;
+  void WriteByte(mem_addr_t addr, uint8_t data) final;
+
+  uint16_t ReadHalfWord(mem_addr_t addr) final;
+  void WriteHalfWord(mem_addr_t addr, uint16_t data) final;
+
+  uint32_t ReadWord(mem_addr_t addr) final;
+  void WriteWord(mem_addr_t addr, uint32_t data) final;
+
+  // Sum of the latencies of the recorded accesses, which replaying the trace
+  // through the same caches reproduces
+  std::size_t GetTotalLatency() const { return total_latency_; }
+
+ private:
+  void Record(mem_addr_t addr, uint8_t size, bool write);
+  // Takes the latency of the access just passed on
+  void CompleteAccess();
+
+  MemoryPtr mem_;
+  MemoryTrace::Port port_;
+  MemoryTrace::WriterPtr writer_;
+  std::size_t total_latency_ = 0;
+};
@@ -1,12 +1,12 @@
 #pragma once
 
 #include <algorithm>
-#include <deque>
+#include <array>
 #include <memory>
 #include <string>
 
+#include <decoded_instruction_cache.hpp>
 #include <hardware_object.hpp>
-#include <instruction_factory.hpp>
 #include <instructions.hpp>
 #include <memory.hpp>
 #include <register_file.hpp>
@@ -19,6 +19,10 @@ class Pipeline : public HardwareObject {
   explicit Pipeline(RegFilePtr reg_file, PcPtr pc, MemoryPtr instr_mem,
                     MemoryPtr data_mem);
 
+  // Slots point into this object, so it must stay where it was built
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
   enum Stages {
     FetchStage,
     DecodeStage,
@@ -30,25 +34,39 @@ class Pipeline : public HardwareObject {
 
   void ExecuteCycle() final;
   void Reset() final;
+  // Cycles spent waiting out a memory or stage latency
+  std::size_t CyclesUntilEvent() const final { return latency_counter_; }
+  void SkipCycles(std::size_t num_cycles) final;
 
   void Flush(std::size_t n = WriteBackStage);
   void InsertDelay(Stages stage);
   bool CheckHazards() const;
 
-  const InstructionPtr& Instruction(enum Stages pipeline_stage) const;
-  InstructionPtr& Instruction(enum Stages pipeline_stage);
+  // With fetch disabled bubbles enter the pipeline and the PC holds still, so
+  // in flight instructions can be drained (e.g. before a mode switch).
+  void SetFetchEnabled(bool fetch_enabled);
+  bool IsEmpty() const;
+
+  InstructionInterface* Instruction(enum Stages pipeline_stage) const;
   std::vector<std::string> InstructionNames() const;
   std::size_t InstructionsCompleted() const;
 
  private:
-  using InstructionQueue = std::deque<InstructionPtr>;
-  InstructionQueue instruction_queue_;
+  // Latches are a fixed ring of slots indexed from the fetch stage at head_,
+  // so advancing the pipeline only moves head_. Slots point at pooled objects
+  // owned by the decoded instruction cache, or at the shared nop_.
+  InstructionInterface*& Slot(std::size_t stage);
+
+  NopInstruction nop_;
+  std::array<InstructionInterface*, NumStages> slots_;
+  std::size_t head_ = 0;
 
   PcPtr pc_;
   MemoryPtr instr_mem_;
   MemoryPtr data_mem_;
-  InstructionFactory instruction_factory_;
+  DecodedInstructionCache decoded_instr_cache_;
   bool delay_inserted_ = false;
+  bool fetch_enabled_ = true;
   std::size_t instructions_completed_ = 0;
   std::size_t branches_taken_ = 0;
   std::size_t latency_counter_ = 0;
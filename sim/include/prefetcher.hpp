@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <riscv_defs.hpp>
+
+class Prefetcher;
+using PrefetcherPtr = std::shared_ptr<Prefetcher>;
+
+enum class PrefetcherType { None, NextLine, Stride, Stream };
+
+// Where a cache places the lines its prefetcher asks for. Lines prefetched
+// into the cache compete with demand lines for its sets. Lines prefetched
+// into a small fully associative side buffer only move into the cache when a
+// demand miss finds them there, so useless prefetches cannot pollute it.
+enum class PrefetchTarget { Cache, Buffer };
+
+////////////////////////////////////////////////////////////////////////////////
+// Watches a cache's demand accesses and names lines worth fetching ahead of
+// them. The cache filters out lines it already holds, fetches the rest and
+// keeps the accuracy, coverage and timeliness counters.
+class Prefetcher {
+ public:
+  struct Params {
+    std::size_t line_size = 16;   // bytes
+    std::size_t degree = 1;       // lines fetched ahead per trigger
+    std::size_t table_size = 64;  // stride table entries
+    std::size_t num_streams = 4;
+  };
+
+  // A demand access. Prefetch hits are the first demand access to a line
+  // that was prefetched, which keeps sequential prefetchers running ahead.
+  struct Access {
+    mem_addr_t pc = 0;
+    mem_addr_t addr = 0;
+    bool miss = false;
+    bool prefetch_hit = false;
+  };
+
+  // nullptr for PrefetcherType::None
+  static PrefetcherPtr Create(PrefetcherType type, const Params& params);
+  // Parses none, next_line, stride or stream
+  static PrefetcherType TypeFromName(const std::string& name);
+
+  explicit Prefetcher(const Params& params) : params_(params) {}
+  virtual ~Prefetcher() {}
+
+  // Appends the base addresses of the lines to prefetch for access
+  virtual void Observe(const Access& access,
+                       std::vector<mem_addr_t>& line_addrs) = 0;
+  virtual void Reset() {}
+
+ protected:
+  mem_addr_t LineAddress(mem_addr_t addr) const {
+    return addr & ~static_cast<mem_addr_t>(params_.line_size - 1);
+  }
+
+  Params params_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Fetches the degree lines following a missing line, tagged so a hit on a
+// prefetched line fetches further ahead as well
+class NextLinePrefetcher : public Prefetcher {
+ public:
+  explicit NextLinePrefetcher(const Params& params);
+
+  void Observe(const Access& access,
+               std::vector<mem_addr_t>& line_addrs) final;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Reference prediction table indexed by the PC of loads and stores. Each
+// entry remembers the last address the instruction accessed and the stride
+// between its accesses, and prefetches degree strides ahead once the same
+// stride has been seen twice in a row.
+class StridePrefetcher : public Prefetcher {
+ public:
+  explicit StridePrefetcher(const Params& params);
+
+  void Observe(const Access& access,
+               std::vector<mem_addr_t>& line_addrs) final;
+  void Reset() final;
+
+ private:
+  static constexpr uint8_t kMaxConfidence{3};
+  static constexpr uint8_t kPrefetchConfidence{2};
+
+  struct Entry {
+    mem_addr_t pc = 0;
+    mem_addr_t last_addr = 0;
+    int32_t stride = 0;
+    uint8_t confidence = 0;
+    bool valid = false;
+  };
+
+  std::vector<Entry> table_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Tracks num_streams ascending streams of lines. A miss outside every stream
+// replaces the least recently advanced one with a stream starting after it.
+// A miss or prefetch hit within degree lines past a stream's head advances
+// the stream to it, keeping degree lines fetched ahead. With a buffer as the
+// target these are Jouppi's stream buffers.
+class StreamPrefetcher : public Prefetcher {
+ public:
+  explicit StreamPrefetcher(const Params& params);
+
+  void Observe(const Access& access,
+               std::vector<mem_addr_t>& line_addrs) final;
+  void Reset() final;
+
+ private:
+  struct Stream {
+    mem_addr_t head = 0;  // last line demanded from the stream
+    std::size_t last_use = 0;
+    bool valid = false;
+  };
+
+  std::vector<Stream> streams_;
+  std::size_t num_triggers_ = 0;
+};
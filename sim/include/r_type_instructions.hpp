@@ -30,24 +30,24 @@ class RTypeInstructionInterface : public InstructionInterface {
   void MemoryAccess() final;
   void WriteBack() final;
 
-  Register& Rd() { return *Rd_; }
-  Register& Rs1() { return *Rs1_; }
-  Register& Rs2() { return *Rs2_; }
+  Register& Rd() { return Rd_; }
+  Register& Rs1() { return Rs1_; }
+  Register& Rs2() { return Rs2_; }
 
-  const Register& Rd() const { return *Rd_; }
-  const Register& Rs1() const { return *Rs1_; }
-  const Register& Rs2() const { return *Rs2_; }
+  const Register& Rd() const { return Rd_; }
+  const Register& Rs1() const { return Rs1_; }
+  const Register& Rs2() const { return Rs2_; }
 
   OpCode GetOpCode() const final { return OpCode::RTypeArithmeticAndLogical; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
-  RegPtr Rd_;
-  RegPtr Rs1_;
-  RegPtr Rs2_;
+  Register Rd_;
+  Register Rs1_;
+  Register Rs2_;
 };
 
 class SxxiInstructionInterface : public RTypeInstructionInterface {
@@ -56,7 +56,7 @@ class SxxiInstructionInterface : public RTypeInstructionInterface {
   void Execute();
 
  protected:
-  void SetInstructionName() final;
+  void Disassemble(std::ostream& stream) const final;
   int shamt_;
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <bitset>
 #include <cstdint>
 #include <iostream>
@@ -15,25 +16,24 @@ using RegFilePtr = std::shared_ptr<RegisterFile>;
 class ProgramCounter;
 using PcPtr = std::shared_ptr<ProgramCounter>;
 
-class Register;
-using RegPtr = std::shared_ptr<Register>;
-
-class Register : HardwareObject {
+// Operand of a decoded instruction: a register number and the value read
+// from or to be written to it. A plain value stored inline in instructions.
+class Register {
  public:
-  Register();
-  Register(int reg_num, reg_data_t data = 0);
+  Register() = default;
+  Register(int reg_num, reg_data_t data = 0)
+      : data_(data), reg_num_(reg_num) {}
 
-  const reg_data_t& Data() const;
-  reg_data_t& Data();
+  const reg_data_t& Data() const { return data_; }
+  reg_data_t& Data() { return data_; }
 
-  void Reset() final;
-  int Number() const;
+  int Number() const { return reg_num_; }
 
   friend std::ostream& operator<<(std::ostream& stream, const Register& reg);
 
  private:
-  reg_data_t data_;
-  int reg_num_;
+  reg_data_t data_ = 0;
+  int reg_num_ = 0;
 };
 
 class RegisterFile : public HardwareObject {
@@ -94,7 +94,7 @@ class RegisterFile : public HardwareObject {
   void DumpRegisters() const;
 
  private:
-  std::vector<Register> registers_;
+  std::array<reg_data_t, NumCPURegisters> registers_{};
 };
 
 class ProgramCounter : public HardwareObject {
@@ -105,13 +105,16 @@ class ProgramCounter : public HardwareObject {
   void Reset() final;
 
   mem_addr_t InstructionPointer() const;
+  void SetInstructionPointer(mem_addr_t instr_addr);
+  // Moves the PC to entry_point, where Reset() also returns it
+  void SetEntryPoint(mem_addr_t entry_point);
 
   void Jump(mem_addr_t jump_addr);
-  void BranchOffset(int offset);
 
   friend std::ostream& operator<<(std::ostream& stream,
                                   const ProgramCounter& pc);
 
  private:
   mem_addr_t instruction_pointer_ = 0;
+  mem_addr_t entry_point_ = 0;
 };
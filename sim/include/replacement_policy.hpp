@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ReplacementPolicy;
+using ReplacementPolicyPtr = std::shared_ptr<ReplacementPolicy>;
+
+enum class ReplacementPolicyType { LRU, TreePLRU, SRRIP, BRRIP, FIFO, Random };
+
+////////////////////////////////////////////////////////////////////////////////
+// Chooses which way of a set a cache evicts. State is kept per set and every
+// operation looks at that set's ways only, so caches cost the same per access
+// however many sets they have. Caches fill empty ways before asking for a
+// victim.
+//
+// All state lives in one flat array of words so checkpoints can save it
+// without knowing the policy.
+class ReplacementPolicy {
+ public:
+  static ReplacementPolicyPtr Create(ReplacementPolicyType type,
+                                     std::size_t num_sets, std::size_t ways);
+  // Parses lru, plru, srrip, brrip, fifo or random
+  static ReplacementPolicyType TypeFromName(const std::string& name);
+  static const char* TypeName(ReplacementPolicyType type);
+  // Whether type can manage sets of this many ways
+  static bool Supports(ReplacementPolicyType type, std::size_t ways);
+
+  ReplacementPolicy(std::size_t num_sets, std::size_t ways,
+                    std::size_t words_per_set);
+  virtual ~ReplacementPolicy() {}
+
+  // A hit on way
+  virtual void Touch(std::size_t set, std::size_t way) = 0;
+  // A new line filled into way
+  virtual void Insert(std::size_t set, std::size_t way) { Touch(set, way); }
+  virtual std::size_t Victim(std::size_t set) = 0;
+
+  virtual void Reset();
+
+  ReplacementPolicyType Type() const { return type_; }
+  std::vector<uint32_t>& State() { return state_; }
+  const std::vector<uint32_t>& State() const { return state_; }
+
+ protected:
+  uint32_t* SetState(std::size_t set) {
+    return state_.data() + set * words_per_set_;
+  }
+
+  std::size_t ways_;
+  std::size_t words_per_set_;
+  std::vector<uint32_t> state_;
+
+ private:
+  ReplacementPolicyType type_ = ReplacementPolicyType::LRU;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Exact LRU. Each way holds its recency rank, 0 being the most recent.
+class LRUPolicy : public ReplacementPolicy {
+ public:
+  LRUPolicy(std::size_t num_sets, std::size_t ways);
+
+  void Touch(std::size_t set, std::size_t way) final;
+  std::size_t Victim(std::size_t set) final;
+  void Reset() final;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Tree pseudo-LRU over a power of two ways. The ways - 1 nodes of a binary
+// tree each point at the half holding the next victim, and an access turns
+// the nodes on its path away from it. Sets of one word, up to 32 ways.
+class TreePLRUPolicy : public ReplacementPolicy {
+ public:
+  TreePLRUPolicy(std::size_t num_sets, std::size_t ways);
+
+  void Touch(std::size_t set, std::size_t way) final;
+  std::size_t Victim(std::size_t set) final;
+
+ private:
+  std::size_t levels_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Re-reference interval prediction with 2 bit predictions per way. Hits
+// predict a near re-reference, victims are ways predicting a distant one,
+// aging the whole set until one does. SRRIP inserts lines with a long
+// prediction so a scan cannot flush the set. BRRIP inserts them as distant
+// but for one fill in kBimodalPeriod, resisting thrashing working sets.
+class RRIPPolicy : public ReplacementPolicy {
+ public:
+  RRIPPolicy(std::size_t num_sets, std::size_t ways, bool bimodal);
+
+  void Touch(std::size_t set, std::size_t way) final;
+  void Insert(std::size_t set, std::size_t way) final;
+  std::size_t Victim(std::size_t set) final;
+  void Reset() final;
+
+ private:
+  static constexpr uint32_t kDistant{3};
+  static constexpr uint32_t kLong{kDistant - 1};
+  static constexpr uint32_t kBimodalPeriod{32};
+
+  bool bimodal_;
+  // Fills counted toward BRRIP's long insertions, the last state word
+  std::size_t fill_counter_word_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// First in, first out. Each set holds the way filled longest ago, which a
+// fill into it moves on from. Hits change nothing.
+class FIFOPolicy : public ReplacementPolicy {
+ public:
+  FIFOPolicy(std::size_t num_sets, std::size_t ways);
+
+  void Touch(std::size_t set, std::size_t way) final {}
+  void Insert(std::size_t set, std::size_t way) final;
+  std::size_t Victim(std::size_t set) final;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Uniformly random victims from an xorshift generator kept in the state, so
+// runs and restored checkpoints are reproducible
+class RandomPolicy : public ReplacementPolicy {
+ public:
+  RandomPolicy(std::size_t num_sets, std::size_t ways);
+
+  void Touch(std::size_t set, std::size_t way) final {}
+  std::size_t Victim(std::size_t set) final;
+  void Reset() final;
+
+ private:
+  static constexpr uint32_t kSeed{0x9e3779b9};
+};
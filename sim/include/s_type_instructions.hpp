@@ -32,21 +32,21 @@ class STypeInstructionInterface : public InstructionInterface {
   void MemoryAccess();
   void WriteBack() final;
 
-  Register& Rs1() { return *Rs1_; }
-  Register& Rs2() { return *Rs2_; }
-  const Register& Rs1() const { return *Rs1_; }
-  const Register& Rs2() const { return *Rs2_; }
+  Register& Rs1() { return Rs1_; }
+  Register& Rs2() { return Rs2_; }
+  const Register& Rs1() const { return Rs1_; }
+  const Register& Rs2() const { return Rs2_; }
 
   OpCode GetOpCode() const final { return OpCode::Sx; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
   MemoryPtr mem_;
-  RegPtr Rs1_;
-  RegPtr Rs2_;
+  Register Rs1_;
+  Register Rs2_;
   imm_t imm_;
   mem_addr_t store_address_;
 };
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <cpu.hpp>
+#include <functional_core.hpp>
+
+class Sampler;
+using SamplerPtr = std::shared_ptr<Sampler>;
+
+// Sampled simulation. Repeats until the program stops:
+//   1. fast-forward fast_forward instructions on the functional core
+//   2. warm the caches functionally over the next warm_up instructions
+//   3. measure CPI over detailed instructions in cycle mode
+// The mean window CPI is extrapolated over every instruction executed.
+class Sampler {
+ public:
+  struct Params {
+    std::size_t fast_forward = 0;
+    std::size_t warm_up = 0;
+    std::size_t detailed = 0;
+    std::size_t max_samples = 0;  // 0 runs the whole program
+  };
+
+  struct Results {
+    FunctionalCore::StopReason stop_reason =
+        FunctionalCore::StopReason::InstructionLimit;
+    std::size_t num_samples = 0;
+    std::size_t total_instructions = 0;
+    std::size_t detailed_instructions = 0;
+    double mean_cpi = 0.0;
+    double cpi_stddev = 0.0;
+    double cpi_confidence_95 = 0.0;  // half width of the 95% interval
+    double extrapolated_cycles = 0.0;
+  };
+
+  Sampler(CpuPtr cpu, const Params& params);
+
+  Results Run();
+
+  static void PrintResults(const Results& results,
+                           std::ostream& output_stream = std::cout);
+
+ private:
+  // Returns true while the program can keep running
+  static bool Continues(FunctionalCore::StopReason stop_reason);
+  Results Summarize(FunctionalCore::StopReason stop_reason) const;
+
+  CpuPtr cpu_;
+  Params params_;
+  std::vector<double> window_cpis_;
+  std::size_t detailed_instructions_ = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <riscv_defs.hpp>
+
+// Single pass Mattson stack distance analyzer for LRU caches. Every access is
+// assigned the number of distinct lines touched in its set since the previous
+// access to the same line; an LRU cache with that many sets hits exactly when
+// the distance is below its associativity. One pass therefore yields the miss
+// ratio of every associativity for each set count tracked, and with one set
+// the miss ratio curve over every fully associative capacity.
+//
+// Distances are counted with a Fenwick tree over per-set access times that
+// holds a mark at each line's most recent access, compacted as it fills so
+// memory is proportional to the number of distinct lines.
+//
+// Optionally only lines whose address hash falls under a threshold are
+// tracked (SHARDS spatial sampling), with distances and counts scaled by the
+// sampling rate. With max_sampled_lines set the threshold is lowered whenever
+// more lines are sampled than that, bounding memory on arbitrarily long
+// streams.
+class StackDistance {
+ public:
+  struct Params {
+    std::size_t line_size = 16;           // bytes
+    std::vector<std::size_t> num_sets{1};  // each a power of two
+    double sampling_rate = 1.0;           // fraction of lines tracked
+    std::size_t max_sampled_lines = 0;    // 0 = no bound
+  };
+
+  struct CurvePoint {
+    std::size_t num_sets = 0;
+    std::size_t set_associativity = 0;
+    std::size_t capacity = 0;  // bytes
+    double miss_ratio = 0.0;
+  };
+
+  explicit StackDistance(const Params& params);
+
+  void Access(mem_addr_t addr);
+
+  // Estimated miss ratio of an LRU cache with num_sets (one of those tracked)
+  // sets of set_associativity lines
+  double MissRatio(std::size_t num_sets, std::size_t set_associativity) const;
+
+  // Miss ratio for every associativity up to the largest distance seen, for
+  // each set count tracked
+  std::vector<CurvePoint> MissRatioCurve() const;
+
+  double SamplingRate() const;
+  std::size_t NumAccesses() const { return num_accesses_; }
+
+  static void WriteCsvHeader(std::ostream& csv_stream);
+  // One row per curve point, labelled with name (e.g. the port analyzed)
+  void WriteCsv(const std::string& name, std::ostream& csv_stream) const;
+
+ private:
+  class FenwickTree {
+   public:
+    void Resize(std::size_t size) { tree_.assign(size + 1, 0); }
+    void Add(std::size_t index, int32_t delta);
+    // Sum of [0, index)
+    int64_t Prefix(std::size_t index) const;
+
+   private:
+    std::vector<int32_t> tree_;
+  };
+
+  // Reuse state of one set. Times are per set and renumbered on compaction.
+  struct SetStack {
+    FenwickTree marks;
+    std::vector<uint64_t> lines;  // line at each time, kNoLine if superseded
+    uint64_t clock = 0;
+    std::size_t live = 0;
+  };
+
+  // Every set count tracked keeps its own stacks and histogram
+  struct Geometry {
+    std::size_t num_sets = 0;
+    std::vector<SetStack> sets;
+    std::unordered_map<uint64_t, uint64_t> last_access;  // line to time
+    std::vector<double> histogram;  // weighted accesses at each distance
+    double cold = 0.0;              // weighted first touches
+  };
+
+  static uint64_t Hash(uint64_t line);
+
+  void Record(Geometry& geometry, uint64_t line, double weight);
+  void Forget(Geometry& geometry, uint64_t line);
+  static void Compact(Geometry& geometry, SetStack& set);
+
+  // Drops the sampled line with the largest hash and lowers the threshold
+  void LowerThreshold();
+
+  static constexpr uint64_t kNoLine{~0ull};
+  static constexpr uint64_t kHashModulus{1ull << 24};
+
+  std::size_t line_shift_;
+  std::size_t max_sampled_lines_;
+  uint64_t threshold_;
+  std::vector<Geometry> geometries_;
+  std::set<std::pair<uint64_t, uint64_t>> sampled_;  // (hash, line)
+  double weight_ = 0.0;  // accesses represented by each sampled access
+  std::size_t num_accesses_ = 0;
+};
+
+using StackDistancePtr = std::shared_ptr<StackDistance>;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <memory.hpp>
+#include <riscv_defs.hpp>
+
+class StoreBuffer;
+using StoreBufferPtr = std::shared_ptr<StoreBuffer>;
+
+////////////////////////////////////////////////////////////////////////////////
+// Holds retired stores between the pipeline and the data cache, which takes
+// them in the background, oldest first, whenever it is free. A store to a
+// line already buffered coalesces into that line's entry, so the cache sees
+// one access per line. Loads take buffered bytes over the cache's and skip
+// the cache when the buffer holds all of them. Stores only wait when the
+// buffer is full, and loads only while the cache is taking an entry.
+class StoreBuffer : public MemoryBase {
+ public:
+  StoreBuffer(MemoryPtr mem, std::size_t num_entries, std::size_t line_size);
+  ~StoreBuffer() override = default;
+
+  void ExecuteCycle() final;
+  void Reset() final;
+  std::size_t CyclesUntilEvent() const final;
+  void SkipCycles(std::size_t num_cycles) final;
+  // Drains the buffer before flushing the memory behind it
+  void Flush() final;
+  MemoryBase* NextLevel() const final;
+  void SetRequestPC(mem_addr_t pc) final;
+  std::size_t GetDataLatency() final { return data_latency_; }
+
+  uint8_t ReadByte(mem_addr_t addr) final;
+  void WriteByte(mem_addr_t addr, uint8_t data) final;
+
+  uint16_t ReadHalfWord(mem_addr_t addr) final;
+  void WriteHalfWord(mem_addr_t addr, uint16_t data) final;
+
+  uint32_t ReadWord(mem_addr_t addr) final;
+  void WriteWord(mem_addr_t addr, uint32_t data) final;
+
+  // Writes every buffered store to the memory behind the buffer
+  void Drain();
+  // Drops every buffered store without writing any of it back
+  void Discard();
+
+  std::size_t GetStores() const { return num_stores_; }
+  // Stores merged into a line already buffered
+  std::size_t GetCoalescedStores() const { return num_coalesced_; }
+  // Loads served from the buffer alone
+  std::size_t GetForwardedLoads() const { return num_forwarded_; }
+  // Stores that waited for the buffer to make room
+  std::size_t GetFullStalls() const { return num_full_stalls_; }
+
+ private:
+  struct Entry {
+    mem_addr_t line_addr = 0;
+    mem_addr_t pc = 0;
+    // Cycle the entry was buffered, from which it may drain
+    std::size_t buffered = 0;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> valid;  // by byte
+  };
+
+  template <typename data_t>
+  data_t Load(mem_addr_t addr);
+  template <typename data_t>
+  void Store(mem_addr_t addr, data_t data);
+
+  Entry& Oldest() { return entries_[head_]; }
+  // Entry buffering the line at line_addr, nullptr if none does
+  Entry* FindEntry(mem_addr_t line_addr);
+  Entry& AllocateEntry(mem_addr_t line_addr, std::size_t cycle);
+  // Writes the oldest entry to the memory, which is busy with it from start
+  void DrainOldest(std::size_t start);
+  // Drains the entries the memory has had time for by cycle
+  void DrainUntil(std::size_t cycle);
+
+  MemoryPtr mem_;
+  std::size_t line_size_;
+  // Ring of entries, the oldest at head_
+  std::vector<Entry> entries_;
+  std::size_t head_ = 0;
+  std::size_t num_buffered_ = 0;
+  // Cycle from which the memory is free to take the next entry
+  std::size_t mem_free_ = 0;
+  std::size_t data_latency_ = 0;
+  mem_addr_t request_pc_ = 0;
+  std::size_t num_stores_ = 0;
+  std::size_t num_coalesced_ = 0;
+  std::size_t num_forwarded_ = 0;
+  std::size_t num_full_stalls_ = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <functional_core.hpp>
+#include <memory.hpp>
+
+// Design space sweep over cache and memory parameters. Every configuration
+// gets its own memories, caches and CPU, so configurations run independently
+// on a WorkStealingPool and results are written as CSV rows as each run
+// finishes (i.e. in completion order, not configuration order).
+class Sweep {
+ public:
+  struct Config {
+    std::size_t line_size = 0;  // bytes
+    std::size_t num_lines = 0;
+    std::size_t set_associativity = 0;
+    std::size_t cache_latency = 0;
+    std::size_t first_word_latency = 0;
+    std::size_t subsequent_word_latency = 0;
+    CacheWritePolicy write_policy = CacheWritePolicy::WriteBack;
+    ReplacementPolicyType replacement_policy = ReplacementPolicyType::LRU;
+  };
+
+  // The sweep covers the cartesian product of all ranges
+  struct Ranges {
+    std::vector<std::size_t> line_sizes;
+    std::vector<std::size_t> num_lines;
+    std::vector<std::size_t> set_associativities;
+    std::vector<std::size_t> cache_latencies;
+    std::vector<std::size_t> first_word_latencies;
+    std::vector<std::size_t> subsequent_word_latencies;
+    std::vector<CacheWritePolicy> write_policies;
+    std::vector<ReplacementPolicyType> replacement_policies{
+        ReplacementPolicyType::LRU};
+  };
+
+  struct Result {
+    Config config;
+    FunctionalCore::StopReason stop_reason =
+        FunctionalCore::StopReason::InstructionLimit;
+    std::size_t instructions = 0;
+    std::size_t cycles = 0;
+    double cpi = 0.0;
+    double seconds = 0.0;
+  };
+
+  Sweep(const std::string& riscv_binary, const Ranges& ranges,
+        std::size_t max_instructions = std::numeric_limits<std::size_t>::max());
+
+  // Runs every configuration on num_threads threads (0 uses every hardware
+  // thread), streaming a CSV header and one row per run to csv_stream.
+  std::vector<Result> Run(std::size_t num_threads, std::ostream& csv_stream);
+
+  const std::vector<Config>& Configurations() const { return configs_; }
+
+  // Cartesian product of the ranges, skipping geometries the caches cannot
+  // represent
+  static std::vector<Config> Expand(const Ranges& ranges);
+
+  // Runs a single configuration in cycle mode on the calling thread
+  static Result RunConfiguration(const std::string& riscv_binary,
+                                 const Config& config,
+                                 std::size_t max_instructions);
+
+  static void WriteCsvHeader(std::ostream& csv_stream);
+  static void WriteCsvRow(const Result& result, std::ostream& csv_stream);
+
+  // Leading configuration columns, shared with other per-configuration CSVs
+  static void WriteConfigCsvHeader(std::ostream& csv_stream);
+  static void WriteConfigCsv(const Config& config, std::ostream& csv_stream);
+
+ private:
+  static bool ValidConfiguration(const Config& config);
+
+  std::string riscv_binary_;
+  std::size_t max_instructions_;
+  std::vector<Config> configs_;
+};
@@ -26,15 +26,15 @@ class UTypeInstructionInterface : public InstructionInterface {
   void Execute();
   void WriteBack() final;
 
-  Register& Rd() { return *Rd_; }
-  const Register& Rd() const { return *Rd_; }
+  Register& Rd() { return Rd_; }
+  const Register& Rd() const { return Rd_; }
 
  protected:
-  void SetInstructionName();
+  void Disassemble(std::ostream& stream) const;
   std::string RegistersString() final;
 
   RegFilePtr reg_file_;
-  RegPtr Rd_;
+  Register Rd_;
   imm_t imm_;
 };
 
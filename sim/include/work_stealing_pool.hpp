@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size thread pool where each worker owns a task deque. Workers take
+// their own work from the back and, once that runs dry, steal from the front
+// of the other workers' deques, so long and short tasks even out across the
+// pool without a single contended queue.
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  // num_threads of 0 uses one thread per hardware thread
+  explicit WorkStealingPool(std::size_t num_threads = 0);
+  // Finishes every submitted task before joining the workers
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  // Tasks submitted from outside the pool are dealt round robin; tasks
+  // submitted from a worker go onto that worker's own deque.
+  void Submit(Task task);
+
+  // Blocks until every task submitted so far has finished
+  void Wait();
+
+  std::size_t NumThreads() const { return threads_.size(); }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void WorkerLoop(std::size_t index);
+  bool PopLocal(std::size_t index, Task& task);
+  bool Steal(std::size_t thief, Task& task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  std::atomic<std::size_t> queued_{0};   // tasks sitting in deques
+  std::atomic<std::size_t> pending_{0};  // tasks submitted but not finished
+  std::atomic<std::size_t> next_worker_{0};
+  bool stopping_ = false;
+};
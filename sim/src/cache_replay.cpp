@@ -0,0 +1,148 @@
+#include <cache_replay.hpp>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include <glog/logging.h>
+
+#include <memory.hpp>
+#include <work_stealing_pool.hpp>
+
+namespace {
+
+void ReplayAccess(MemoryBase& cache, const MemoryTrace::Access& access) {
+  if (access.write) {
+    switch (access.size) {
+      case sizeof(uint8_t):
+        cache.WriteByte(access.addr, 0);
+        break;
+      case sizeof(uint16_t):
+        cache.WriteHalfWord(access.addr, 0);
+        break;
+      default:
+        cache.WriteWord(access.addr, 0);
+        break;
+    }
+    return;
+  }
+  switch (access.size) {
+    case sizeof(uint8_t):
+      cache.ReadByte(access.addr);
+      break;
+    case sizeof(uint16_t):
+      cache.ReadHalfWord(access.addr);
+      break;
+    default:
+      cache.ReadWord(access.addr);
+      break;
+  }
+}
+
+void WritePortCsv(const CacheReplay::PortStats& stats,
+                  std::ostream& csv_stream) {
+  csv_stream << ',' << stats.accesses << ',' << stats.hits << ','
+             << stats.misses << ','
+             << (stats.accesses ? static_cast<double>(stats.misses) /
+                                      static_cast<double>(stats.accesses)
+                                : 0.0)
+             << ',' << stats.latency;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+CacheReplay::CacheReplay(MemoryTracePtr trace, const Sweep::Ranges& ranges)
+    : trace_(trace), configs_(Sweep::Expand(ranges)) {}
+
+////////////////////////////////////////////////////////////////////////////////
+CacheReplay::Result CacheReplay::ReplayConfiguration(
+    const MemoryTrace& trace, const Sweep::Config& config) {
+  const auto start = std::chrono::steady_clock::now();
+
+  // Contents are never checked, so plain data memories stand in for both
+  std::shared_ptr<CacheBase> caches[MemoryTrace::kNumPorts];
+  for (std::size_t port = 0; port < MemoryTrace::kNumPorts; ++port) {
+    const std::size_t port_size =
+        trace.PortSize(static_cast<MemoryTrace::Port>(port));
+    CHECK(port_size > 0) << "Trace does not record memory sizes";
+    const std::size_t mem_size =
+        (port_size + config.line_size - 1) / config.line_size *
+        config.line_size;
+    MemoryPtr main_mem = std::make_shared<DataMemory>(
+        DataMemory(config.first_word_latency, mem_size));
+    caches[port] = std::make_shared<SetAssociativeCache>(SetAssociativeCache(
+        main_mem, config.line_size, config.num_lines,
+        config.set_associativity, config.cache_latency,
+        config.subsequent_word_latency, config.write_policy,
+        config.replacement_policy));
+  }
+
+  Result result;
+  result.config = config;
+  PortStats* stats[MemoryTrace::kNumPorts] = {&result.instr, &result.data};
+  uint64_t cycle = 0;
+  MemoryTrace::Access access;
+  for (MemoryTrace::Cursor cursor = trace.Begin(); cursor.Next(access);) {
+    if (access.cycle > cycle) {
+      for (auto& cache : caches) {
+        cache->SkipCycles(access.cycle - cycle);
+      }
+      cycle = access.cycle;
+    }
+    CacheBase& cache = *caches[static_cast<std::size_t>(access.port)];
+    ReplayAccess(cache, access);
+    PortStats& port_stats = *stats[static_cast<std::size_t>(access.port)];
+    ++port_stats.accesses;
+    port_stats.latency += cache.GetAccessLatency();
+  }
+  for (std::size_t port = 0; port < MemoryTrace::kNumPorts; ++port) {
+    stats[port]->hits = caches[port]->GetHits();
+    stats[port]->misses = caches[port]->GetMisses();
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<CacheReplay::Result> CacheReplay::Run(std::size_t num_threads,
+                                                  std::ostream& csv_stream) {
+  std::vector<Result> results;
+  results.reserve(configs_.size());
+  std::mutex results_mutex;
+
+  WriteCsvHeader(csv_stream);
+  WorkStealingPool pool(num_threads);
+  VLOG(1) << "Replaying " << trace_->NumAccesses() << " accesses through "
+          << configs_.size() << " configurations on " << pool.NumThreads()
+          << " threads";
+  for (const Sweep::Config& config : configs_) {
+    pool.Submit([&, config] {
+      const Result result = ReplayConfiguration(*trace_, config);
+      std::lock_guard<std::mutex> lock(results_mutex);
+      WriteCsvRow(result, csv_stream);
+      results.push_back(result);
+    });
+  }
+  pool.Wait();
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheReplay::WriteCsvHeader(std::ostream& csv_stream) {
+  Sweep::WriteConfigCsvHeader(csv_stream);
+  csv_stream << ",instr_accesses,instr_hits,instr_misses,instr_miss_rate,"
+                "instr_latency,data_accesses,data_hits,data_misses,"
+                "data_miss_rate,data_latency,seconds"
+             << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheReplay::WriteCsvRow(const Result& result, std::ostream& csv_stream) {
+  Sweep::WriteConfigCsv(result.config, csv_stream);
+  WritePortCsv(result.instr, csv_stream);
+  WritePortCsv(result.data, csv_stream);
+  csv_stream << ',' << result.seconds << std::endl;
+}
@@ -0,0 +1,406 @@
+#include <checkpoint.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <store_buffer.hpp>
+
+constexpr uint32_t Checkpoint::kVersion;
+constexpr uint32_t Checkpoint::kPageSize;
+constexpr uint32_t Checkpoint::kMaxCacheLevels;
+constexpr char Checkpoint::kMagic[4];
+
+namespace {
+
+constexpr std::size_t kAlignment{sizeof(uint64_t)};
+
+std::size_t AlignUp(std::size_t value, std::size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Caches in front of a port, nearest the CPU first
+std::vector<CacheBase*> CacheLevels(const MemoryPtr& port) {
+  std::vector<CacheBase*> caches;
+  for (MemoryBase* level = port.get(); level != nullptr;
+       level = level->NextLevel()) {
+    if (CacheBase* cache = dynamic_cast<CacheBase*>(level)) {
+      caches.push_back(cache);
+    }
+  }
+  return caches;
+}
+
+MainMemoryBase* BackingMemory(const MemoryPtr& port) {
+  MemoryBase* level = port.get();
+  while (level->NextLevel() != nullptr) {
+    level = level->NextLevel();
+  }
+  MainMemoryBase* backing = dynamic_cast<MainMemoryBase*>(level);
+  CHECK(backing != nullptr) << "Checkpoints require a main memory";
+  return backing;
+}
+
+}  // namespace
+
+// Streams sections out, patching each section's size once it is complete
+class Checkpoint::Writer {
+ public:
+  explicit Writer(const std::string& path)
+      : path_(path), stream_(path, std::ios::out | std::ios::binary) {
+    CHECK(stream_.is_open()) << "Couldn't open checkpoint " << path;
+    const FileHeader header{};
+    Write(header);
+  }
+
+  void BeginSection(SectionType type, uint32_t id) {
+    section_ = SectionHeader{type, id, 0};
+    section_start_ = Offset();
+    Write(section_);
+  }
+
+  void EndSection() {
+    Pad(kAlignment);
+    const std::size_t end = Offset();
+    section_.size = end - section_start_ - sizeof(section_);
+    stream_.seekp(section_start_);
+    Write(section_);
+    stream_.seekp(end);
+    ++num_sections_;
+  }
+
+  void Finish() {
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.num_sections = num_sections_;
+    stream_.seekp(0);
+    Write(header);
+    stream_.flush();
+    CHECK(stream_.good()) << "Failed writing checkpoint " << path_;
+  }
+
+  template <typename data_t>
+  void Write(const data_t& data) {
+    Write(&data, sizeof(data));
+  }
+
+  void Write(const void* data, std::size_t size) {
+    stream_.write(static_cast<const char*>(data), size);
+  }
+
+  void Pad(std::size_t alignment) {
+    static const char kZeros[kPageSize] = {};
+    Write(kZeros, AlignUp(Offset(), alignment) - Offset());
+  }
+
+  std::size_t Offset() { return static_cast<std::size_t>(stream_.tellp()); }
+
+ private:
+  std::string path_;
+  std::ofstream stream_;
+  SectionHeader section_{};
+  std::size_t section_start_ = 0;
+  uint64_t num_sections_ = 0;
+};
+
+// Bounds checked cursor over a read only mapping of the checkpoint file
+class Checkpoint::Reader {
+ public:
+  explicit Reader(const std::string& path) : path_(path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    CHECK(fd >= 0) << "Couldn't open checkpoint " << path;
+    struct stat file_stat;
+    CHECK(fstat(fd, &file_stat) == 0) << "Couldn't stat checkpoint " << path;
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    CHECK(size_ >= sizeof(FileHeader)) << "Truncated checkpoint " << path;
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    CHECK(mapping != MAP_FAILED) << "Couldn't map checkpoint " << path;
+    base_ = static_cast<const uint8_t*>(mapping);
+  }
+
+  ~Reader() { munmap(const_cast<uint8_t*>(base_), size_); }
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  template <typename data_t>
+  data_t Read() {
+    data_t data;
+    std::memcpy(&data, Bytes(sizeof(data)), sizeof(data));
+    return data;
+  }
+
+  const uint8_t* Bytes(std::size_t size) {
+    return BytesAt(Advance(size), size);
+  }
+
+  const uint8_t* BytesAt(std::size_t offset, std::size_t size) const {
+    CHECK(offset <= size_ && size <= size_ - offset)
+        << "Truncated checkpoint " << path_;
+    return base_ + offset;
+  }
+
+  void Seek(std::size_t offset) { offset_ = offset; }
+  std::size_t Offset() const { return offset_; }
+
+ private:
+  std::size_t Advance(std::size_t size) {
+    const std::size_t offset = offset_;
+    offset_ += size;
+    return offset;
+  }
+
+  std::string path_;
+  const uint8_t* base_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t offset_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void Checkpoint::Save(CPU& cpu, const std::string& path) {
+  if (cpu.mode_ == SimulationMode::Cycle) {
+    cpu.DrainPipeline();
+  }
+  // Retired stores still buffered belong in the caches and memory saved
+  for (MemoryBase* level = cpu.data_mem_.get(); level != nullptr;
+       level = level->NextLevel()) {
+    if (auto* store_buffer = dynamic_cast<StoreBuffer*>(level)) {
+      store_buffer->Drain();
+    }
+  }
+
+  Writer writer(path);
+
+  CpuState cpu_state{};
+  cpu_state.mode = static_cast<uint32_t>(cpu.mode_);
+  cpu_state.pc = cpu.pc_->InstructionPointer();
+  for (int ii = 0; ii < RegisterFile::NumCPURegisters; ++ii) {
+    cpu_state.regs[ii] =
+        cpu.reg_file_->Read(static_cast<RegisterFile::Registers>(ii));
+  }
+  cpu_state.cycles = cpu.GetCycles();
+  cpu_state.instructions = cpu.InstructionsCompleted();
+  writer.BeginSection(Section_Cpu, 0);
+  writer.Write(cpu_state);
+  writer.EndSection();
+
+  const MemoryPtr ports[] = {cpu.instr_mem_, cpu.data_mem_};
+  std::vector<const MemoryBase*> saved;
+  for (uint32_t port = 0; port < 2; ++port) {
+    // A memory or cache shared by both ports is saved once, under port 0
+    MainMemoryBase* main_mem = BackingMemory(ports[port]);
+    if (std::find(saved.cbegin(), saved.cend(), main_mem) == saved.cend()) {
+      saved.push_back(main_mem);
+      const uint8_t* data = main_mem->Data();
+      std::vector<uint32_t> pages;
+      for (const std::size_t page : main_mem->TouchedPages(kPageSize)) {
+        const std::size_t page_bytes = std::min<std::size_t>(
+            kPageSize, main_mem->GetSize() - page * kPageSize);
+        const uint8_t* page_data = data + page * kPageSize;
+        if (std::any_of(page_data, page_data + page_bytes,
+                        [](uint8_t byte) { return byte != 0; })) {
+          pages.push_back(static_cast<uint32_t>(page));
+        }
+      }
+
+      writer.BeginSection(Section_Memory, port);
+      MemoryState mem_state{};
+      mem_state.size = main_mem->GetSize();
+      mem_state.page_size = kPageSize;
+      mem_state.num_pages = static_cast<uint32_t>(pages.size());
+      mem_state.data_offset =
+          AlignUp(writer.Offset() + sizeof(mem_state) +
+                      pages.size() * sizeof(uint32_t),
+                  kPageSize);
+      writer.Write(mem_state);
+      writer.Write(pages.data(), pages.size() * sizeof(uint32_t));
+      writer.Pad(kPageSize);
+      CHECK(writer.Offset() == mem_state.data_offset);
+      for (const uint32_t page : pages) {
+        const std::size_t page_bytes = std::min<std::size_t>(
+            kPageSize, main_mem->GetSize() - page * kPageSize);
+        writer.Write(data + page * kPageSize, page_bytes);
+        writer.Pad(kPageSize);
+      }
+      writer.EndSection();
+    }
+
+    const std::vector<CacheBase*> caches = CacheLevels(ports[port]);
+    for (uint32_t level = 0; level < caches.size(); ++level) {
+      const CacheBase* cache = caches[level];
+      CHECK(level < kMaxCacheLevels) << "Too many cache levels";
+      if (std::find(saved.cbegin(), saved.cend(), cache) != saved.cend()) {
+        continue;
+      }
+      saved.push_back(cache);
+
+      writer.BeginSection(Section_Cache, port * kMaxCacheLevels + level);
+      CacheState cache_state{};
+      cache_state.line_size = cache->line_size_bytes_;
+      cache_state.sets = cache->num_lines_;
+      cache_state.ways = cache->set_associativity_;
+      cache_state.hits = cache->num_hits_;
+      cache_state.misses = cache->num_misses_;
+      cache_state.cycles = cache->cycle_counter_;
+      const std::vector<uint32_t>& policy_state =
+          cache->replacement_policy_->State();
+      cache_state.replacement_policy =
+          static_cast<uint32_t>(cache->replacement_policy_->Type());
+      cache_state.policy_words = policy_state.size();
+      writer.Write(cache_state);
+      for (std::size_t set = 0; set < cache->set_associativity_; ++set) {
+        for (std::size_t line_idx = 0; line_idx < cache->num_lines_;
+             ++line_idx) {
+          const std::size_t line =
+              line_idx * cache->set_associativity_ + set;
+          CacheLineState line_state{};
+          line_state.valid = cache->LineValid(line);
+          line_state.tag = line_state.valid ? cache->tags_[line] : 0;
+          line_state.swapin_counter = cache->FillCycles(line);
+          line_state.dirty = cache->dirty_[line];
+          writer.Write(line_state);
+          writer.Write(cache->LineData(line), cache->line_size_bytes_);
+          writer.Pad(kAlignment);
+        }
+      }
+      writer.Write(policy_state.data(),
+                   policy_state.size() * sizeof(uint32_t));
+      writer.Pad(kAlignment);
+      writer.EndSection();
+    }
+  }
+
+  writer.Finish();
+  VLOG(1) << "Saved checkpoint " << path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Checkpoint::Restore(CPU& cpu, const std::string& path) {
+  Reader reader(path);
+  const FileHeader header = reader.Read<FileHeader>();
+  CHECK(std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0)
+      << path << " is not a checkpoint";
+  CHECK(header.version == kVersion)
+      << "Unsupported checkpoint version " << header.version;
+
+  cpu.Reset();
+  const MemoryPtr ports[] = {cpu.instr_mem_, cpu.data_mem_};
+  // Lines are about to be replaced, so no store, prefetch or miss in flight
+  // for the old ones may carry over. Buffered stores are dropped rather than
+  // drained, as they postdate the checkpoint.
+  for (const MemoryPtr& port : ports) {
+    for (MemoryBase* level = port.get(); level != nullptr;
+         level = level->NextLevel()) {
+      if (auto* store_buffer = dynamic_cast<StoreBuffer*>(level)) {
+        store_buffer->Discard();
+      } else if (auto* cache = dynamic_cast<CacheBase*>(level)) {
+        cache->ResetTransientState();
+      }
+    }
+  }
+
+  for (uint64_t section = 0; section < header.num_sections; ++section) {
+    const SectionHeader section_header = reader.Read<SectionHeader>();
+    const std::size_t section_end = reader.Offset() + section_header.size;
+    switch (section_header.type) {
+      case Section_Cpu: {
+        const CpuState cpu_state = reader.Read<CpuState>();
+        cpu.mode_ = static_cast<SimulationMode>(cpu_state.mode);
+        cpu.pc_->SetInstructionPointer(cpu_state.pc);
+        for (int ii = 1; ii < RegisterFile::NumCPURegisters; ++ii) {
+          cpu.reg_file_->Write(static_cast<RegisterFile::Registers>(ii),
+                               cpu_state.regs[ii]);
+        }
+        cpu.cycle_counter_ = cpu_state.cycles;
+        cpu.functional_core_->SetInstructionsRetired(cpu_state.instructions);
+      } break;
+      case Section_Memory: {
+        CHECK(section_header.id < 2) << "Bad memory id " << section_header.id;
+        MainMemoryBase* main_mem = BackingMemory(ports[section_header.id]);
+        const MemoryState mem_state = reader.Read<MemoryState>();
+        CHECK(mem_state.size == main_mem->GetSize())
+            << "Checkpoint memory size " << mem_state.size
+            << " does not match " << main_mem->GetSize();
+        CHECK(mem_state.page_size == kPageSize);
+        main_mem->Clear();
+        for (uint32_t ii = 0; ii < mem_state.num_pages; ++ii) {
+          const uint32_t page = reader.Read<uint32_t>();
+          CHECK(static_cast<std::size_t>(page) * kPageSize < mem_state.size)
+              << "Bad page index " << page;
+          const std::size_t page_bytes = std::min<std::size_t>(
+              kPageSize, mem_state.size - page * kPageSize);
+          std::memcpy(main_mem->Span(main_mem->GetBase() + page * kPageSize,
+                                      page_bytes),
+                      reader.BytesAt(mem_state.data_offset +
+                                         static_cast<std::size_t>(ii) *
+                                             kPageSize,
+                                     page_bytes),
+                      page_bytes);
+        }
+      } break;
+      case Section_Cache: {
+        const uint32_t port = section_header.id / kMaxCacheLevels;
+        const uint32_t level = section_header.id % kMaxCacheLevels;
+        CHECK(port < 2) << "Bad cache id " << section_header.id;
+        const std::vector<CacheBase*> caches = CacheLevels(ports[port]);
+        CHECK(level < caches.size()) << "Checkpoint has more cache levels";
+        CacheBase* cache = caches[level];
+        const CacheState cache_state = reader.Read<CacheState>();
+        CHECK(cache_state.line_size == cache->line_size_bytes_ &&
+              cache_state.sets == cache->num_lines_ &&
+              cache_state.ways == cache->set_associativity_)
+            << "Checkpoint cache geometry does not match";
+        std::vector<uint32_t>& policy_state =
+            cache->replacement_policy_->State();
+        CHECK(cache_state.replacement_policy ==
+                  static_cast<uint32_t>(cache->replacement_policy_->Type()) &&
+              cache_state.policy_words == policy_state.size())
+            << "Checkpoint cache replacement policy does not match";
+        cache->num_hits_ = cache_state.hits;
+        cache->num_misses_ = cache_state.misses;
+        cache->cycle_counter_ = cache_state.cycles;
+        for (std::size_t set = 0; set < cache->set_associativity_; ++set) {
+          for (std::size_t line_idx = 0; line_idx < cache->num_lines_;
+               ++line_idx) {
+            const std::size_t line =
+                line_idx * cache->set_associativity_ + set;
+            const CacheLineState line_state = reader.Read<CacheLineState>();
+            cache->tags_[line] =
+                line_state.valid ? line_state.tag : CacheBase::kInvalidTag;
+            cache->fill_starts_[line] =
+                cache->cycle_counter_ -
+                std::min<std::size_t>(line_state.swapin_counter,
+                                      cache->cycle_counter_);
+            cache->dirty_[line] = line_state.dirty;
+            std::memcpy(cache->LineData(line),
+                        reader.Bytes(cache->line_size_bytes_),
+                        cache->line_size_bytes_);
+            reader.Seek(AlignUp(reader.Offset(), kAlignment));
+          }
+        }
+        std::memcpy(policy_state.data(),
+                    reader.Bytes(policy_state.size() * sizeof(uint32_t)),
+                    policy_state.size() * sizeof(uint32_t));
+      } break;
+      default:
+        VLOG(1) << "Skipping unknown checkpoint section "
+                << section_header.type;
+        break;
+    }
+    reader.Seek(section_end);
+  }
+
+  // Breakpoints and decoded instructions must be rebuilt from the new image
+  cpu.functional_core_->InvalidateDecodedInstructions();
+  VLOG(1) << "Restored checkpoint " << path;
+}
@@ -68,7 +68,10 @@ CommandPtr CommandInterpreter::CommandFactory::Create(
       {std::string("br"), Command_SetBreakpoint},
       {std::string("del"), Command_DeleteBreakpoint},
       {std::string("sbr"), Command_ShowBreakpoints},
-      {std::string("stat"), Command_Stats}};
+      {std::string("stat"), Command_Stats},
+      {std::string("mode"), Command_Mode},
+      {std::string("ckpt"), Command_Checkpoint},
+      {std::string("restore"), Command_Restore}};
 
   // Check if command is valid
   const auto ite = COMMANDS.find(command_op_string);
@@ -111,6 +114,14 @@ CommandPtr CommandInterpreter::CommandFactory::Create(
       return std::make_shared<ShowStatsCommand>(
           ShowStatsCommand(command_string, cpu_, cpu_->GetDataHazardDetector(),
                            cpu_->GetControlHazardDetector()));
+    case Command_Mode:
+      return std::make_shared<ModeCommand>(ModeCommand(command_string, cpu_));
+    case Command_Checkpoint:
+      return std::make_shared<CheckpointCommand>(
+          CheckpointCommand(command_string, cpu_));
+    case Command_Restore:
+      return std::make_shared<RestoreCommand>(
+          RestoreCommand(command_string, cpu_));
     default:
       break;
   }
@@ -1,9 +1,14 @@
 #include <commands.hpp>
 
+#include <algorithm>
 #include <climits>
+#include <string>
+#include <vector>
 
+#include <checkpoint.hpp>
 #include <command_interpreter.hpp>
 #include <register_file.hpp>
+#include <store_buffer.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
 CommandBase::CommandBase(const char* mnemonic, const char* command_name,
@@ -72,12 +77,83 @@ ContinueCommand::ContinueCommand(const std::string& command, CpuPtr cpu)
 
 ////////////////////////////////////////////////////////////////////////////////
 void ContinueCommand::RunCommand() {
-  while (true) {
-    cpu_->ExecuteCycle();
-    if (cpu_->HitBreakpoint()) {
+  const char* stop_message = nullptr;
+  switch (cpu_->Run()) {
+    case FunctionalCore::StopReason::Breakpoint:
+      stop_message = "Hit breakpoint at ";
       break;
-    }
+    case FunctionalCore::StopReason::Halt:
+      stop_message = "Program halted at ";
+      break;
+    case FunctionalCore::StopReason::IllegalInstruction:
+      stop_message = "Illegal instruction at ";
+      break;
+    default:
+      break;
+  }
+  if (stop_message != nullptr) {
+    // Later commands print counts in decimal
+    std::cout << stop_message << std::hex << std::showbase
+              << cpu_->GetPC()->InstructionPointer() << std::dec
+              << std::noshowbase << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ModeCommand::ModeCommand(const std::string& command, CpuPtr cpu)
+    : CommandBase("mode", "Set simulation mode",
+                  "Switch between functional and cycle accurate simulation. "
+                  "The pipeline is drained and caches flushed first.",
+                  command),
+      cpu_(cpu) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void ModeCommand::RunCommand() {
+  std::string mode_str;
+  std::cin >> mode_str;
+  if (mode_str == "functional") {
+    cpu_->SetMode(SimulationMode::Functional);
+  } else if (mode_str == "cycle") {
+    cpu_->SetMode(SimulationMode::Cycle);
+  } else {
+    std::cout << "Unknown mode: " << mode_str << std::endl;
   }
+  std::cout << "Mode: "
+            << (cpu_->GetMode() == SimulationMode::Functional ? "functional"
+                                                              : "cycle")
+            << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CheckpointCommand::CheckpointCommand(const std::string& command, CpuPtr cpu)
+    : CommandBase("ckpt", "Save checkpoint",
+                  "Save registers, memories and caches to a file. The "
+                  "pipeline is drained first.",
+                  command),
+      cpu_(cpu) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void CheckpointCommand::RunCommand() {
+  std::string path;
+  std::cin >> path;
+  Checkpoint::Save(*cpu_, path);
+  std::cout << "Saved checkpoint to " << path << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RestoreCommand::RestoreCommand(const std::string& command, CpuPtr cpu)
+    : CommandBase("restore", "Restore checkpoint",
+                  "Restore registers, memories and caches from a file saved "
+                  "with ckpt",
+                  command),
+      cpu_(cpu) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void RestoreCommand::RunCommand() {
+  std::string path;
+  std::cin >> path;
+  Checkpoint::Restore(*cpu_, path);
+  std::cout << "Restored checkpoint from " << path << std::endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -154,7 +230,7 @@ ShowStatsCommand::ShowStatsCommand(const std::string& command, CpuPtr cpu,
 void ShowStatsCommand::RunCommand() {
   std::cout << "Cycles Executed: " << cpu_->GetCycles() << std::endl
             << "Instructions Executed: "
-            << cpu_->GetPipeline()->InstructionsCompleted() << std::endl
+            << cpu_->InstructionsCompleted() << std::endl
             << "CPI: " << cpu_->GetCPI() << std::endl
             << "Data Hazards: " << data_hazard_unit_->HazardsDetected()
             << std::endl
@@ -164,4 +240,62 @@ void ShowStatsCommand::RunCommand() {
             << std::endl
             << "Delay added from control hazards: "
             << control_hazard_unit_->DelayAdded() << std::endl;
+
+  // Caches by level, naming a level shared by both ports once without a side
+  const MemoryPtr ports[] = {cpu_->GetInstrMem(), cpu_->GetDataMem()};
+  const char* const kPortNames[] = {"I", "D"};
+  std::vector<std::vector<const CacheBase*>> levels(2);
+  for (std::size_t port = 0; port < 2; ++port) {
+    for (const MemoryBase* level = ports[port].get(); level != nullptr;
+         level = level->NextLevel()) {
+      if (const auto* cache = dynamic_cast<const CacheBase*>(level)) {
+        levels[port].push_back(cache);
+      } else if (const auto* store_buffer =
+                     dynamic_cast<const StoreBuffer*>(level)) {
+        std::cout << "Store Buffer Stores: " << std::dec
+                  << store_buffer->GetStores()
+                  << " Coalesced: " << store_buffer->GetCoalescedStores()
+                  << " Forwarded Loads: "
+                  << store_buffer->GetForwardedLoads()
+                  << " Full Stalls: " << store_buffer->GetFullStalls()
+                  << std::endl;
+      }
+    }
+  }
+  const std::size_t num_levels =
+      std::max(levels[0].size(), levels[1].size());
+  for (std::size_t level = 0; level < num_levels; ++level) {
+    for (std::size_t port = 0; port < 2; ++port) {
+      if (level >= levels[port].size()) {
+        continue;
+      }
+      const CacheBase* cache = levels[port][level];
+      const bool shared =
+          std::find(levels[1 - port].cbegin(), levels[1 - port].cend(),
+                    cache) != levels[1 - port].cend();
+      if (shared && port != 0) {
+        continue;
+      }
+      const std::string name =
+          "L" + std::to_string(level + 1) + (shared ? "" : kPortNames[port]);
+      std::cout << name << " Hits: " << std::dec << cache->GetHits()
+                << " Misses: " << cache->GetMisses()
+                << " Writebacks: " << cache->GetWritebacks()
+                << " Back Invalidations: " << cache->GetBackInvalidations()
+                << std::endl;
+      if (cache->HasPrefetcher()) {
+        std::cout << name << " Prefetches: " << cache->GetPrefetches()
+                  << " Useful: " << cache->GetUsefulPrefetches()
+                  << " Late: " << cache->GetLatePrefetches()
+                  << " Accuracy: " << cache->GetPrefetchAccuracy()
+                  << " Coverage: " << cache->GetPrefetchCoverage()
+                  << std::endl;
+      }
+      if (cache->GetMSHRs() > 0) {
+        std::cout << name << " MSHRs: " << cache->GetMSHRs()
+                  << " Merged: " << cache->GetMSHRMerges()
+                  << " Stalls: " << cache->GetMSHRStalls() << std::endl;
+      }
+    }
+  }
 }
@@ -6,16 +6,22 @@
 #include <register_file.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
-CPU::CPU(MemoryPtr instr_mem, MemoryPtr data_mem)
-    : HardwareObject(), instr_mem_(instr_mem), data_mem_(data_mem) {
+CPU::CPU(MemoryPtr instr_mem, MemoryPtr data_mem, SimulationMode mode,
+         MemoryPtr code_mem)
+    : HardwareObject(),
+      instr_mem_(instr_mem),
+      data_mem_(data_mem),
+      mode_(mode) {
   reg_file_ = std::make_shared<RegisterFile>(RegisterFile());
   pc_ = std::make_shared<ProgramCounter>(ProgramCounter());
-  pipeline_ = std::make_shared<Pipeline>(
-      Pipeline(reg_file_, pc_, instr_mem_, data_mem_));
+  pipeline_ =
+      std::make_shared<Pipeline>(reg_file_, pc_, instr_mem_, data_mem_);
   data_hazard_detector_ = std::make_shared<DataHazardDetectionUnit>(
       DataHazardDetectionUnit(pipeline_));
   control_hazard_detector_ = std::make_shared<ControlHazardDetectionUnit>(
       ControlHazardDetectionUnit(pipeline_));
+  functional_core_ = std::make_shared<FunctionalCore>(
+      reg_file_, pc_, instr_mem_, data_mem_, code_mem);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,6 +36,12 @@ PcPtr CPU::GetPC() const { return pc_; }
 ////////////////////////////////////////////////////////////////////////////////
 PipelinePtr CPU::GetPipeline() const { return pipeline_; }
 
+////////////////////////////////////////////////////////////////////////////////
+MemoryPtr CPU::GetInstrMem() const { return instr_mem_; }
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryPtr CPU::GetDataMem() const { return data_mem_; }
+
 ////////////////////////////////////////////////////////////////////////////////
 HazardDetectionPtr CPU::GetDataHazardDetector() const {
   return data_hazard_detector_;
@@ -41,38 +53,216 @@ HazardDetectionPtr CPU::GetControlHazardDetector() const {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CPU::ExecuteCycle() {
-  if (!at_bkpt_ &&
-      std::any_of(bkpts_.cbegin(), bkpts_.cend(), [&](const Breakpoint& bkpt) {
+bool CPU::AtBreakpoint() const {
+  return std::any_of(
+      bkpts_.cbegin(), bkpts_.cend(), [&](const Breakpoint& bkpt) {
         return bkpt.second == pc_->InstructionPointer();
-      })) {
+      });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <>
+bool CPU::Step<SimulationMode::Cycle>() {
+  const bool check_hazards = pipeline_->CheckHazards();
+  data_mem_->ExecuteCycle();
+  instr_mem_->ExecuteCycle();
+  pipeline_->ExecuteCycle();
+  bool halted = false;
+  if (check_hazards) {
+    const std::size_t control_hazards =
+        control_hazard_detector_->HazardsDetected();
+    control_hazard_detector_->HandleHazard();
+    // A taken branch or jump back onto itself ends the program
+    halted = (control_hazard_detector_->HazardsDetected() != control_hazards &&
+              pc_->InstructionPointer() ==
+                  pipeline_->Instruction(Pipeline::Stages::MemoryAccessStage)
+                      ->InstructionAddress());
+    data_hazard_detector_->HandleHazard();
+  }
+  HardwareObject::ExecuteCycle();
+  return halted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <>
+bool CPU::Step<SimulationMode::Functional>() {
+  const FunctionalCore::StopReason stop_reason = functional_core_->Run(1);
+  HardwareObject::ExecuteCycle();
+  return (stop_reason == FunctionalCore::StopReason::Halt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CPU::CyclesUntilEvent() const {
+  if (mode_ == SimulationMode::Functional) {
+    return 0;
+  }
+  return std::min({pipeline_->CyclesUntilEvent(),
+                   instr_mem_->CyclesUntilEvent(),
+                   data_mem_->CyclesUntilEvent()});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::SkipCycles(std::size_t num_cycles) {
+  data_mem_->SkipCycles(num_cycles);
+  instr_mem_->SkipCycles(num_cycles);
+  pipeline_->SkipCycles(num_cycles);
+  HardwareObject::SkipCycles(num_cycles);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::SkipIdleCycles() {
+  const std::size_t idle_cycles = CyclesUntilEvent();
+  if (idle_cycles > 0) {
+    VLOG(4) << "Skipping " << idle_cycles << " idle cycles";
+    SkipCycles(idle_cycles);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::ExecuteCycle() {
+  if (!at_bkpt_ && AtBreakpoint()) {
     VLOG(1) << "Hit breakpoint";
     at_bkpt_ = true;
   } else {
     at_bkpt_ = false;
-    const bool check_hazards = pipeline_->CheckHazards();
-    data_mem_->ExecuteCycle();
-    instr_mem_->ExecuteCycle();
-    pipeline_->ExecuteCycle();
-    if (check_hazards) {
-      control_hazard_detector_->HandleHazard();
-      data_hazard_detector_->HandleHazard();
+    if (mode_ == SimulationMode::Functional) {
+      Step<SimulationMode::Functional>();
+    } else {
+      Step<SimulationMode::Cycle>();
     }
-    HardwareObject::ExecuteCycle();  // TODO: to exe or not exe at bkpt?
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+template <>
+FunctionalCore::StopReason CPU::RunMode<SimulationMode::Cycle>(
+    std::size_t max_instructions) {
+  // A breakpoint at the current PC has already been reported, so allow the
+  // pipeline to fetch past it.
+  bool skip_bkpt = at_bkpt_;
+  const mem_addr_t bkpt_pc = pc_->InstructionPointer();
+  at_bkpt_ = false;
+
+  const std::size_t start_instructions = pipeline_->InstructionsCompleted();
+  while (pipeline_->InstructionsCompleted() - start_instructions <
+         max_instructions) {
+    skip_bkpt = skip_bkpt && (pc_->InstructionPointer() == bkpt_pc);
+    if (!skip_bkpt && AtBreakpoint()) {
+      VLOG(1) << "Hit breakpoint";
+      at_bkpt_ = true;
+      return FunctionalCore::StopReason::Breakpoint;
+    }
+    SkipIdleCycles();
+    if (Step<SimulationMode::Cycle>()) {
+      DrainPipeline();
+      return FunctionalCore::StopReason::Halt;
+    }
+  }
+  return FunctionalCore::StopReason::InstructionLimit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <>
+FunctionalCore::StopReason CPU::RunMode<SimulationMode::Functional>(
+    std::size_t max_instructions) {
+  if (!at_bkpt_ && AtBreakpoint()) {
+    VLOG(1) << "Hit breakpoint";
+    at_bkpt_ = true;
+    return FunctionalCore::StopReason::Breakpoint;
+  }
+
+  // The core steps over a breakpoint on its first instruction
+  const std::size_t start_instructions =
+      functional_core_->InstructionsRetired();
+  const FunctionalCore::StopReason stop_reason =
+      functional_core_->Run(max_instructions);
+  cycle_counter_ +=
+      functional_core_->InstructionsRetired() - start_instructions;
+  at_bkpt_ = (stop_reason == FunctionalCore::StopReason::Breakpoint);
+  if (at_bkpt_) {
+    VLOG(1) << "Hit breakpoint";
+  }
+  return stop_reason;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason CPU::Run(std::size_t max_instructions) {
+  if (mode_ == SimulationMode::Functional) {
+    return RunMode<SimulationMode::Functional>(max_instructions);
+  } else {
+    return RunMode<SimulationMode::Cycle>(max_instructions);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::DrainPipeline() {
+  pipeline_->SetFetchEnabled(false);
+  while (!pipeline_->IsEmpty()) {
+    SkipIdleCycles();
+    Step<SimulationMode::Cycle>();
+  }
+  pipeline_->SetFetchEnabled(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::SetMode(SimulationMode mode) {
+  if (mode == mode_) {
+    return;
+  }
+  if (mode_ == SimulationMode::Cycle) {
+    DrainPipeline();
+  }
+  // The functional core works on main memory directly, so dirty lines must
+  // reach it and lines cached before the switch may have gone stale.
+  instr_mem_->Flush();
+  data_mem_->Flush();
+  functional_core_->InvalidateDecodedInstructions();
+  mode_ = mode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SimulationMode CPU::GetMode() const { return mode_; }
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason CPU::WarmUp(std::size_t num_instructions) {
+  CHECK(mode_ == SimulationMode::Functional)
+      << "Warm up must start in functional mode";
+  const std::size_t start_instructions =
+      functional_core_->InstructionsRetired();
+  const FunctionalCore::StopReason stop_reason =
+      functional_core_->Warm(num_instructions);
+  cycle_counter_ +=
+      functional_core_->InstructionsRetired() - start_instructions;
+  at_bkpt_ = (stop_reason == FunctionalCore::StopReason::Breakpoint);
+  mode_ = SimulationMode::Cycle;
+  return stop_reason;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CPU::SetJitEnabled(bool enabled) {
+  functional_core_->SetJitEnabled(enabled);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CPU::Reset() {
   reg_file_->Reset();
   pc_->Reset();
   pipeline_->Reset();
+  data_hazard_detector_->Reset();
+  functional_core_->Reset();
+  at_bkpt_ = false;
   HardwareObject::Reset();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CPU::InstructionsCompleted() const {
+  return pipeline_->InstructionsCompleted() +
+         functional_core_->InstructionsRetired();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 double CPU::GetCPI() const {
-  const std::size_t instructions_completed = pipeline_->InstructionsCompleted();
+  const std::size_t instructions_completed = InstructionsCompleted();
   if (instructions_completed == 0) {
     return 0.0;
   } else {
@@ -84,12 +274,27 @@ double CPU::GetCPI() const {
 void CPU::SetBreakpoint(mem_addr_t breakpoint_address) {
   bkpts_.push_back(
       std::make_pair(static_cast<int>(bkpts_.size()), breakpoint_address));
+  functional_core_->SetBreakpoint(breakpoint_address);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CPU::DeleteBreakpoint(int bkpt_num) {
+  const auto bkpt_ite = std::find_if(
+      bkpts_.cbegin(), bkpts_.cend(),
+      [&](const Breakpoint& bkpt) { return bkpt.first == bkpt_num; });
+  if (bkpt_ite == bkpts_.cend()) {
+    return;
+  }
+  const mem_addr_t bkpt_addr = bkpt_ite->second;
   bkpts_.erase(
       std::remove_if(bkpts_.begin(), bkpts_.end(),
                      [&](Breakpoint& bkpt) { return bkpt.first == bkpt_num; }),
       bkpts_.end());
+
+  // Several breakpoints may share an address; only the last one clears it.
+  if (std::none_of(bkpts_.cbegin(), bkpts_.cend(), [&](const Breakpoint& bkpt) {
+        return bkpt.second == bkpt_addr;
+      })) {
+    functional_core_->ClearBreakpoint(bkpt_addr);
+  }
 }
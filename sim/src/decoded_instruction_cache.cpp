@@ -0,0 +1,94 @@
+#include <decoded_instruction_cache.hpp>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+////////////////////////////////////////////////////////////////////////////////
+DecodedInstructionCache::DecodedInstructionCache(RegFilePtr reg_file, PcPtr pc,
+                                                 MemoryPtr data_mem,
+                                                 std::size_t num_entries)
+    : instruction_factory_(reg_file, pc, data_mem),
+      entries_(num_entries),
+      index_mask_(num_entries - 1) {
+  CHECK(num_entries != 0 && (num_entries & (num_entries - 1)) == 0)
+      << "Decoded instruction cache size must be a power of two";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+DecodedInstructionCache::Entry& DecodedInstructionCache::Lookup(
+    mem_addr_t instr_addr) {
+  const std::size_t entry_idx = (instr_addr / sizeof(instr_t)) & index_mask_;
+  return entries_[entry_idx];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+InstructionInterface* DecodedInstructionCache::Fetch(mem_addr_t instr_addr,
+                                                     instr_t instr) {
+  Entry& entry = Lookup(instr_addr);
+  if (!entry.decoded.empty() && entry.instr_addr == instr_addr &&
+      entry.instr == instr) {
+    ++num_hits_;
+    for (const InstructionPtr& decoded : entry.decoded) {
+      if (!decoded->InFlight()) {
+        return decoded.get();
+      }
+    }
+    // Every copy is still in the pipeline (e.g. a single instruction loop).
+  } else {
+    ++num_misses_;
+    VLOG(4) << "Decoded instruction cache miss at " << std::hex
+            << std::showbase << instr_addr;
+    Retire(entry);
+    entry.instr_addr = instr_addr;
+    entry.instr = instr;
+  }
+  InstructionPtr decoded = instruction_factory_.Create(instr);
+  decoded->SetInstructionAddress(instr_addr);
+  entry.decoded.push_back(decoded);
+  return decoded.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DecodedInstructionCache::Retire(Entry& entry) {
+  SweepRetired();
+  ReleaseCopies(entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DecodedInstructionCache::ReleaseCopies(Entry& entry) {
+  for (InstructionPtr& decoded : entry.decoded) {
+    if (decoded->InFlight()) {
+      retired_.push_back(std::move(decoded));
+    }
+  }
+  entry.decoded.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DecodedInstructionCache::SweepRetired() {
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [](const InstructionPtr& decoded) {
+                                  return !decoded->InFlight();
+                                }),
+                 retired_.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DecodedInstructionCache::Invalidate(mem_addr_t instr_addr) {
+  Entry& entry = Lookup(instr_addr);
+  if (entry.instr_addr == instr_addr) {
+    Retire(entry);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DecodedInstructionCache::Clear() {
+  // One sweep for the whole table rather than one per entry
+  for (auto& entry : entries_) {
+    ReleaseCopies(entry);
+  }
+  SweepRetired();
+  num_hits_ = 0;
+  num_misses_ = 0;
+}
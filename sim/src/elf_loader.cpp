@@ -0,0 +1,214 @@
+#include <elf_loader.hpp>
+
+#include <elf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <glog/logging.h>
+
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+
+namespace {
+
+// Instruction memory starts on a page boundary at or below the code
+constexpr mem_addr_t kCodePageSize{1 << 12};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+ElfImage::ElfImage(const std::string& path) : path_(path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  CHECK(stream.is_open()) << "Couldn't open " << path;
+  file_.assign(std::istreambuf_iterator<char>(stream),
+               std::istreambuf_iterator<char>());
+
+  const Elf32_Ehdr header = ReadHeader<Elf32_Ehdr>(0);
+  CHECK(std::memcmp(header.e_ident, ELFMAG, SELFMAG) == 0)
+      << path << " is not an ELF file";
+  CHECK(header.e_ident[EI_CLASS] == ELFCLASS32 &&
+        header.e_ident[EI_DATA] == ELFDATA2LSB)
+      << path << " is not a little endian ELF32 file";
+  CHECK(header.e_machine == EM_RISCV) << path << " is not a RISC-V program";
+  CHECK(header.e_type == ET_EXEC) << path << " is not an executable";
+  entry_point_ = header.e_entry;
+
+  for (std::size_t ii = 0; ii < header.e_phnum; ++ii) {
+    const Elf32_Phdr program_header = ReadHeader<Elf32_Phdr>(
+        header.e_phoff + ii * header.e_phentsize);
+    if (program_header.p_type != PT_LOAD) {
+      continue;
+    }
+    CHECK(program_header.p_filesz <= program_header.p_memsz &&
+          program_header.p_offset + program_header.p_filesz <= file_.size())
+        << path << " has a malformed segment";
+    segments_.push_back(Segment{program_header.p_vaddr,
+                                program_header.p_offset,
+                                program_header.p_filesz,
+                                program_header.p_memsz,
+                                (program_header.p_flags & PF_X) != 0});
+  }
+  CHECK(!segments_.empty()) << path << " has nothing to load";
+
+  ReadSymbols(header.e_shoff, header.e_shnum, header.e_shentsize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ElfImage::IsElf(const std::string& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  char magic[SELFMAG] = {};
+  return stream.read(magic, SELFMAG) &&
+         std::memcmp(magic, ELFMAG, SELFMAG) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryPtr ElfImage::LoadProgram(const std::string& path, std::size_t latency,
+                                MainMemoryBase& data_mem,
+                                mem_addr_t& entry_point) {
+  if (!IsElf(path)) {
+    entry_point = 0;
+    return std::make_shared<InstructionMemory>(
+        InstructionMemory(path, latency));
+  }
+
+  const ElfImage image(path);
+  const mem_addr_t code_base = image.CodeBase() & ~(kCodePageSize - 1);
+  const std::size_t code_end =
+      (image.CodeEnd() + sizeof(instr_t) - 1) & ~(sizeof(instr_t) - 1);
+  const std::size_t code_size =
+      std::min(std::max(InstructionMemory::kDefaultMemSize,
+                        code_end - code_base),
+               MainMemoryBase::kAddressSpaceSize - code_base);
+  auto instr_mem = std::make_shared<InstructionMemory>(
+      InstructionMemory(latency, code_size, code_base));
+  image.Load(*instr_mem, data_mem);
+  entry_point = image.EntryPoint();
+  return instr_mem;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ElfImage::Load(MainMemoryBase& instr_mem,
+                    MainMemoryBase& data_mem) const {
+  for (const Segment& segment : segments_) {
+    LoadSegment(segment, data_mem);
+    if (segment.executable && &instr_mem != &data_mem) {
+      LoadSegment(segment, instr_mem);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mem_addr_t ElfImage::CodeBase() const {
+  std::size_t code_base = MainMemoryBase::kAddressSpaceSize;
+  for (const Segment& segment : segments_) {
+    if (segment.executable) {
+      code_base = std::min<std::size_t>(code_base, segment.addr);
+    }
+  }
+  return (code_base < MainMemoryBase::kAddressSpaceSize) ? code_base : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t ElfImage::CodeEnd() const {
+  std::size_t code_end = 0;
+  for (const Segment& segment : segments_) {
+    if (segment.executable) {
+      code_end = std::max(code_end, segment.addr + segment.mem_size);
+    }
+  }
+  return code_end;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const ElfImage::Symbol* ElfImage::SymbolAt(mem_addr_t addr) const {
+  auto ite = std::upper_bound(
+      symbols_.cbegin(), symbols_.cend(), addr,
+      [](mem_addr_t lhs, const Symbol& rhs) { return lhs < rhs.addr; });
+  while (ite != symbols_.cbegin()) {
+    --ite;
+    // Sized symbols cover their extent, others only their own address
+    if (addr - ite->addr < std::max<uint32_t>(ite->size, 1)) {
+      return &*ite;
+    }
+    if (ite->addr != addr && ite->size > 0) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const ElfImage::Symbol* ElfImage::FindSymbol(const std::string& name) const {
+  const auto ite =
+      std::find_if(symbols_.cbegin(), symbols_.cend(),
+                   [&](const Symbol& symbol) { return symbol.name == name; });
+  return (ite != symbols_.cend()) ? &*ite : nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename header_t>
+header_t ElfImage::ReadHeader(std::size_t offset) const {
+  CHECK(offset + sizeof(header_t) <= file_.size())
+      << path_ << " is truncated";
+  header_t header;
+  std::memcpy(&header, file_.data() + offset, sizeof(header));
+  return header;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ElfImage::LoadSegment(const Segment& segment, MainMemoryBase& mem) const {
+  if (segment.mem_size == 0) {
+    return;
+  }
+  uint8_t* const dest = mem.Span(segment.addr, segment.mem_size);
+  std::memcpy(dest, file_.data() + segment.file_offset, segment.file_size);
+  std::memset(dest + segment.file_size, 0,
+              segment.mem_size - segment.file_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ElfImage::ReadSymbols(std::size_t section_offset,
+                           std::size_t num_sections,
+                           std::size_t section_size) {
+  for (std::size_t ii = 0; ii < num_sections; ++ii) {
+    const Elf32_Shdr symbol_table =
+        ReadHeader<Elf32_Shdr>(section_offset + ii * section_size);
+    if (symbol_table.sh_type != SHT_SYMTAB || symbol_table.sh_entsize == 0) {
+      continue;
+    }
+    const Elf32_Shdr string_table = ReadHeader<Elf32_Shdr>(
+        section_offset + symbol_table.sh_link * section_size);
+    CHECK(string_table.sh_offset + string_table.sh_size <= file_.size())
+        << path_ << " has a malformed string table";
+    const char* const names =
+        reinterpret_cast<const char*>(file_.data() + string_table.sh_offset);
+
+    const std::size_t num_symbols =
+        symbol_table.sh_size / symbol_table.sh_entsize;
+    for (std::size_t sym = 0; sym < num_symbols; ++sym) {
+      const Elf32_Sym symbol = ReadHeader<Elf32_Sym>(
+          symbol_table.sh_offset + sym * symbol_table.sh_entsize);
+      const unsigned type = ELF32_ST_TYPE(symbol.st_info);
+      if ((type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE) ||
+          symbol.st_shndx == SHN_UNDEF ||
+          symbol.st_name >= string_table.sh_size) {
+        continue;
+      }
+      const std::size_t name_length =
+          strnlen(names + symbol.st_name,
+                  string_table.sh_size - symbol.st_name);
+      if (name_length > 0) {
+        symbols_.push_back(
+            Symbol{std::string(names + symbol.st_name, name_length),
+                   symbol.st_value, symbol.st_size});
+      }
+    }
+  }
+  std::stable_sort(
+      symbols_.begin(), symbols_.end(),
+      [](const Symbol& lhs, const Symbol& rhs) { return lhs.addr < rhs.addr; });
+}
@@ -0,0 +1,209 @@
+#include <event_trace.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include <instruction_factory.hpp>
+
+constexpr std::size_t Tracer::kRingSize;
+constexpr bool Tracer::kCompiledIn;
+constexpr uint32_t Tracer::kVersion;
+
+std::atomic<uint32_t> Tracer::enabled_mask_{0};
+
+namespace {
+
+constexpr const char* kCategoryNames[] = {"fetch", "hazard", "cache", "mem"};
+static_assert(sizeof(kCategoryNames) / sizeof(kCategoryNames[0]) ==
+                  static_cast<std::size_t>(TraceCategory::NumCategories),
+              "Every trace category needs a name");
+
+struct EventFormat {
+  const char* name;
+  const char* arg0_label;
+  const char* arg1_label;
+};
+
+constexpr EventFormat kEventFormats[] = {
+    {"fetch", "pc", ""},
+    {"retire", "pc", ""},
+    {"forward", "pc", "x"},
+    {"load_use", "pc", "x"},
+    {"flush", "pc", "stages="},
+    {"cache_hit", "addr", "set="},
+    {"cache_miss", "addr", "set="},
+    {"writeback", "addr", "bytes="},
+    {"prefetch", "addr", "cycles="},
+    {"mem_read", "addr", "bytes="},
+    {"mem_write", "addr", "bytes="}};
+static_assert(sizeof(kEventFormats) / sizeof(kEventFormats[0]) ==
+                  static_cast<std::size_t>(TraceEvent::NumEvents),
+              "Every trace event needs a format");
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::Enable(TraceCategory category, bool enabled) {
+  const uint32_t bit = 1u << static_cast<unsigned>(category);
+  if (enabled) {
+    enabled_mask_.fetch_or(bit, std::memory_order_relaxed);
+  } else {
+    enabled_mask_.fetch_and(~bit, std::memory_order_relaxed);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::EnableCategories(const std::string& categories) {
+  std::stringstream stream(categories);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    bool found = false;
+    for (std::size_t category = 0;
+         category < static_cast<std::size_t>(TraceCategory::NumCategories);
+         ++category) {
+      if (name == kCategoryNames[category]) {
+        Enable(static_cast<TraceCategory>(category));
+        found = true;
+      }
+    }
+    CHECK(found) << "Unknown trace category: " << name;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::Record(TraceCategory category, TraceEvent event, uint64_t cycle,
+                    uint32_t arg0, uint32_t arg1) {
+  Ring& ring = ThisThread();
+  TraceRecord& record = ring.records[ring.num_recorded++ & (kRingSize - 1)];
+  record.cycle = cycle;
+  record.arg0 = arg0;
+  record.arg1 = arg1;
+  record.category = category;
+  record.event = event;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::Dump(const std::string& path) {
+  std::ofstream stream(path, std::ios::out | std::ios::binary);
+  CHECK(stream.is_open()) << "Couldn't open event trace " << path;
+
+  Registry& registry = Rings();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  FileHeader header;
+  header.num_threads = registry.rings.size();
+  stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const RingPtr& ring : registry.rings) {
+    ThreadHeader thread_header;
+    thread_header.thread_index = ring->thread_index;
+    thread_header.num_records =
+        std::min<uint64_t>(ring->num_recorded, kRingSize);
+    stream.write(reinterpret_cast<const char*>(&thread_header),
+                 sizeof(thread_header));
+    // Once the ring has wrapped the oldest record is the next to be replaced
+    const uint64_t first = ring->num_recorded - thread_header.num_records;
+    for (uint64_t idx = first; idx < ring->num_recorded; ++idx) {
+      stream.write(reinterpret_cast<const char*>(
+                       &ring->records[idx & (kRingSize - 1)]),
+                   sizeof(TraceRecord));
+    }
+  }
+  CHECK(stream.good()) << "Failed to write event trace " << path;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::Decode(const std::string& path, std::ostream& out_stream) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  CHECK(stream.is_open()) << "Couldn't open event trace " << path;
+
+  FileHeader header;
+  const FileHeader expected{};
+  stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+  CHECK(stream.good() &&
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0)
+      << path << " is not an event trace";
+  CHECK(header.version == kVersion)
+      << "Unsupported event trace version " << header.version;
+
+  // Only used to disassemble instruction words
+  InstructionFactory factory(nullptr, nullptr, nullptr);
+  for (uint32_t thread = 0; thread < header.num_threads; ++thread) {
+    ThreadHeader thread_header;
+    stream.read(reinterpret_cast<char*>(&thread_header),
+                sizeof(thread_header));
+    CHECK(stream.good()) << "Truncated event trace";
+    out_stream << "thread " << thread_header.thread_index << '\n';
+    for (uint64_t idx = 0; idx < thread_header.num_records; ++idx) {
+      TraceRecord record;
+      stream.read(reinterpret_cast<char*>(&record), sizeof(record));
+      CHECK(stream.good()) << "Truncated event trace";
+      CHECK(record.event < TraceEvent::NumEvents &&
+            record.category < TraceCategory::NumCategories)
+          << "Corrupt event trace record";
+
+      const EventFormat& format =
+          kEventFormats[static_cast<std::size_t>(record.event)];
+      out_stream << std::dec << std::setw(10) << record.cycle << ' '
+                 << std::left << std::setw(6) << CategoryName(record.category)
+                 << ' ' << std::setw(10) << format.name << std::right << ' '
+                 << format.arg0_label << "=0x" << std::hex << record.arg0
+                 << ' ';
+      if (record.event == TraceEvent::Fetch ||
+          record.event == TraceEvent::Retire) {
+        const InstructionPtr instr = factory.Create(record.arg1);
+        if (instr != nullptr) {
+          out_stream << instr->InstructionName();
+        } else {
+          out_stream << "0x" << record.arg1;
+        }
+      } else {
+        out_stream << format.arg1_label << std::dec << record.arg1;
+      }
+      out_stream << '\n';
+    }
+  }
+  out_stream.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Tracer::Clear() {
+  Registry& registry = Rings();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const RingPtr& ring : registry.rings) {
+    ring->num_recorded = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* Tracer::CategoryName(TraceCategory category) {
+  return kCategoryNames[static_cast<std::size_t>(category)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* Tracer::EventName(TraceEvent event) {
+  return kEventFormats[static_cast<std::size_t>(event)].name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Tracer::Ring& Tracer::ThisThread() {
+  // The registry shares ownership so a thread's records outlive it
+  thread_local RingPtr ring;
+  if (ring == nullptr) {
+    ring = std::make_shared<Ring>();
+    Registry& registry = Rings();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    ring->thread_index = registry.rings.size();
+    registry.rings.push_back(ring);
+  }
+  return *ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Tracer::Registry& Tracer::Rings() {
+  static Registry registry;
+  return registry;
+}
@@ -0,0 +1,28 @@
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <event_trace.hpp>
+
+// Dump written by riscv_sim --event_trace
+DEFINE_string(event_trace, "", "Event trace to decode");
+DEFINE_string(output, "", "File to write decoded events to (default stdout)");
+
+int main(int argc, char* argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  CHECK(!FLAGS_event_trace.empty()) << "--event_trace is required";
+
+  if (FLAGS_output.empty()) {
+    Tracer::Decode(FLAGS_event_trace, std::cout);
+  } else {
+    std::ofstream out_stream(FLAGS_output);
+    CHECK(out_stream.is_open()) << "Couldn't open " << FLAGS_output;
+    Tracer::Decode(FLAGS_event_trace, out_stream);
+  }
+  return 0;
+}
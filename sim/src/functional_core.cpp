@@ -0,0 +1,678 @@
+#include <functional_core.hpp>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <b_type_instructions.hpp>
+#include <i_type_instructions.hpp>
+#include <instructions.hpp>
+#include <jit_translator.hpp>
+#include <j_type_instructions.hpp>
+#include <r_type_instructions.hpp>
+#include <s_type_instructions.hpp>
+#include <u_type_instructions.hpp>
+
+namespace {
+
+// Walks down through any caches to the main memory backing mem.
+MainMemoryBase* ResolveMainMemory(const MemoryPtr& mem) {
+  MemoryBase* level = mem.get();
+  while (level->NextLevel() != nullptr) {
+    level = level->NextLevel();
+  }
+  MainMemoryBase* main_mem = dynamic_cast<MainMemoryBase*>(level);
+  CHECK(main_mem != nullptr) << "Functional core requires a main memory";
+  return main_mem;
+}
+
+// Typed accesses through the MemoryBase interface, used when warming caches
+template <typename data_t>
+data_t PortRead(MemoryBase* mem, mem_addr_t addr) {
+  switch (sizeof(data_t)) {
+    case sizeof(uint8_t):
+      return static_cast<data_t>(mem->ReadByte(addr));
+    case sizeof(uint16_t):
+      return static_cast<data_t>(mem->ReadHalfWord(addr));
+    default:
+      return static_cast<data_t>(mem->ReadWord(addr));
+  }
+}
+
+template <typename data_t>
+void PortWrite(MemoryBase* mem, mem_addr_t addr, data_t data) {
+  switch (sizeof(data_t)) {
+    case sizeof(uint8_t):
+      mem->WriteByte(addr, static_cast<uint8_t>(data));
+      break;
+    case sizeof(uint16_t):
+      mem->WriteHalfWord(addr, static_cast<uint16_t>(data));
+      break;
+    default:
+      mem->WriteWord(addr, static_cast<uint32_t>(data));
+      break;
+  }
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::FunctionalCore(RegFilePtr reg_file, PcPtr pc,
+                               MemoryPtr instr_mem, MemoryPtr data_mem,
+                               MemoryPtr code_mem)
+    : reg_file_(reg_file),
+      pc_(pc),
+      instr_port_(instr_mem),
+      data_port_(data_mem),
+      instr_mem_(ResolveMainMemory(code_mem ? code_mem : instr_mem)),
+      data_mem_(ResolveMainMemory(data_mem)),
+      code_base_(instr_mem_->GetBase()) {
+  CHECK(data_mem_->GetBase() == 0) << "Data memory must start at address 0";
+  InvalidateDecodedInstructions();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::SetBreakpoint(mem_addr_t bkpt_addr) {
+  if (CodeOffset(bkpt_addr) / sizeof(instr_t) >= decoded_.size() - 1) {
+    return;
+  }
+  DecodedInstruction& decoded = DecodedAt(bkpt_addr);
+  if (decoded.op == Op_Breakpoint) {
+    return;
+  }
+  instr_t instr = 0;
+  std::memcpy(&instr, instr_mem_->Data() + CodeOffset(bkpt_addr),
+              sizeof(instr));
+  breakpoints_[bkpt_addr] = Decode(instr);
+  decoded.op = Op_Breakpoint;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::ClearBreakpoint(mem_addr_t bkpt_addr) {
+  const auto ite = breakpoints_.find(bkpt_addr);
+  if (ite == breakpoints_.end()) {
+    return;
+  }
+  DecodedAt(bkpt_addr) = ite->second;
+  breakpoints_.erase(ite);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::InvalidateDecodedInstructions() {
+  // One extra entry past the end of instruction memory catches the PC running
+  // off the end of the image without a bounds check per instruction.
+  const std::size_t num_instrs = instr_mem_->GetSize() / sizeof(instr_t);
+  decoded_.assign(num_instrs + 1, DecodedInstruction());
+  decoded_.back().op = Op_PcOutOfRange;
+
+  std::map<mem_addr_t, DecodedInstruction> breakpoints;
+  breakpoints.swap(breakpoints_);
+  for (const auto& bkpt : breakpoints) {
+    SetBreakpoint(bkpt.first);
+  }
+  if (jit_ != nullptr) {
+    jit_->Flush();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::SetJitEnabled(bool enabled) {
+  if (!enabled) {
+    jit_.reset();
+  } else if (jit_ == nullptr) {
+    if (JitTranslator::Supported()) {
+      jit_ = std::make_shared<JitTranslator>(*this);
+    } else {
+      LOG(WARNING) << "JIT is not supported on this host, interpreting";
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::Reset() {
+  InvalidateDecodedInstructions();
+  instructions_retired_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::DecodedInstruction& FunctionalCore::DecodedAt(
+    mem_addr_t instr_addr) {
+  return decoded_[CodeOffset(instr_addr) / sizeof(instr_t)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::DecodedInstruction FunctionalCore::Decode(instr_t instr) {
+  DecodedInstruction decoded;
+  decoded.op = Op_Illegal;
+
+  InstructionInterface::GenericInstructionFormat generic_format;
+  generic_format.word = instr;
+  ITypeInstructionInterface::ITypeInstructionFormat i_format;
+  i_format.word = instr;
+  RTypeInstructionInterface::RTypeInstructionFormat r_format;
+  r_format.word = instr;
+  const auto rd = [](instr_t rd_num) {
+    return static_cast<uint8_t>(rd_num ? rd_num : kZeroSinkRegister);
+  };
+  const Funct3 funct3 = static_cast<Funct3>(i_format.funct3);
+  const Funct7 funct7 = static_cast<Funct7>(r_format.funct7);
+  const imm_t i_imm = static_cast<imm_t>(instr) >> 20;
+
+  switch (static_cast<OpCode>(generic_format.opcode)) {
+    case OpCode::LUI:
+    case OpCode::AUIPC: {
+      UTypeInstructionInterface::UTypeInstructionFormat u_format;
+      u_format.word = instr;
+      decoded.op = (static_cast<OpCode>(generic_format.opcode) == OpCode::LUI)
+                       ? Op_Lui
+                       : Op_Auipc;
+      decoded.rd = rd(u_format.rd);
+      decoded.imm = static_cast<imm_t>(u_format.imm31_12 << 12);
+    } break;
+    case OpCode::JAL: {
+      JalInstruction::JTypeInstructionFormat j_format;
+      j_format.word = instr;
+      const imm_t imm_upper_11 = (j_format.imm20 ? -1 : 0) & ~(0xfffff);
+      decoded.op = Op_Jal;
+      decoded.rd = rd(j_format.rd);
+      decoded.imm = static_cast<imm_t>(
+          imm_upper_11 | (j_format.imm20 << 20) | (j_format.imm19_12 << 12) |
+          (j_format.imm11 << 11) | (j_format.imm10_1 << 1));
+    } break;
+    case OpCode::JALR:
+      decoded.op = Op_Jalr;
+      decoded.rd = rd(i_format.rd);
+      decoded.rs1 = i_format.rs1;
+      decoded.imm = i_imm;
+      break;
+    case OpCode::Bxx: {
+      BTypeInstructionInterface::BTypeInstructionFormat b_format;
+      b_format.word = instr;
+      const imm_t imm_upper_20 =
+          static_cast<imm_t>((b_format.imm12 ? -1 : 0)) & ~(0x1fff);
+      decoded.rs1 = b_format.rs1;
+      decoded.rs2 = b_format.rs2;
+      decoded.imm = static_cast<imm_t>(
+          imm_upper_20 | (b_format.imm12 << 12) | (b_format.imm11 << 11) |
+          (b_format.imm10_5 << 5) | (b_format.imm4_1 << 1));
+      switch (funct3) {
+        case Funct3::BEQ:
+          decoded.op = Op_Beq;
+          break;
+        case Funct3::BNE:
+          decoded.op = Op_Bne;
+          break;
+        case Funct3::BLT:
+          decoded.op = Op_Blt;
+          break;
+        case Funct3::BGE:
+          decoded.op = Op_Bge;
+          break;
+        case Funct3::BLTU:
+          decoded.op = Op_Bltu;
+          break;
+        case Funct3::BGEU:
+          decoded.op = Op_Bgeu;
+          break;
+        default:
+          break;
+      }
+    } break;
+    case OpCode::Lx:
+      decoded.rd = rd(i_format.rd);
+      decoded.rs1 = i_format.rs1;
+      decoded.imm = i_imm;
+      switch (funct3) {
+        case Funct3::LB:
+          decoded.op = Op_Lb;
+          break;
+        case Funct3::LH:
+          decoded.op = Op_Lh;
+          break;
+        case Funct3::LW:
+          decoded.op = Op_Lw;
+          break;
+        case Funct3::LBU:
+          decoded.op = Op_Lbu;
+          break;
+        case Funct3::LHU:
+          decoded.op = Op_Lhu;
+          break;
+        default:
+          break;
+      }
+      break;
+    case OpCode::Sx: {
+      STypeInstructionInterface::STypeInstructionFormat s_format;
+      s_format.word = instr;
+      decoded.rs1 = s_format.rs1;
+      decoded.rs2 = s_format.rs2;
+      decoded.imm = (static_cast<imm_t>(instr & 0xfe000000) >> 20) |
+                    static_cast<imm_t>(s_format.imm4_0);
+      switch (funct3) {
+        case Funct3::SB:
+          decoded.op = Op_Sb;
+          break;
+        case Funct3::SH:
+          decoded.op = Op_Sh;
+          break;
+        case Funct3::SW:
+          decoded.op = Op_Sw;
+          break;
+        default:
+          break;
+      }
+    } break;
+    case OpCode::ITypeArithmeticAndLogical:
+      decoded.rd = rd(i_format.rd);
+      decoded.rs1 = i_format.rs1;
+      decoded.imm = i_imm;
+      switch (funct3) {
+        case Funct3::ADDI:
+          decoded.op = Op_Addi;
+          break;
+        case Funct3::SLTI:
+          decoded.op = Op_Slti;
+          break;
+        case Funct3::SLTIU:
+          decoded.op = Op_Sltiu;
+          break;
+        case Funct3::XORI:
+          decoded.op = Op_Xori;
+          break;
+        case Funct3::ORI:
+          decoded.op = Op_Ori;
+          break;
+        case Funct3::ANDI:
+          decoded.op = Op_Andi;
+          break;
+        case Funct3::SLLI:
+          decoded.op = Op_Slli;
+          decoded.imm = r_format.rs2;
+          break;
+        case Funct3::SRLI:  // || SRAI
+          decoded.op = (funct7 == Funct7::SRAI) ? Op_Srai : Op_Srli;
+          decoded.imm = r_format.rs2;
+          break;
+        default:
+          break;
+      }
+      break;
+    case OpCode::RTypeArithmeticAndLogical:
+      decoded.rd = rd(r_format.rd);
+      decoded.rs1 = r_format.rs1;
+      decoded.rs2 = r_format.rs2;
+      switch (funct3) {
+        case Funct3::ADD:  // || SUB
+          decoded.op = (funct7 == Funct7::SUB) ? Op_Sub : Op_Add;
+          break;
+        case Funct3::SLL:
+          decoded.op = Op_Sll;
+          break;
+        case Funct3::SLT:
+          decoded.op = Op_Slt;
+          break;
+        case Funct3::SLTU:
+          decoded.op = Op_Sltu;
+          break;
+        case Funct3::XOR:
+          decoded.op = Op_Xor;
+          break;
+        case Funct3::SRL:  // || SRA
+          decoded.op = (funct7 == Funct7::SRA) ? Op_Sra : Op_Srl;
+          break;
+        case Funct3::OR:
+          decoded.op = Op_Or;
+          break;
+        case Funct3::AND:
+          decoded.op = Op_And;
+          break;
+        default:
+          break;
+      }
+      break;
+    case OpCode::FENCE:
+      decoded.op = Op_Fence;
+      break;
+    case OpCode::SYSTEM:  // ecall/ebreak end the program
+      decoded.op = Op_Halt;
+      break;
+    default:
+      break;
+  }
+  return decoded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason FunctionalCore::Run(std::size_t max_instructions) {
+  if (jit_ != nullptr && breakpoints_.empty()) {
+    return jit_->Run(max_instructions);
+  }
+  return Execute<false>(max_instructions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason FunctionalCore::Interpret(
+    std::size_t max_instructions) {
+  return Execute<false>(max_instructions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason FunctionalCore::Warm(std::size_t max_instructions) {
+  return Execute<true>(max_instructions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <bool kWarmCaches>
+FunctionalCore::StopReason FunctionalCore::Execute(
+    std::size_t max_instructions) {
+  // Order must match the Operation enum
+  static void* const kDispatchTable[NumOperations] = {
+      &&op_undecoded, &&op_lui,     &&op_auipc,   &&op_jal,   &&op_jalr,
+      &&op_beq,       &&op_bne,     &&op_blt,     &&op_bge,   &&op_bltu,
+      &&op_bgeu,      &&op_lb,      &&op_lh,      &&op_lw,    &&op_lbu,
+      &&op_lhu,       &&op_sb,      &&op_sh,      &&op_sw,    &&op_addi,
+      &&op_slti,      &&op_sltiu,   &&op_xori,    &&op_ori,   &&op_andi,
+      &&op_slli,      &&op_srli,    &&op_srai,    &&op_add,   &&op_sub,
+      &&op_sll,       &&op_slt,     &&op_sltu,    &&op_xor,   &&op_srl,
+      &&op_sra,       &&op_or,      &&op_and,     &&op_fence, &&op_halt,
+      &&op_illegal,   &&op_breakpoint, &&op_pc_out_of_range};
+
+  reg_data_t regs[kZeroSinkRegister + 1];
+  for (std::size_t ii = 0; ii < RegisterFile::NumCPURegisters; ++ii) {
+    regs[ii] = reg_file_->Read(static_cast<RegisterFile::Registers>(ii));
+  }
+  regs[kZeroSinkRegister] = 0;
+
+  DecodedInstruction* const decoded = decoded_.data();
+  const uint8_t* const code = instr_mem_->Data();
+  const mem_addr_t code_base = code_base_;
+  const std::size_t code_size = (decoded_.size() - 1) * sizeof(instr_t);
+  uint8_t* const data = data_mem_->Data();
+  const std::size_t data_size = data_mem_->GetSize();
+  const bool code_is_data = (instr_mem_ == data_mem_);
+  MemoryBase* const instr_port = instr_port_.get();
+  MemoryBase* const data_port = data_port_.get();
+
+  mem_addr_t pc = pc_->InstructionPointer();
+  mem_addr_t next_pc = 0;
+  mem_addr_t addr = 0;
+  std::size_t retired = 0;
+  StopReason stop_reason = StopReason::InstructionLimit;
+  const DecodedInstruction* instr = nullptr;
+
+// Touches the instruction port and ticks both ports so LRU state advances
+#define WARM_FETCH()                   \
+  do {                                 \
+    if (kWarmCaches) {                 \
+      instr_port->ReadWord(pc);        \
+      instr_port->ExecuteCycle();      \
+      if (data_port != instr_port) {   \
+        data_port->ExecuteCycle();     \
+      }                                \
+    }                                  \
+  } while (0)
+
+// Retires the current instruction and dispatches the one at pc
+#define DISPATCH_NEXT()                                   \
+  do {                                                    \
+    if (++retired == max_instructions) goto done;         \
+    WARM_FETCH();                                         \
+    instr = &decoded[(pc - code_base) / sizeof(instr_t)]; \
+    goto* kDispatchTable[instr->op];                      \
+  } while (0)
+
+#define NEXT()              \
+  do {                      \
+    pc += sizeof(instr_t);  \
+    DISPATCH_NEXT();        \
+  } while (0)
+
+// Control transfers stop on jumps to self (end of program) and bad targets
+#define JUMP(target)                                 \
+  do {                                               \
+    next_pc = (target);                              \
+    if (next_pc == pc) {                             \
+      ++retired;                                     \
+      stop_reason = StopReason::Halt;                \
+      goto done;                                     \
+    }                                                \
+    if (next_pc - code_base >= code_size ||          \
+        (next_pc % sizeof(instr_t)))                 \
+      goto op_illegal;                               \
+    pc = next_pc;                                    \
+    DISPATCH_NEXT();                                 \
+  } while (0)
+
+#define BRANCH(cond)          \
+  do {                        \
+    if (cond) {               \
+      JUMP(pc + instr->imm);  \
+    }                         \
+    NEXT();                   \
+  } while (0)
+
+#define LOAD(data_t, reg_t)                                            \
+  do {                                                                 \
+    addr = regs[instr->rs1] + instr->imm;                              \
+    CHECK(static_cast<std::size_t>(addr) + sizeof(data_t) <= data_size) \
+        << "Attempting to read from invalid address: " << std::hex     \
+        << std::showbase << addr;                                      \
+    data_t load_data;                                                  \
+    if (kWarmCaches) {                                                 \
+      data_port->SetRequestPC(pc);                                     \
+      load_data = PortRead<data_t>(data_port, addr);                   \
+    } else {                                                           \
+      std::memcpy(&load_data, data + addr, sizeof(data_t));            \
+    }                                                                  \
+    RD = static_cast<reg_data_t>(static_cast<reg_t>(load_data));       \
+    NEXT();                                                            \
+  } while (0)
+
+#define STORE(data_t)                                                  \
+  do {                                                                 \
+    addr = regs[instr->rs1] + instr->imm;                              \
+    CHECK(static_cast<std::size_t>(addr) + sizeof(data_t) <= data_size) \
+        << "Attempting to write to invalid address: " << std::hex      \
+        << std::showbase << addr;                                      \
+    const data_t store_data = static_cast<data_t>(regs[instr->rs2]);   \
+    if (kWarmCaches) {                                                 \
+      data_port->SetRequestPC(pc);                                     \
+      PortWrite<data_t>(data_port, addr, store_data);                  \
+    } else {                                                           \
+      std::memcpy(data + addr, &store_data, sizeof(data_t));           \
+      data_mem_->MarkWritten(addr, sizeof(data_t));                    \
+    }                                                                  \
+    if (code_is_data) {                                                \
+      InvalidateStore(addr, sizeof(data_t));                           \
+    }                                                                  \
+    NEXT();                                                            \
+  } while (0)
+
+#define RS1 regs[instr->rs1]
+#define RS2 regs[instr->rs2]
+#define RD regs[instr->rd]
+#define SRS1 static_cast<signed_reg_data_t>(regs[instr->rs1])
+#define SRS2 static_cast<signed_reg_data_t>(regs[instr->rs2])
+#define IMM instr->imm
+
+  if (max_instructions == 0) {
+    goto done;
+  }
+  if (pc - code_base >= code_size || (pc % sizeof(instr_t))) {
+    goto op_illegal;
+  }
+
+  // A breakpoint on the first instruction is the one being resumed from.
+  WARM_FETCH();
+  instr = &decoded[(pc - code_base) / sizeof(instr_t)];
+  if (instr->op == Op_Breakpoint) {
+    instr = &breakpoints_[pc];
+  }
+  goto* kDispatchTable[instr->op];
+
+op_undecoded : {
+  instr_t word = 0;
+  std::memcpy(&word, code + (pc - code_base), sizeof(word));
+  decoded[(pc - code_base) / sizeof(instr_t)] = Decode(word);
+  instr = &decoded[(pc - code_base) / sizeof(instr_t)];
+  goto* kDispatchTable[instr->op];
+}
+op_lui:
+  RD = IMM;
+  NEXT();
+op_auipc:
+  RD = pc + IMM;
+  NEXT();
+op_jal:
+  RD = pc + sizeof(instr_t);
+  JUMP(pc + IMM);
+op_jalr:
+  next_pc = (RS1 + IMM) & ~1;
+  RD = pc + sizeof(instr_t);
+  JUMP(next_pc);
+op_beq:
+  BRANCH(RS1 == RS2);
+op_bne:
+  BRANCH(RS1 != RS2);
+op_blt:
+  BRANCH(SRS1 < SRS2);
+op_bge:
+  BRANCH(SRS1 >= SRS2);
+op_bltu:
+  BRANCH(RS1 < RS2);
+op_bgeu:
+  BRANCH(RS1 >= RS2);
+op_lb:
+  LOAD(int8_t, signed_reg_data_t);
+op_lh:
+  LOAD(int16_t, signed_reg_data_t);
+op_lw:
+  LOAD(uint32_t, reg_data_t);
+op_lbu:
+  LOAD(uint8_t, reg_data_t);
+op_lhu:
+  LOAD(uint16_t, reg_data_t);
+op_sb:
+  STORE(uint8_t);
+op_sh:
+  STORE(uint16_t);
+op_sw:
+  STORE(uint32_t);
+op_addi:
+  RD = RS1 + IMM;
+  NEXT();
+op_slti:
+  RD = SRS1 < IMM;
+  NEXT();
+op_sltiu:
+  RD = RS1 < static_cast<reg_data_t>(IMM);
+  NEXT();
+op_xori:
+  RD = RS1 ^ IMM;
+  NEXT();
+op_ori:
+  RD = RS1 | IMM;
+  NEXT();
+op_andi:
+  RD = RS1 & IMM;
+  NEXT();
+op_slli:
+  RD = RS1 << IMM;
+  NEXT();
+op_srli:
+  RD = RS1 >> IMM;
+  NEXT();
+op_srai:
+  RD = SRS1 >> IMM;
+  NEXT();
+op_add:
+  RD = RS1 + RS2;
+  NEXT();
+op_sub:
+  RD = RS1 - RS2;
+  NEXT();
+op_sll:
+  RD = RS1 << (RS2 & 0x1f);
+  NEXT();
+op_slt:
+  RD = SRS1 < SRS2;
+  NEXT();
+op_sltu:
+  RD = RS1 < RS2;
+  NEXT();
+op_xor:
+  RD = RS1 ^ RS2;
+  NEXT();
+op_srl:
+  RD = RS1 >> (RS2 & 0x1f);
+  NEXT();
+op_sra:
+  RD = SRS1 >> (RS2 & 0x1f);
+  NEXT();
+op_or:
+  RD = RS1 | RS2;
+  NEXT();
+op_and:
+  RD = RS1 & RS2;
+  NEXT();
+op_fence:
+  NEXT();
+op_halt:
+  stop_reason = StopReason::Halt;
+  goto done;
+op_breakpoint:
+  stop_reason = StopReason::Breakpoint;
+  goto done;
+op_pc_out_of_range:
+op_illegal:
+  stop_reason = StopReason::IllegalInstruction;
+  goto done;
+
+#undef WARM_FETCH
+#undef DISPATCH_NEXT
+#undef NEXT
+#undef JUMP
+#undef BRANCH
+#undef LOAD
+#undef STORE
+#undef RS1
+#undef RS2
+#undef RD
+#undef SRS1
+#undef SRS2
+#undef IMM
+
+done:
+  for (std::size_t ii = 1; ii < RegisterFile::NumCPURegisters; ++ii) {
+    reg_file_->Write(static_cast<RegisterFile::Registers>(ii), regs[ii]);
+  }
+  pc_->SetInstructionPointer(pc);
+  instructions_retired_ += retired;
+  return stop_reason;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FunctionalCore::InvalidateStore(mem_addr_t store_addr,
+                                     std::size_t num_bytes) {
+  const mem_addr_t first_instr = store_addr & ~(sizeof(instr_t) - 1);
+  const mem_addr_t last_instr =
+      (store_addr + num_bytes - 1) & ~(sizeof(instr_t) - 1);
+  for (mem_addr_t instr_addr = first_instr; instr_addr <= last_instr;
+       instr_addr += sizeof(instr_t)) {
+    if (CodeOffset(instr_addr) / sizeof(instr_t) >= decoded_.size() - 1) {
+      continue;
+    }
+    DecodedInstruction& decoded = DecodedAt(instr_addr);
+    if (decoded.op == Op_Breakpoint) {
+      ClearBreakpoint(instr_addr);
+      DecodedAt(instr_addr) = DecodedInstruction();
+      SetBreakpoint(instr_addr);
+    } else {
+      decoded = DecodedInstruction();
+    }
+  }
+  if (jit_ != nullptr) {
+    jit_->Invalidate(store_addr, num_bytes);
+  }
+}
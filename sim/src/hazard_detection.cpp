@@ -1,6 +1,7 @@
 #include <hazard_detection.hpp>
 
 #include <b_type_instructions.hpp>
+#include <event_trace.hpp>
 #include <i_type_instructions.hpp>
 #include <instructions.hpp>
 #include <j_type_instructions.hpp>
@@ -10,124 +11,118 @@
 #include <u_type_instructions.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
-bool IHazardDetectionUnit::WritesToRd(const InstructionPtr& instr) const {
+bool IHazardDetectionUnit::WritesToRd(InstructionInterface* instr) const {
   return (instr->IsIType() || instr->IsJType() || instr->IsRType() ||
           instr->IsUType());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool IHazardDetectionUnit::ReadsFromRs1(const InstructionPtr& instr) const {
+bool IHazardDetectionUnit::ReadsFromRs1(InstructionInterface* instr) const {
   return (instr->IsBType() || instr->IsIType() || instr->IsRType() ||
           instr->IsSType());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool IHazardDetectionUnit::ReadsFromRs2(const InstructionPtr& instr) const {
+bool IHazardDetectionUnit::ReadsFromRs2(InstructionInterface* instr) const {
   return (instr->IsBType() || instr->IsRType() || instr->IsSType());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Register& IHazardDetectionUnit::GetRd(const InstructionPtr& instr) const {
-  VLOG(4) << "Hazard detector GetRd: instr type = "
-          << static_cast<int>(instr->InstructionType());
+Register& IHazardDetectionUnit::GetRd(InstructionInterface* instr) const {
   if (instr->IsIType()) {
-    return reinterpret_cast<ITypeInstructionInterface*>(instr.get())->Rd();
+    return reinterpret_cast<ITypeInstructionInterface*>(instr)->Rd();
   } else if (instr->IsJType()) {
-    return reinterpret_cast<JalInstruction*>(instr.get())->Rd();
+    return reinterpret_cast<JalInstruction*>(instr)->Rd();
   } else if (instr->IsRType()) {
-    return reinterpret_cast<RTypeInstructionInterface*>(instr.get())->Rd();
+    return reinterpret_cast<RTypeInstructionInterface*>(instr)->Rd();
   } else if (instr->IsUType()) {
-    return reinterpret_cast<UTypeInstructionInterface*>(instr.get())->Rd();
+    return reinterpret_cast<UTypeInstructionInterface*>(instr)->Rd();
   } else {
     CHECK(false) << "Unrecognized type!"
                  << static_cast<int>(instr->InstructionType());
   }
 
   // won't ever reach here but include this to avoid compiler warnings
-  return reinterpret_cast<UTypeInstructionInterface*>(instr.get())->Rd();
+  return reinterpret_cast<UTypeInstructionInterface*>(instr)->Rd();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Register& IHazardDetectionUnit::GetRs1(const InstructionPtr& instr) const {
-  VLOG(4) << "Hazard detector GetRs1: instr type = "
-          << static_cast<int>(instr->InstructionType());
+Register& IHazardDetectionUnit::GetRs1(InstructionInterface* instr) const {
   if (instr->IsBType()) {
-    return reinterpret_cast<BTypeInstructionInterface*>(instr.get())->Rs1();
+    return reinterpret_cast<BTypeInstructionInterface*>(instr)->Rs1();
   } else if (instr->IsIType()) {
-    return reinterpret_cast<ITypeInstructionInterface*>(instr.get())->Rs1();
+    return reinterpret_cast<ITypeInstructionInterface*>(instr)->Rs1();
   } else if (instr->IsRType()) {
-    return reinterpret_cast<RTypeInstructionInterface*>(instr.get())->Rs1();
+    return reinterpret_cast<RTypeInstructionInterface*>(instr)->Rs1();
   } else if (instr->IsSType()) {
-    return reinterpret_cast<STypeInstructionInterface*>(instr.get())->Rs1();
+    return reinterpret_cast<STypeInstructionInterface*>(instr)->Rs1();
   } else {
     CHECK(false) << "Unrecognized type!"
                  << static_cast<int>(instr->InstructionType());
   }
 
   // won't ever reach here but include this to avoid compiler warnings
-  return reinterpret_cast<STypeInstructionInterface*>(instr.get())->Rs1();
+  return reinterpret_cast<STypeInstructionInterface*>(instr)->Rs1();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Register& IHazardDetectionUnit::GetRs2(const InstructionPtr& instr) const {
+Register& IHazardDetectionUnit::GetRs2(InstructionInterface* instr) const {
   if (instr->IsBType()) {
-    return reinterpret_cast<BTypeInstructionInterface*>(instr.get())->Rs2();
+    return reinterpret_cast<BTypeInstructionInterface*>(instr)->Rs2();
   } else if (instr->IsRType()) {
-    return reinterpret_cast<RTypeInstructionInterface*>(instr.get())->Rs2();
+    return reinterpret_cast<RTypeInstructionInterface*>(instr)->Rs2();
   } else if (instr->IsSType()) {
-    return reinterpret_cast<STypeInstructionInterface*>(instr.get())->Rs2();
+    return reinterpret_cast<STypeInstructionInterface*>(instr)->Rs2();
   } else {
     CHECK(false) << "Unrecognized type!"
                  << static_cast<int>(instr->InstructionType());
   }
 
   // won't ever reach here but include this to avoid compiler warnings
-  return reinterpret_cast<STypeInstructionInterface*>(instr.get())->Rs2();
+  return reinterpret_cast<STypeInstructionInterface*>(instr)->Rs2();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void DataHazardDetectionUnit::HandleHazard() {
-  InstructionPtr decode_instr =
+  InstructionInterface* decode_instr =
       pipeline_->Instruction(Pipeline::Stages::DecodeStage);
-  InstructionPtr execute_instr =
+  InstructionInterface* execute_instr =
       pipeline_->Instruction(Pipeline::Stages::ExecuteStage);
-  InstructionPtr mem_access_instr =
+  InstructionInterface* mem_access_instr =
       pipeline_->Instruction(Pipeline::Stages::MemoryAccessStage);
 
+  TrackLoadData(mem_access_instr);
   HandleLoadHazard(decode_instr, execute_instr);
+  HandleMissHazard(decode_instr, execute_instr);
   Handle1bTypeHazard(decode_instr, mem_access_instr);
   Handle1aTypeHazard(decode_instr, execute_instr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void DataHazardDetectionUnit::Handle1aTypeHazard(
-    InstructionPtr& decode_instr, InstructionPtr& execute_instr) {
+    InstructionInterface* decode_instr, InstructionInterface* execute_instr) {
   if (ReadsFromRs1(decode_instr) && WritesToRd(execute_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential 1a hazard with rs1, instructions: "
-            << decode_instr->InstructionName() << " and "
-            << execute_instr->InstructionName();
     auto& execute_rd = GetRd(execute_instr);
     auto& decode_rs1 = GetRs1(decode_instr);
     if (execute_rd.Number() == decode_rs1.Number() &&
         execute_rd.Number() != 0) {
       decode_rs1.Data() = execute_rd.Data();
-      VLOG(2) << "-1a rs1- FORWARDING: " << execute_rd;
+      TRACE_EVENT(Hazard, Forward, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(), execute_rd.Number());
       ++hazards_detected_;
     }
   }
 
   if (ReadsFromRs2(decode_instr) && WritesToRd(execute_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential 1a hazard with rs2, instructions: "
-            << decode_instr->InstructionName() << " and "
-            << execute_instr->InstructionName();
     auto& execute_rd = GetRd(execute_instr);
     auto& decode_rs2 = GetRs2(decode_instr);
     if (execute_rd.Number() == decode_rs2.Number() &&
         execute_rd.Number() != 0) {
       decode_rs2.Data() = execute_rd.Data();
-      VLOG(2) << "-1a rs2- FORWARDING: " << execute_rd;
+      TRACE_EVENT(Hazard, Forward, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(), execute_rd.Number());
       ++hazards_detected_;
     }
   }
@@ -135,55 +130,52 @@ void DataHazardDetectionUnit::Handle1aTypeHazard(
 
 ////////////////////////////////////////////////////////////////////////////////
 void DataHazardDetectionUnit::Handle1bTypeHazard(
-    InstructionPtr& decode_instr, InstructionPtr& memory_access_instr) {
+    InstructionInterface* decode_instr,
+    InstructionInterface* memory_access_instr) {
   if (ReadsFromRs1(decode_instr) && WritesToRd(memory_access_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential 1b hazard with rs1, instructions: "
-            << decode_instr->InstructionName() << " and "
-            << memory_access_instr->InstructionName();
     auto& memory_access_rd = GetRd(memory_access_instr);
     auto& decode_rs1 = GetRs1(decode_instr);
     if (memory_access_rd.Number() == decode_rs1.Number() &&
         memory_access_rd.Number() != 0) {
       decode_rs1.Data() = memory_access_rd.Data();
-      VLOG(2) << "-1b rs1- FORWARDING: " << memory_access_rd;
+      TRACE_EVENT(Hazard, Forward, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(),
+                  memory_access_rd.Number());
       ++hazards_detected_;
     }
   }
 
   if (ReadsFromRs2(decode_instr) && WritesToRd(memory_access_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential 1b hazard with rs2, instructions: "
-            << decode_instr->InstructionName() << " and "
-            << memory_access_instr->InstructionName();
     auto& memory_access_rd = GetRd(memory_access_instr);
     auto& decode_rs2 = GetRs2(decode_instr);
     if (memory_access_rd.Number() == decode_rs2.Number() &&
         memory_access_rd.Number() != 0) {
       decode_rs2.Data() = memory_access_rd.Data();
-      VLOG(2) << "-1b rs2- FORWARDING: " << memory_access_rd;
+      TRACE_EVENT(Hazard, Forward, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(),
+                  memory_access_rd.Number());
       ++hazards_detected_;
     }
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void DataHazardDetectionUnit::HandleLoadHazard(InstructionPtr& decode_instr,
-                                               InstructionPtr& execute_instr) {
+void DataHazardDetectionUnit::HandleLoadHazard(
+    InstructionInterface* decode_instr, InstructionInterface* execute_instr) {
   if (execute_instr->GetOpCode() != OpCode::Lx) {
     return;
   }
 
   if (ReadsFromRs1(decode_instr) && WritesToRd(execute_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential load hazard with rs1, instructions: "
-            << execute_instr->InstructionName() << " and "
-            << decode_instr->InstructionName();
     auto& decode_rs1 = GetRs1(decode_instr);
     auto& execute_rd = GetRd(execute_instr);
     if (execute_rd.Number() == decode_rs1.Number() &&
         execute_rd.Number() != 0) {
-      VLOG(1) << "Inserting delay (Rs1)";
+      TRACE_EVENT(Hazard, LoadUse, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(), decode_rs1.Number());
       pipeline_->InsertDelay(Pipeline::Stages::ExecuteStage);
       ++hazards_detected_;
       ++delay_added_;
@@ -192,14 +184,12 @@ void DataHazardDetectionUnit::HandleLoadHazard(InstructionPtr& decode_instr,
 
   if (ReadsFromRs2(decode_instr) && WritesToRd(execute_instr)) {
     // possibility of data hazard
-    VLOG(3) << "Potential load hazard with rs2, instructions: "
-            << execute_instr->InstructionName() << " and "
-            << decode_instr->InstructionName();
     auto& decode_rs2 = GetRs2(decode_instr);
     auto& execute_rd = GetRd(execute_instr);
     if (execute_rd.Number() == decode_rs2.Number() &&
         execute_rd.Number() != 0) {
-      VLOG(1) << "Inserting delay (Rs2)";
+      TRACE_EVENT(Hazard, LoadUse, pipeline_->GetCycles(),
+                  decode_instr->InstructionAddress(), decode_rs2.Number());
       pipeline_->InsertDelay(Pipeline::Stages::ExecuteStage);
       ++hazards_detected_;
       ++delay_added_;
@@ -207,17 +197,65 @@ void DataHazardDetectionUnit::HandleLoadHazard(InstructionPtr& decode_instr,
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void DataHazardDetectionUnit::Reset() { ready_cycles_.fill(0); }
+
+////////////////////////////////////////////////////////////////////////////////
+void DataHazardDetectionUnit::TrackLoadData(
+    InstructionInterface* memory_access_instr) {
+  if (!WritesToRd(memory_access_instr)) {
+    return;
+  }
+  const int rd = GetRd(memory_access_instr).Number();
+  ready_cycles_[rd] = 0;
+  if (memory_access_instr->GetOpCode() == OpCode::Lx) {
+    ready_cycles_[rd] =
+        pipeline_->GetCycles() +
+        reinterpret_cast<LoadInstructionInterface*>(memory_access_instr)
+            ->DataLatency();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DataHazardDetectionUnit::HandleMissHazard(
+    InstructionInterface* decode_instr, InstructionInterface* execute_instr) {
+  // Blocking accesses stall the pipeline until their data is there, so only
+  // data still missing when it next advances holds the consumer back
+  const std::size_t next_advance =
+      pipeline_->GetCycles() + pipeline_->CyclesUntilEvent();
+  auto waits_for = [&](const Register& reg) {
+    const int reg_num = reg.Number();
+    // A younger producer in execute forwards its own value instead
+    return reg_num != 0 && ready_cycles_[reg_num] > next_advance &&
+           !(WritesToRd(execute_instr) &&
+             GetRd(execute_instr).Number() == reg_num);
+  };
+  int waiting_reg = 0;
+  if (ReadsFromRs1(decode_instr) && waits_for(GetRs1(decode_instr))) {
+    waiting_reg = GetRs1(decode_instr).Number();
+  } else if (ReadsFromRs2(decode_instr) && waits_for(GetRs2(decode_instr))) {
+    waiting_reg = GetRs2(decode_instr).Number();
+  }
+  if (waiting_reg != 0) {
+    TRACE_EVENT(Hazard, LoadUse, pipeline_->GetCycles(),
+                decode_instr->InstructionAddress(), waiting_reg);
+    pipeline_->InsertDelay(Pipeline::Stages::ExecuteStage);
+    ++hazards_detected_;
+    ++delay_added_;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void ControlHazardDetectionUnit::HandleHazard() {
-  InstructionPtr instr =
+  InstructionInterface* instr =
       pipeline_->Instruction(Pipeline::Stages::MemoryAccessStage);
 
-  const std::string& instr_name = instr->InstructionName();
   if ((instr->IsBType() &&
-       reinterpret_cast<BTypeInstructionInterface*>(instr.get())
-           ->WillBranch()) ||
-      instr->IsJType() || !instr_name.find("jalr")) {
-    VLOG(2) << "Detected a branch! Flushing pipeline";
+       reinterpret_cast<BTypeInstructionInterface*>(instr)->WillBranch()) ||
+      instr->IsJType() || instr->GetOpCode() == OpCode::JALR) {
+    TRACE_EVENT(Hazard, Flush, pipeline_->GetCycles(),
+                instr->InstructionAddress(),
+                Pipeline::Stages::ExecuteStage + 1);
     pipeline_->Flush(Pipeline::Stages::ExecuteStage);
     ++hazards_detected_;
     delay_added_ += 3;
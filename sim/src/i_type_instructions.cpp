@@ -5,46 +5,40 @@
 ITypeInstructionInterface::ITypeInstructionInterface(instr_t instr,
                                                      RegFilePtr reg_file)
     : InstructionInterface(instr), reg_file_(reg_file) {
-  name_ = "I Type Instruction";
   instruction_type_ = InstructionTypes::IType;
-}
 
-void ITypeInstructionInterface::Decode() {
   ITypeInstructionFormat i_type_format;
   i_type_format.word = instr_;
 
   const int rd_num = i_type_format.rd;
-  Rd_ = std::make_shared<Register>(Register(rd_num));
-  reg_file_->Read(*Rd_);
+  Rd_ = Register(rd_num);
 
   const int rs1_num = i_type_format.rs1;
-  Rs1_ = std::make_shared<Register>(Register(rs1_num));
-  reg_file_->Read(*Rs1_);
+  Rs1_ = Register(rs1_num);
 
   const imm_t imm_upper_20 =
       ((i_type_format.imm11_0 & (1 << 11)) ? -1 : 0) & ~(0xfff);
   imm_ = static_cast<imm_t>(imm_upper_20 | i_type_format.imm11_0);
+}
 
+void ITypeInstructionInterface::Decode() {
+  reg_file_->Read(Rd_);
+  reg_file_->Read(Rs1_);
   InstructionInterface::Decode();
 }
 
 void ITypeInstructionInterface::Execute() {
-  VLOG(3) << "Executed: " << Rd_ << " = " << name_ << "{" << Rs1_ << ", "
-          << imm_ << "}";
   InstructionInterface::Execute();
 }
 
 void ITypeInstructionInterface::WriteBack() {
-  VLOG(3) << name_ << " WriteBack stage: writing " << Rd_ << " back to regfile";
-  reg_file_->Write(*Rd_);
+  reg_file_->Write(Rd_);
   InstructionInterface::WriteBack();
 }
 
-void ITypeInstructionInterface::SetInstructionName() {
-  std::stringstream instruction_stream;
-  instruction_stream << name_ << " x" << Rd_->Number() << ", x"
-                     << Rs1_->Number() << ", " << imm_;
-  instruction_ = instruction_stream.str();
+void ITypeInstructionInterface::Disassemble(std::ostream& stream) const {
+  stream << mnemonic_ << " x" << Rd_.Number() << ", x"
+         << Rs1_.Number() << ", " << imm_;
 }
 
 std::string ITypeInstructionInterface::RegistersString() {
@@ -56,107 +50,97 @@ std::string ITypeInstructionInterface::RegistersString() {
 ////////////////////////////////////////////////////////////////////////////////
 AddiInstruction::AddiInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "addi";
+  mnemonic_ = Mnemonic::Addi;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void AddiInstruction::Execute() {
-  Rd_->Data() = Rs1_->Data() + imm_;
+  Rd_.Data() = Rs1_.Data() + imm_;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 SltiInstruction::SltiInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "slti";
+  mnemonic_ = Mnemonic::Slti;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void SltiInstruction::Execute() {
-  Rd_->Data() = static_cast<signed_reg_data_t>(Rs1_->Data()) < imm_;
+  Rd_.Data() = static_cast<signed_reg_data_t>(Rs1_.Data()) < imm_;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 SltiuInstruction::SltiuInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "sltiu";
+  mnemonic_ = Mnemonic::Sltiu;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void SltiuInstruction::Execute() {
-  Rd_->Data() = Rs1_->Data() < static_cast<unsigned>(imm_);
+  Rd_.Data() = Rs1_.Data() < static_cast<unsigned>(imm_);
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 XoriInstruction::XoriInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "xori";
+  mnemonic_ = Mnemonic::Xori;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void XoriInstruction::Execute() {
-  Rd_->Data() = Rs1_->Data() ^ imm_;
+  Rd_.Data() = Rs1_.Data() ^ imm_;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 OriInstruction::OriInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "ori";
+  mnemonic_ = Mnemonic::Ori;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void OriInstruction::Execute() {
-  Rd_->Data() = Rs1_->Data() | imm_;
+  Rd_.Data() = Rs1_.Data() | imm_;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 AndiInstruction::AndiInstruction(instr_t instr, RegFilePtr reg_file)
     : ITypeInstructionInterface(instr, reg_file) {
-  name_ = "andi";
+  mnemonic_ = Mnemonic::Andi;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void AndiInstruction::Execute() {
-  Rd_->Data() = Rs1_->Data() & imm_;
+  Rd_.Data() = Rs1_.Data() & imm_;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 JalrInstruction::JalrInstruction(instr_t instr, RegFilePtr reg_file, PcPtr pc)
     : ITypeInstructionInterface(instr, reg_file), pc_(pc) {
-  name_ = "jalr";
+  mnemonic_ = Mnemonic::Jalr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void JalrInstruction::Execute() {
-#if (__INSTRUCTION_ACCURATE__ == 1)
-  const int pipeline_offset = sizeof(instr_t);
-#else
-  // TODO: determine pipeline correction here
-  const int pipeline_offset =
-      (Pipeline::Stages::DecodeStage - Pipeline::Stages::FetchStage + 1) *
-      sizeof(instr_t);
-#endif
-  Rd_->Data() = pc_->InstructionPointer() + pipeline_offset;
-  target_addr_ = (Rs1_->Data() + imm_) & ~1;
-  VLOG(3) << "Execute: Target address = " << target_addr_;
+  Rd_.Data() = instr_addr_ + sizeof(instr_t);
+  target_addr_ = (Rs1_.Data() + imm_) & ~1;
   ITypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void JalrInstruction::MemoryAccess() {
   pc_->Jump(target_addr_);
-  VLOG(1) << "WriteBack: Jumping to " << target_addr_;
   ITypeInstructionInterface::MemoryAccess();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void JalrInstruction::WriteBack() {
-  reg_file_->Write(*Rd_);
+  reg_file_->Write(Rd_);
   InstructionInterface::WriteBack();
 }
 
@@ -165,46 +149,43 @@ LoadInstructionInterface::LoadInstructionInterface(instr_t instr,
                                                    RegFilePtr reg_file,
                                                    MemoryPtr mem)
     : ITypeInstructionInterface(instr, reg_file), mem_(mem) {
-  name_ = "load";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LoadInstructionInterface::Execute() {
-  load_addr_ = Rs1_->Data() + imm_;
-  VLOG(3) << "Execute: calculated load address as " << load_addr_;
+  load_addr_ = Rs1_.Data() + imm_;
   InstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LoadInstructionInterface::MemoryAccess() {
   cycles_for_stage_ = mem_->GetAccessLatency();
+  data_latency_ = mem_->GetDataLatency();
   InstructionInterface::MemoryAccess();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LoadInstructionInterface::WriteBack() {
   cycles_for_stage_ = 0;
-  reg_file_->Write(*Rd_);
+  reg_file_->Write(Rd_);
   InstructionInterface::WriteBack();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void LoadInstructionInterface::SetInstructionName() {
-  std::stringstream instruction_stream;
-  instruction_stream << name_ << " x" << static_cast<int>(Rd_->Number()) << ", "
-                     << imm_ << "(x" << static_cast<int>(Rs1_->Number()) << ")";
-  instruction_ = instruction_stream.str();
+void LoadInstructionInterface::Disassemble(std::ostream& stream) const {
+  stream << mnemonic_ << " x" << static_cast<int>(Rd_.Number()) << ", "
+         << imm_ << "(x" << static_cast<int>(Rs1_.Number()) << ")";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 LbInstruction::LbInstruction(instr_t instr, RegFilePtr reg_file, MemoryPtr mem)
     : LoadInstructionInterface(instr, reg_file, mem) {
-  name_ = "lb";
+  mnemonic_ = Mnemonic::Lb;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LbInstruction::MemoryAccess() {
-  Rd_->Data() = static_cast<signed_reg_data_t>(mem_->ReadByte(load_addr_));
+  Rd_.Data() = static_cast<signed_reg_data_t>(mem_->ReadByte(load_addr_));
   LoadInstructionInterface::MemoryAccess();
 }
 
@@ -212,24 +193,24 @@ void LbInstruction::MemoryAccess() {
 LbuInstruction::LbuInstruction(instr_t instr, RegFilePtr reg_file,
                                MemoryPtr mem)
     : LoadInstructionInterface(instr, reg_file, mem) {
-  name_ = "lbu";
+  mnemonic_ = Mnemonic::Lbu;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LbuInstruction::MemoryAccess() {
-  Rd_->Data() = static_cast<reg_data_t>(mem_->ReadByte(load_addr_));
+  Rd_.Data() = static_cast<reg_data_t>(mem_->ReadByte(load_addr_));
   LoadInstructionInterface::MemoryAccess();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 LhInstruction::LhInstruction(instr_t instr, RegFilePtr reg_file, MemoryPtr mem)
     : LoadInstructionInterface(instr, reg_file, mem) {
-  name_ = "lh";
+  mnemonic_ = Mnemonic::Lh;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LhInstruction::MemoryAccess() {
-  Rd_->Data() = static_cast<signed_reg_data_t>(mem_->ReadHalfWord(load_addr_));
+  Rd_.Data() = static_cast<signed_reg_data_t>(mem_->ReadHalfWord(load_addr_));
   LoadInstructionInterface::MemoryAccess();
 }
 
@@ -237,23 +218,23 @@ void LhInstruction::MemoryAccess() {
 LhuInstruction::LhuInstruction(instr_t instr, RegFilePtr reg_file,
                                MemoryPtr mem)
     : LoadInstructionInterface(instr, reg_file, mem) {
-  name_ = "lhu";
+  mnemonic_ = Mnemonic::Lhu;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LhuInstruction::MemoryAccess() {
-  Rd_->Data() = static_cast<reg_data_t>(mem_->ReadHalfWord(load_addr_));
+  Rd_.Data() = static_cast<reg_data_t>(mem_->ReadHalfWord(load_addr_));
   LoadInstructionInterface::MemoryAccess();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 LwInstruction::LwInstruction(instr_t instr, RegFilePtr reg_file, MemoryPtr mem)
     : LoadInstructionInterface(instr, reg_file, mem) {
-  name_ = "lw";
+  mnemonic_ = Mnemonic::Lw;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LwInstruction::MemoryAccess() {
-  Rd_->Data() = static_cast<reg_data_t>(mem_->ReadWord(load_addr_));
+  Rd_.Data() = static_cast<reg_data_t>(mem_->ReadWord(load_addr_));
   LoadInstructionInterface::MemoryAccess();
 }
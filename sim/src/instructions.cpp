@@ -1,7 +1,33 @@
 #include <instructions.hpp>
 
+#include <sstream>
+
 #include <pipeline.hpp>
 
+namespace {
+
+constexpr const char* kMnemonicNames[] = {
+    "nop",  "lui",  "auipc", "jal",  "jalr", "beq",  "bne",   "blt",
+    "bge",  "bltu", "bgeu",  "lb",   "lh",   "lw",   "lbu",   "lhu",
+    "sb",   "sh",   "sw",    "addi", "slti", "sltiu", "xori", "ori",
+    "andi", "slli", "srli",  "srai", "add",  "sub",  "sll",   "slt",
+    "sltu", "xor",  "srl",   "sra",  "or",   "and"};
+static_assert(sizeof(kMnemonicNames) / sizeof(kMnemonicNames[0]) ==
+                  static_cast<std::size_t>(Mnemonic::And) + 1,
+              "Every mnemonic needs a name");
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+const char* MnemonicName(Mnemonic mnemonic) {
+  return kMnemonicNames[static_cast<std::size_t>(mnemonic)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::ostream& operator<<(std::ostream& stream, Mnemonic mnemonic) {
+  return stream << MnemonicName(mnemonic);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void InstructionInterface::ExecuteCycle(int stage) {
   switch (stage) {
@@ -24,29 +50,19 @@ void InstructionInterface::ExecuteCycle(int stage) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void InstructionInterface::Fetch() {
-  instruction_ = name_;
-  VLOG(2) << "Fetch: " << instruction_;
-}
+void InstructionInterface::Fetch() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void InstructionInterface::Decode() {
-  SetInstructionName();
-  VLOG(2) << "Decode: " << instruction_;
-}
+void InstructionInterface::Decode() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void InstructionInterface::Execute() { VLOG(2) << "Execute: " << instruction_; }
+void InstructionInterface::Execute() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void InstructionInterface::MemoryAccess() {
-  VLOG(2) << "Memory Access: " << instruction_;
-}
+void InstructionInterface::MemoryAccess() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void InstructionInterface::WriteBack() {
-  VLOG(2) << "Write Back: " << instruction_;
-}
+void InstructionInterface::WriteBack() {}
 
 ////////////////////////////////////////////////////////////////////////////////
 std::size_t InstructionInterface::GetCyclesForStage() const {
@@ -59,8 +75,10 @@ InstructionTypes InstructionInterface::InstructionType() const {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-const std::string& InstructionInterface::InstructionName() const {
-  return instruction_;
+std::string InstructionInterface::InstructionName() const {
+  std::ostringstream instruction_stream;
+  Disassemble(instruction_stream);
+  return instruction_stream.str();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -94,16 +112,13 @@ bool InstructionInterface::IsUType() const {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void NopInstruction::Decode() {
-  VLOG(2) << "Decode: NOP";
-  SetInstructionName();
-}
+void NopInstruction::Decode() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void NopInstruction::Execute() { VLOG(2) << "Execute: NOP"; }
+void NopInstruction::Execute() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void NopInstruction::MemoryAccess() { VLOG(2) << "Memory Access: NOP"; }
+void NopInstruction::MemoryAccess() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-void NopInstruction::WriteBack() { VLOG(2) << "Write Back: NOP"; }
+void NopInstruction::WriteBack() {}
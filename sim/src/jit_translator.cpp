@@ -0,0 +1,741 @@
+#include <jit_translator.hpp>
+
+#include <glog/logging.h>
+
+#if defined(__x86_64__)
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+using Op = FunctionalCore::Operation;
+
+constexpr std::size_t kBufferSize{16 * 1024 * 1024};
+constexpr uint32_t kMaxBlockInstructions{64};
+// Worst case host bytes for one block, including its side exits
+constexpr std::size_t kMaxBlockBytes{kMaxBlockInstructions * 192 + 256};
+
+// Host registers, as encoded in ModRM fields
+constexpr uint8_t kEax{0};
+constexpr uint8_t kEcx{1};
+constexpr uint8_t kEdx{2};
+
+// Opcodes of the "op r32, r/m32" forms
+constexpr uint8_t kMovLoad{0x8b};
+constexpr uint8_t kMovStore{0x89};
+constexpr uint8_t kAddLoad{0x03};
+constexpr uint8_t kSubLoad{0x2b};
+constexpr uint8_t kAndLoad{0x23};
+constexpr uint8_t kOrLoad{0x0b};
+constexpr uint8_t kXorLoad{0x33};
+constexpr uint8_t kCmpLoad{0x3b};
+
+// Condition codes of the 0x0f 0x8x jcc and 0x0f 0x9x setcc forms
+constexpr uint8_t kCondBelow{0x2};
+constexpr uint8_t kCondAboveEqual{0x3};
+constexpr uint8_t kCondEqual{0x4};
+constexpr uint8_t kCondNotEqual{0x5};
+constexpr uint8_t kCondAbove{0x7};
+constexpr uint8_t kCondLess{0xc};
+constexpr uint8_t kCondGreaterEqual{0xd};
+
+bool EndsBlock(Op op) {
+  switch (op) {
+    case Op::Op_Jal:
+    case Op::Op_Jalr:
+    case Op::Op_Beq:
+    case Op::Op_Bne:
+    case Op::Op_Blt:
+    case Op::Op_Bge:
+    case Op::Op_Bltu:
+    case Op::Op_Bgeu:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Translatable(Op op) {
+  return (op >= Op::Op_Lui && op <= Op::Op_Fence);
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool JitTranslator::Supported() { return true; }
+
+////////////////////////////////////////////////////////////////////////////////
+JitTranslator::JitTranslator(FunctionalCore& core)
+    : core_(core),
+      code_size_((core.decoded_.size() - 1) * sizeof(instr_t)),
+      data_size_(core.data_mem_->GetSize()),
+      code_is_data_(core.instr_mem_ == core.data_mem_) {
+  static_assert(std::is_standard_layout<Context>::value,
+                "Generated code addresses the context by offset");
+  CHECK(data_size_ >= sizeof(word_t)) << "JIT requires a data memory";
+
+  void* buffer = mmap(nullptr, kBufferSize, PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  CHECK(buffer != MAP_FAILED) << "Unable to map the JIT code buffer";
+  buffer_ = static_cast<uint8_t*>(buffer);
+  buffer_size_ = kBufferSize;
+
+  std::memset(&context_, 0, sizeof(context_));
+  context_.data = core_.data_mem_->Data();
+  context_.written = core_.data_mem_->WrittenPageFlags();
+  EmitTrampoline();
+  blocks_start_ = buffer_used_;
+  Flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JitTranslator::~JitTranslator() { munmap(buffer_, buffer_size_); }
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Flush() {
+  buffer_used_ = blocks_start_;
+  blocks_.assign(code_size_ / sizeof(instr_t), nullptr);
+  translated_.assign(code_size_ / sizeof(instr_t), false);
+  untranslatable_.assign(code_size_ / sizeof(instr_t), false);
+  chain_exits_.clear();
+  context_.blocks = blocks_.data();
+  ++flushes_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Invalidate(mem_addr_t addr, std::size_t num_bytes) {
+  // Blocks chain into each other, so any hit drops the whole cache
+  const std::size_t first = WordIndex(addr);
+  const std::size_t last = WordIndex(addr + num_bytes - 1);
+  for (std::size_t ii = first; ii <= last && ii < translated_.size(); ++ii) {
+    untranslatable_[ii] = false;
+    if (translated_[ii]) {
+      VLOG(2) << "Store to translated code at " << std::hex << addr;
+      Flush();
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::LoadContext() {
+  for (std::size_t ii = 0; ii < RegisterFile::NumCPURegisters; ++ii) {
+    context_.regs[ii] =
+        core_.reg_file_->Read(static_cast<RegisterFile::Registers>(ii));
+  }
+  context_.regs[0] = 0;
+  context_.pc = core_.pc_->InstructionPointer();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::StoreContext() {
+  for (std::size_t ii = 1; ii < RegisterFile::NumCPURegisters; ++ii) {
+    core_.reg_file_->Write(static_cast<RegisterFile::Registers>(ii),
+                           context_.regs[ii]);
+  }
+  core_.pc_->SetInstructionPointer(context_.pc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason JitTranslator::Interpret(
+    std::size_t num_instructions) {
+  StoreContext();
+  const std::size_t start_instructions = core_.instructions_retired_;
+  const FunctionalCore::StopReason stop_reason =
+      core_.Interpret(num_instructions);
+  const std::size_t retired = core_.instructions_retired_ - start_instructions;
+  interpreted_ += retired;
+  context_.budget -= retired;
+  LoadContext();
+  return stop_reason;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason JitTranslator::Run(std::size_t max_instructions) {
+  using StopReason = FunctionalCore::StopReason;
+
+  LoadContext();
+  context_.data = core_.data_mem_->Data();
+  context_.written = core_.data_mem_->WrittenPageFlags();
+  context_.budget = max_instructions;
+  interpreted_ = 0;
+  StopReason stop_reason = StopReason::InstructionLimit;
+  bool stopped = false;
+
+  while (!stopped && context_.budget > 0) {
+    const mem_addr_t pc = context_.pc;
+    if (!InCode(pc) || (pc % sizeof(instr_t))) {
+      stop_reason = StopReason::IllegalInstruction;
+      break;
+    }
+    uint8_t* const block = BlockAt(pc);
+    if (block == nullptr) {
+      stop_reason = Interpret(1);
+      stopped = (stop_reason != StopReason::InstructionLimit);
+      continue;
+    }
+
+    enter_(&context_, block);
+
+    switch (context_.exit) {
+      case Exit_Budget:
+        stop_reason = Interpret(context_.budget);
+        stopped = true;
+        break;
+      case Exit_Interpret:
+        stop_reason = Interpret(1);
+        stopped = (stop_reason != StopReason::InstructionLimit);
+        break;
+      case Exit_Indirect:
+        // Bad jalr targets stop on the jalr itself, as in the interpreter
+        if (!InCode(context_.pc) || (context_.pc % sizeof(instr_t))) {
+          context_.pc = context_.jalr_pc;
+          ++context_.budget;
+          stop_reason = StopReason::IllegalInstruction;
+          stopped = true;
+        }
+        break;
+      case Exit_Halt:
+        stop_reason = StopReason::Halt;
+        stopped = true;
+        break;
+      case Exit_CodeStore:
+        core_.InvalidateStore(context_.store_addr, sizeof(word_t));
+        break;
+      default: {
+        const ChainExit chain_exit =
+            chain_exits_[context_.exit - kFirstChainExit];
+        if (!InCode(chain_exit.target_pc)) {
+          break;
+        }
+        const std::size_t flushes = flushes_;
+        uint8_t* const target = BlockAt(chain_exit.target_pc);
+        if (target != nullptr && flushes == flushes_) {
+          Chain(chain_exit, target);
+        }
+      } break;
+    }
+  }
+
+  StoreContext();
+  core_.instructions_retired_ +=
+      (max_instructions - context_.budget) - interpreted_;
+  return stop_reason;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t* JitTranslator::BlockAt(mem_addr_t pc) {
+  const std::size_t index = WordIndex(pc);
+  uint8_t* const block = blocks_[index];
+  if (block != nullptr || untranslatable_[index]) {
+    return block;
+  }
+  return Translate(pc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const FunctionalCore::DecodedInstruction& JitTranslator::DecodedAt(
+    mem_addr_t pc) {
+  FunctionalCore::DecodedInstruction& decoded = core_.DecodedAt(pc);
+  if (decoded.op == Op::Op_Undecoded) {
+    instr_t word = 0;
+    std::memcpy(&word, core_.instr_mem_->Data() + core_.CodeOffset(pc),
+                sizeof(word));
+    decoded = FunctionalCore::Decode(word);
+  }
+  return decoded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t* JitTranslator::Translate(mem_addr_t block_pc) {
+  // Control transfers to bad static targets are left to the interpreter
+  const auto valid_target = [&](mem_addr_t target) {
+    return (InCode(target) && !(target % sizeof(instr_t)));
+  };
+
+  uint32_t length = 0;
+  for (mem_addr_t pc = block_pc;
+       InCode(pc) && length < kMaxBlockInstructions;
+       pc += sizeof(instr_t)) {
+    const FunctionalCore::DecodedInstruction& decoded = DecodedAt(pc);
+    if (!Translatable(decoded.op)) {
+      break;
+    }
+    if (EndsBlock(decoded.op)) {
+      if (decoded.op != Op::Op_Jalr && !valid_target(pc + decoded.imm)) {
+        break;
+      }
+      ++length;
+      break;
+    }
+    ++length;
+  }
+  if (length == 0) {
+    untranslatable_[WordIndex(block_pc)] = true;
+    return nullptr;
+  }
+
+  if (buffer_size_ - buffer_used_ < kMaxBlockBytes) {
+    VLOG(1) << "JIT code buffer full, flushing translations";
+    Flush();
+  }
+
+  uint8_t* const entry = buffer_ + buffer_used_;
+  blocks_[WordIndex(block_pc)] = entry;
+  std::vector<SideExit> side_exits;
+
+  // cmp qword [budget], length; jb budget exit; sub qword [budget], length
+  Emit8(0x48);
+  EmitContextAccess(0x81, 7, offsetof(Context, budget));
+  Emit32(length);
+  side_exits.push_back(
+      SideExit{EmitJcc(kCondBelow), block_pc, 0, Exit_Budget});
+  Emit8(0x48);
+  EmitContextAccess(0x81, 5, offsetof(Context, budget));
+  Emit32(length);
+
+  mem_addr_t pc = block_pc;
+  for (uint32_t index = 0; index < length; ++index, pc += sizeof(instr_t)) {
+    TranslateInstruction(pc, index, length, side_exits);
+    translated_[WordIndex(pc)] = true;
+  }
+  const FunctionalCore::DecodedInstruction& last =
+      DecodedAt(pc - sizeof(instr_t));
+  if (!EndsBlock(last.op)) {
+    if (InCode(pc) && !Translatable(DecodedAt(pc).op)) {
+      EmitExit(pc, Exit_Interpret);
+    } else {
+      EmitChainExit(pc);
+    }
+  }
+  EmitSideExits(side_exits);
+
+  VLOG(2) << "Translated block at " << std::hex << block_pc << std::dec
+          << ": " << length << " instructions, "
+          << (buffer_ + buffer_used_ - entry) << " bytes";
+  return entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::TranslateInstruction(mem_addr_t pc, uint32_t index,
+                                         uint32_t length,
+                                         std::vector<SideExit>& side_exits) {
+  const FunctionalCore::DecodedInstruction& decoded = DecodedAt(pc);
+  const bool write_rd = (decoded.rd != FunctionalCore::kZeroSinkRegister);
+  const uint32_t imm = static_cast<uint32_t>(decoded.imm);
+  const mem_addr_t next_pc = pc + sizeof(instr_t);
+
+  const auto store_rd = [&](uint8_t host_reg) {
+    if (write_rd) {
+      EmitRegisterAccess(kMovStore, host_reg, decoded.rd);
+    }
+  };
+  const auto store_rd_imm = [&](uint32_t value) {
+    if (write_rd) {
+      EmitContextAccess(0xc7, 0, offsetof(Context, regs) +
+                                     decoded.rd * sizeof(reg_data_t));
+      Emit32(value);
+    }
+  };
+  // eax = rs1 op imm32, using the 0x81 group extension
+  const auto alu_imm = [&](uint8_t extension) {
+    EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+    EmitBytes({0x81, static_cast<uint8_t>(0xc0 | (extension << 3))});
+    Emit32(imm);
+  };
+  const auto alu_reg = [&](uint8_t opcode) {
+    EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+    EmitRegisterAccess(opcode, kEax, decoded.rs2);
+    store_rd(kEax);
+  };
+  // setcc al; movzx eax, al
+  const auto set_rd = [&](uint8_t condition) {
+    EmitBytes({0x0f, static_cast<uint8_t>(0x90 | condition), 0xc0});
+    EmitBytes({0x0f, 0xb6, 0xc0});
+    store_rd(kEax);
+  };
+  const auto shift_imm = [&](uint8_t extension) {
+    EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+    EmitBytes({0xc1, static_cast<uint8_t>(0xc0 | (extension << 3)),
+               static_cast<uint8_t>(imm & 0x1f)});
+    store_rd(kEax);
+  };
+  // x86 masks variable shift counts to 5 bits, as RV32I requires
+  const auto shift_reg = [&](uint8_t extension) {
+    EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+    EmitRegisterAccess(kMovLoad, kEcx, decoded.rs2);
+    EmitBytes({0xd3, static_cast<uint8_t>(0xc0 | (extension << 3))});
+    store_rd(kEax);
+  };
+  // eax = rs1 + imm, leaving the instruction to the interpreter (which
+  // reports the bad address) when the access would leave data memory
+  const auto address = [&](std::size_t access_size) {
+    alu_imm(0);
+    EmitBytes({0x81, 0xf8});
+    Emit32(static_cast<uint32_t>(data_size_ - access_size));
+    side_exits.push_back(
+        SideExit{EmitJcc(kCondAbove), pc, length - index, Exit_Interpret});
+  };
+  // Loads into edx from [r12 + rax]
+  const auto load = [&](std::initializer_list<uint8_t> opcode,
+                        std::size_t access_size) {
+    address(access_size);
+    Emit8(0x41);
+    EmitBytes(opcode);
+    EmitBytes({0x14, 0x04});
+    store_rd(kEdx);
+  };
+  // Stores from ecx to [r12 + rax]
+  const auto store = [&](std::initializer_list<uint8_t> opcode,
+                         std::size_t access_size) {
+    address(access_size);
+    EmitRegisterAccess(kMovLoad, kEcx, decoded.rs2);
+    EmitBytes(opcode);
+    EmitBytes({0x0c, 0x04});
+    // Flags the pages of the first and last byte stored: mov rdx, [written];
+    // mov ecx, eax or lea ecx, [rax + size - 1]; shr ecx; mov [rdx + rcx], 1
+    Emit8(0x48);
+    EmitContextAccess(kMovLoad, kEdx, offsetof(Context, written));
+    for (std::size_t offset = 0; offset < access_size;
+         offset += std::max<std::size_t>(access_size - 1, 1)) {
+      if (offset == 0) {
+        EmitBytes({0x89, 0xc1});
+      } else {
+        EmitBytes({0x8d, 0x48, static_cast<uint8_t>(offset)});
+      }
+      EmitBytes({0xc1, 0xe9, MainMemoryBase::kWrittenPageShift});
+      EmitBytes({0xc6, 0x04, 0x0a, 0x01});
+    }
+    if (code_is_data_) {
+      Emit8(0x3d);
+      Emit32(static_cast<uint32_t>(code_size_));
+      side_exits.push_back(SideExit{EmitJcc(kCondBelow), next_pc,
+                                    length - index - 1, Exit_CodeStore});
+    }
+  };
+  const auto branch = [&](uint8_t condition) {
+    EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+    EmitRegisterAccess(kCmpLoad, kEax, decoded.rs2);
+    const std::size_t taken = EmitJcc(condition);
+    EmitChainExit(next_pc);
+    PatchRel32(taken, buffer_ + buffer_used_);
+    const mem_addr_t target = pc + decoded.imm;
+    if (target == pc) {
+      EmitExit(pc, Exit_Halt);
+    } else {
+      EmitChainExit(target);
+    }
+  };
+
+  switch (decoded.op) {
+    case Op::Op_Lui:
+      store_rd_imm(imm);
+      break;
+    case Op::Op_Auipc:
+      store_rd_imm(pc + imm);
+      break;
+    case Op::Op_Jal:
+      store_rd_imm(next_pc);
+      if (pc + decoded.imm == pc) {
+        EmitExit(pc, Exit_Halt);
+      } else {
+        EmitChainExit(pc + decoded.imm);
+      }
+      break;
+    case Op::Op_Jalr: {
+      // eax = (rs1 + imm) & ~1, read before rd is written
+      alu_imm(0);
+      EmitBytes({0x83, 0xe0, 0xfe});
+      store_rd_imm(next_pc);
+      Emit8(0x3d);
+      Emit32(pc);
+      side_exits.push_back(SideExit{EmitJcc(kCondEqual), pc, 0, Exit_Halt});
+      // mov edx, eax; sub edx, code base; cmp edx, code size
+      EmitBytes({0x89, 0xc2});
+      if (core_.code_base_ != 0) {
+        EmitBytes({0x81, 0xea});
+        Emit32(core_.code_base_);
+      }
+      EmitBytes({0x81, 0xfa});
+      Emit32(static_cast<uint32_t>(code_size_));
+      const std::size_t out_of_range = EmitJcc(kCondAboveEqual);
+      EmitBytes({0xa8, 0x03});  // test al, 3
+      const std::size_t misaligned = EmitJcc(kCondNotEqual);
+      // shr edx, 2; mov rcx, [r13 + rdx * 8]; test rcx, rcx
+      EmitBytes({0xc1, 0xea, 0x02});
+      EmitBytes({0x49, 0x8b, 0x4c, 0xd5, 0x00});
+      EmitBytes({0x48, 0x85, 0xc9});
+      const std::size_t untranslated = EmitJcc(kCondEqual);
+      EmitBytes({0xff, 0xe1});  // jmp rcx
+      PatchRel32(out_of_range, buffer_ + buffer_used_);
+      PatchRel32(misaligned, buffer_ + buffer_used_);
+      PatchRel32(untranslated, buffer_ + buffer_used_);
+      EmitContextAccess(kMovStore, kEax, offsetof(Context, pc));
+      EmitContextAccess(0xc7, 0, offsetof(Context, jalr_pc));
+      Emit32(pc);
+      EmitContextAccess(0xc7, 0, offsetof(Context, exit));
+      Emit32(Exit_Indirect);
+      Emit8(0xe9);
+      Emit32(0);
+      PatchRel32(buffer_used_ - sizeof(uint32_t), epilogue_);
+    } break;
+    case Op::Op_Beq:
+      branch(kCondEqual);
+      break;
+    case Op::Op_Bne:
+      branch(kCondNotEqual);
+      break;
+    case Op::Op_Blt:
+      branch(kCondLess);
+      break;
+    case Op::Op_Bge:
+      branch(kCondGreaterEqual);
+      break;
+    case Op::Op_Bltu:
+      branch(kCondBelow);
+      break;
+    case Op::Op_Bgeu:
+      branch(kCondAboveEqual);
+      break;
+    case Op::Op_Lb:
+      load({0x0f, 0xbe}, sizeof(int8_t));
+      break;
+    case Op::Op_Lh:
+      load({0x0f, 0xbf}, sizeof(int16_t));
+      break;
+    case Op::Op_Lw:
+      load({0x8b}, sizeof(uint32_t));
+      break;
+    case Op::Op_Lbu:
+      load({0x0f, 0xb6}, sizeof(uint8_t));
+      break;
+    case Op::Op_Lhu:
+      load({0x0f, 0xb7}, sizeof(uint16_t));
+      break;
+    case Op::Op_Sb:
+      store({0x41, 0x88}, sizeof(uint8_t));
+      break;
+    case Op::Op_Sh:
+      store({0x66, 0x41, 0x89}, sizeof(uint16_t));
+      break;
+    case Op::Op_Sw:
+      store({0x41, 0x89}, sizeof(uint32_t));
+      break;
+    case Op::Op_Addi:
+      alu_imm(0);
+      store_rd(kEax);
+      break;
+    case Op::Op_Slti:
+      alu_imm(7);
+      set_rd(kCondLess);
+      break;
+    case Op::Op_Sltiu:
+      alu_imm(7);
+      set_rd(kCondBelow);
+      break;
+    case Op::Op_Xori:
+      alu_imm(6);
+      store_rd(kEax);
+      break;
+    case Op::Op_Ori:
+      alu_imm(1);
+      store_rd(kEax);
+      break;
+    case Op::Op_Andi:
+      alu_imm(4);
+      store_rd(kEax);
+      break;
+    case Op::Op_Slli:
+      shift_imm(4);
+      break;
+    case Op::Op_Srli:
+      shift_imm(5);
+      break;
+    case Op::Op_Srai:
+      shift_imm(7);
+      break;
+    case Op::Op_Add:
+      alu_reg(kAddLoad);
+      break;
+    case Op::Op_Sub:
+      alu_reg(kSubLoad);
+      break;
+    case Op::Op_Sll:
+      shift_reg(4);
+      break;
+    case Op::Op_Slt:
+      EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+      EmitRegisterAccess(kCmpLoad, kEax, decoded.rs2);
+      set_rd(kCondLess);
+      break;
+    case Op::Op_Sltu:
+      EmitRegisterAccess(kMovLoad, kEax, decoded.rs1);
+      EmitRegisterAccess(kCmpLoad, kEax, decoded.rs2);
+      set_rd(kCondBelow);
+      break;
+    case Op::Op_Xor:
+      alu_reg(kXorLoad);
+      break;
+    case Op::Op_Srl:
+      shift_reg(5);
+      break;
+    case Op::Op_Sra:
+      shift_reg(7);
+      break;
+    case Op::Op_Or:
+      alu_reg(kOrLoad);
+      break;
+    case Op::Op_And:
+      alu_reg(kAndLoad);
+      break;
+    case Op::Op_Fence:
+      break;
+    default:
+      LOG(FATAL) << "Untranslatable operation " << decoded.op;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitTrampoline() {
+  // enter(context, block): push rbx, r12, r13; rbx = context;
+  // r12 = guest data; r13 = block table; jmp block
+  enter_ = reinterpret_cast<EntryFn>(buffer_ + buffer_used_);
+  EmitBytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xfb});
+  Emit8(0x4c);
+  EmitContextAccess(kMovLoad, 4, offsetof(Context, data));
+  Emit8(0x4c);
+  EmitContextAccess(kMovLoad, 5, offsetof(Context, blocks));
+  EmitBytes({0xff, 0xe6});
+
+  epilogue_ = buffer_ + buffer_used_;
+  EmitBytes({0x41, 0x5d, 0x41, 0x5c, 0x5b, 0xc3});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitExit(mem_addr_t pc, ExitReason reason) {
+  EmitContextAccess(0xc7, 0, offsetof(Context, pc));
+  Emit32(pc);
+  EmitContextAccess(0xc7, 0, offsetof(Context, exit));
+  Emit32(reason);
+  Emit8(0xe9);
+  Emit32(0);
+  PatchRel32(buffer_used_ - sizeof(uint32_t), epilogue_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitChainExit(mem_addr_t target_pc) {
+  // The leading jmp falls through to the exit until the target is chained
+  const ChainExit chain_exit{buffer_ + buffer_used_, target_pc};
+  const std::size_t index = chain_exits_.size();
+  chain_exits_.push_back(chain_exit);
+  Emit8(0xe9);
+  Emit32(0);
+  EmitExit(target_pc, static_cast<ExitReason>(kFirstChainExit + index));
+
+  if (InCode(target_pc)) {
+    uint8_t* const target = blocks_[WordIndex(target_pc)];
+    if (target != nullptr) {
+      Chain(chain_exit, target);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitSideExits(const std::vector<SideExit>& side_exits) {
+  for (const SideExit& side_exit : side_exits) {
+    PatchRel32(side_exit.jump_rel, buffer_ + buffer_used_);
+    if (side_exit.reason == Exit_CodeStore) {
+      EmitContextAccess(kMovStore, kEax, offsetof(Context, store_addr));
+    }
+    if (side_exit.refund > 0) {
+      Emit8(0x48);
+      EmitContextAccess(0x81, 0, offsetof(Context, budget));
+      Emit32(side_exit.refund);
+    }
+    EmitExit(side_exit.pc, side_exit.reason);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Chain(const ChainExit& chain_exit, uint8_t* target) {
+  const int64_t rel = target - (chain_exit.jump + 5);
+  const int32_t rel32 = static_cast<int32_t>(rel);
+  std::memcpy(chain_exit.jump + 1, &rel32, sizeof(rel32));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Emit8(uint8_t byte) { buffer_[buffer_used_++] = byte; }
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Emit32(uint32_t word) {
+  std::memcpy(buffer_ + buffer_used_, &word, sizeof(word));
+  buffer_used_ += sizeof(word);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitBytes(std::initializer_list<uint8_t> bytes) {
+  for (const uint8_t byte : bytes) {
+    Emit8(byte);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitContextAccess(uint8_t opcode, uint8_t modrm_reg,
+                                      uint32_t offset) {
+  // [rbx + disp32]
+  Emit8(opcode);
+  Emit8(static_cast<uint8_t>(0x83 | (modrm_reg << 3)));
+  Emit32(offset);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::EmitRegisterAccess(uint8_t opcode, uint8_t host_reg,
+                                       uint8_t guest_reg) {
+  EmitContextAccess(opcode, host_reg,
+                    offsetof(Context, regs) + guest_reg * sizeof(reg_data_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t JitTranslator::EmitJcc(uint8_t condition) {
+  EmitBytes({0x0f, static_cast<uint8_t>(0x80 | condition)});
+  Emit32(0);
+  return buffer_used_ - sizeof(uint32_t);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::PatchRel32(std::size_t rel_pos, const uint8_t* target) {
+  const int64_t rel = target - (buffer_ + rel_pos + sizeof(uint32_t));
+  const int32_t rel32 = static_cast<int32_t>(rel);
+  std::memcpy(buffer_ + rel_pos, &rel32, sizeof(rel32));
+}
+
+#else  // !defined(__x86_64__)
+
+////////////////////////////////////////////////////////////////////////////////
+bool JitTranslator::Supported() { return false; }
+
+////////////////////////////////////////////////////////////////////////////////
+JitTranslator::JitTranslator(FunctionalCore& core) : core_(core) {
+  LOG(FATAL) << "The JIT requires an x86-64 host";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JitTranslator::~JitTranslator() {}
+
+////////////////////////////////////////////////////////////////////////////////
+FunctionalCore::StopReason JitTranslator::Run(std::size_t max_instructions) {
+  return core_.Interpret(max_instructions);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Invalidate(mem_addr_t addr, std::size_t num_bytes) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void JitTranslator::Flush() {}
+
+#endif  // defined(__x86_64__)
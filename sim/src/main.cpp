@@ -2,14 +2,54 @@
 #include <glog/logging.h>
 
 #include <iostream>
+#include <map>
 #include <memory>
+#include <string>
 
+#include <checkpoint.hpp>
 #include <command_interpreter.hpp>
 #include <cpu.hpp>
+#include <elf_loader.hpp>
+#include <event_trace.hpp>
 #include <memory.hpp>
+#include <memory_trace.hpp>
+#include <sampler.hpp>
+#include <store_buffer.hpp>
 
 // Program to execute
-DEFINE_string(riscv_binary, "", "Program to run in simulator");
+DEFINE_string(riscv_binary, "",
+              "Program to run in simulator (ELF executable or flat binary)");
+
+// Checkpoint saved with the ckpt command to resume from
+DEFINE_string(restore, "", "Checkpoint file to restore before starting");
+
+// Records accesses to the instruction and data ports for riscv_sweep --trace.
+// Cycle mode only.
+DEFINE_string(trace_file, "", "File to record the memory access trace to");
+
+// Pipeline, cache and memory events, decoded with riscv_event_trace. Needs a
+// build with -DENABLE_EVENT_TRACE=ON.
+DEFINE_string(event_trace, "", "File to dump the event trace rings to on exit");
+DEFINE_string(event_trace_categories, "fetch,hazard,cache,mem",
+              "Comma separated event categories to trace");
+
+// Simulation fidelity
+DEFINE_string(mode, "cycle",
+              "Simulation mode: functional (instruction accurate, no timing) "
+              "or cycle (pipeline and caches)");
+DEFINE_bool(jit, false,
+            "Translate guest code to host code in functional mode (x86-64)");
+DEFINE_bool(cache, true, "Put instruction and data caches in front of memory");
+
+// Sampled simulation. A non-zero detailed window runs the sampler instead of
+// the interactive interpreter.
+DEFINE_uint64(sample_fast_forward, 0,
+              "Instructions to fast-forward functionally before each sample");
+DEFINE_uint64(sample_warm_up, 0,
+              "Instructions to warm caches over before each sample");
+DEFINE_uint64(sample_detailed, 0,
+              "Instructions simulated cycle accurately in each sample");
+DEFINE_uint64(sample_max, 0, "Maximum number of samples (0 = no limit)");
 
 // Cache and memory parameters
 DEFINE_uint32(cache_line_size, 4, "Cache line size in words");
@@ -23,18 +63,77 @@ DEFINE_uint32(
     subsequent_word_latency, 1,
     "Number of cycles needed to access subsequent words in a line from memory");
 DEFINE_string(write_policy, "write_back", "Write policy for caches");
+DEFINE_string(replacement_policy, "lru",
+              "Replacement policy for caches: lru, plru, srrip, brrip, fifo "
+              "or random");
+
+// Non-blocking data cache. Loads missing in it only stall the instructions
+// that use their data.
+DEFINE_uint32(mshrs, 0,
+              "Outstanding misses the data cache tracks (0 = blocking cache)");
+
+// Stores wait in a buffer in front of the data cache, coalescing by line and
+// forwarding to loads, while the cache takes them in the background
+DEFINE_uint32(store_buffer_entries, 0,
+              "Lines in the store buffer (0 = stores go straight to the "
+              "data cache)");
+
+// Hardware prefetchers watching the demand accesses to each L1 cache
+DEFINE_string(prefetcher, "none",
+              "Data cache prefetcher: none, next_line, stride or stream");
+DEFINE_string(instr_prefetcher, "none",
+              "Instruction cache prefetcher: none, next_line, stride or "
+              "stream");
+DEFINE_uint32(prefetch_degree, 1, "Lines prefetched ahead per trigger");
+DEFINE_uint32(prefetch_table_size, 64,
+              "Entries in the stride prefetcher's PC indexed table");
+DEFINE_uint32(prefetch_streams, 4, "Streams tracked by the stream prefetcher");
+DEFINE_uint32(prefetch_buffer_lines, 0,
+              "Lines in a prefetch buffer beside each cache (0 = prefetch "
+              "into the cache)");
+
+// Unified L2 shared by the instruction and data caches. Its misses go to data
+// memory, which holds the program's code as well.
+DEFINE_uint32(l2_num_cache_lines, 0, "Number of lines in L2 cache (0 = no L2)");
+DEFINE_uint32(l2_cache_line_size, 4, "L2 cache line size in words");
+DEFINE_uint32(l2_set_associativity, 4, "Set associativity of L2 cache");
+DEFINE_uint32(l2_cache_latency, 8, "Number of cycles for L2 cache hit");
+DEFINE_string(l2_inclusion, "non_inclusive",
+              "L2 inclusion policy: inclusive, exclusive or non_inclusive");
+DEFINE_string(l2_replacement_policy, "lru", "Replacement policy for L2 cache");
+
+namespace {
+
+void DumpEventTrace() {
+  if (!FLAGS_event_trace.empty()) {
+    Tracer::Dump(FLAGS_event_trace);
+  }
+}
+
+}  // namespace
 
 int main(int argc, char* argv[]) {
   google::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
 
+  if (!FLAGS_event_trace.empty()) {
+    if (!Tracer::kCompiledIn) {
+      LOG(WARNING) << "Event tracing is compiled out; rebuild with "
+                      "ENABLE_EVENT_TRACE";
+    }
+    Tracer::EnableCategories(FLAGS_event_trace_categories);
+  }
+
   // Read in memory params and init memories
   const std::size_t FIRST_WORD_LATENCY{FLAGS_first_word_latency};
 
-  MemoryPtr instr_mem = std::make_shared<InstructionMemory>(
-      InstructionMemory(FLAGS_riscv_binary, FIRST_WORD_LATENCY));
-  MemoryPtr data_mem =
-      std::make_shared<DataMemory>(DataMemory(FIRST_WORD_LATENCY));
+  // Data memory spans the address space so stacks and heaps can go anywhere
+  auto data = std::make_shared<DataMemory>(
+      DataMemory(FIRST_WORD_LATENCY, MainMemoryBase::kAddressSpaceSize));
+  MemoryPtr data_mem = data;
+  mem_addr_t entry_point = 0;
+  MemoryPtr instr_mem = ElfImage::LoadProgram(
+      FLAGS_riscv_binary, FIRST_WORD_LATENCY, *data, entry_point);
 
   // Read in cache params and init caches
   const std::size_t LINE_SIZE{FLAGS_cache_line_size * sizeof(word_t)};
@@ -49,22 +148,125 @@ int main(int argc, char* argv[]) {
       << "Unknown/Unsupported write policy!";
 
   CacheWritePolicy WRITE_POLICY =
-      (WRITE_POLICY_STR.compare("write_back") ? CacheWritePolicy::WriteBack
-                                              : CacheWritePolicy::WriteThrough);
+      (WRITE_POLICY_STR.compare("write_back") == 0
+           ? CacheWritePolicy::WriteBack
+           : CacheWritePolicy::WriteThrough);
+  const ReplacementPolicyType REPLACEMENT_POLICY{
+      ReplacementPolicy::TypeFromName(FLAGS_replacement_policy)};
+
+  // Read in L2 params and init the L2 both L1 caches miss to
+  std::shared_ptr<CacheBase> l2_cache;
+  if (FLAGS_cache && FLAGS_l2_num_cache_lines > 0) {
+    const std::map<std::string, InclusionPolicy> INCLUSION_POLICIES{
+        {"inclusive", InclusionPolicy::Inclusive},
+        {"exclusive", InclusionPolicy::Exclusive},
+        {"non_inclusive", InclusionPolicy::NonInclusive}};
+    const auto inclusion = INCLUSION_POLICIES.find(FLAGS_l2_inclusion);
+    CHECK(inclusion != INCLUSION_POLICIES.end())
+        << "Unknown L2 inclusion policy: " << FLAGS_l2_inclusion;
+
+    l2_cache = std::make_shared<SetAssociativeCache>(SetAssociativeCache(
+        data_mem, FLAGS_l2_cache_line_size * sizeof(word_t),
+        FLAGS_l2_num_cache_lines, FLAGS_l2_set_associativity,
+        FLAGS_l2_cache_latency, SUBSEQUENT_WORD_LATENCY, WRITE_POLICY,
+        ReplacementPolicy::TypeFromName(FLAGS_l2_replacement_policy)));
+    l2_cache->SetInclusionPolicy(inclusion->second);
 
-  MemoryPtr instr_cache = std::make_shared<LRUCache>(
-      LRUCache(instr_mem, LINE_SIZE, NUM_LINES, SET_ASSOCIATIVITY,
-               CACHE_LATENCY, SUBSEQUENT_WORD_LATENCY, WRITE_POLICY));
-  MemoryPtr data_cache = std::make_shared<LRUCache>(
-      LRUCache(data_mem, LINE_SIZE, NUM_LINES, SET_ASSOCIATIVITY, CACHE_LATENCY,
-               SUBSEQUENT_WORD_LATENCY, WRITE_POLICY));
+    // Fetches through the L2 come from data memory, which flat binaries are
+    // not loaded into
+    if (!ElfImage::IsElf(FLAGS_riscv_binary)) {
+      const auto* code = static_cast<const MainMemoryBase*>(instr_mem.get());
+      data->WriteBlock(code->GetBase(), code->Data(), code->GetSize());
+    }
+  }
+
+  MemoryPtr instr_cache = instr_mem;
+  MemoryPtr data_cache = data_mem;
+  if (FLAGS_cache) {
+    auto l1_instr_cache =
+        std::make_shared<SetAssociativeCache>(SetAssociativeCache(
+            l2_cache ? l2_cache : instr_mem, LINE_SIZE, NUM_LINES,
+            SET_ASSOCIATIVITY, CACHE_LATENCY, SUBSEQUENT_WORD_LATENCY,
+            WRITE_POLICY, REPLACEMENT_POLICY));
+    auto l1_data_cache =
+        std::make_shared<SetAssociativeCache>(SetAssociativeCache(
+            l2_cache ? l2_cache : data_mem, LINE_SIZE, NUM_LINES,
+            SET_ASSOCIATIVITY, CACHE_LATENCY, SUBSEQUENT_WORD_LATENCY,
+            WRITE_POLICY, REPLACEMENT_POLICY));
+    if (l2_cache) {
+      l2_cache->AddUpperLevel(l1_instr_cache);
+      l2_cache->AddUpperLevel(l1_data_cache);
+    }
+
+    Prefetcher::Params prefetch_params;
+    prefetch_params.line_size = LINE_SIZE;
+    prefetch_params.degree = FLAGS_prefetch_degree;
+    prefetch_params.table_size = FLAGS_prefetch_table_size;
+    prefetch_params.num_streams = FLAGS_prefetch_streams;
+    const PrefetchTarget PREFETCH_TARGET{FLAGS_prefetch_buffer_lines > 0
+                                             ? PrefetchTarget::Buffer
+                                             : PrefetchTarget::Cache};
+    l1_instr_cache->SetPrefetcher(
+        Prefetcher::Create(Prefetcher::TypeFromName(FLAGS_instr_prefetcher),
+                           prefetch_params),
+        PREFETCH_TARGET, FLAGS_prefetch_buffer_lines);
+    l1_data_cache->SetPrefetcher(
+        Prefetcher::Create(Prefetcher::TypeFromName(FLAGS_prefetcher),
+                           prefetch_params),
+        PREFETCH_TARGET, FLAGS_prefetch_buffer_lines);
+    l1_data_cache->SetMSHRs(FLAGS_mshrs);
+    instr_cache = l1_instr_cache;
+    data_cache = l1_data_cache;
+    if (FLAGS_store_buffer_entries > 0) {
+      data_cache = std::make_shared<StoreBuffer>(
+          l1_data_cache, FLAGS_store_buffer_entries, LINE_SIZE);
+    }
+  }
+
+  if (!FLAGS_trace_file.empty()) {
+    // Functional runs go straight to main memory, past the tracing ports
+    CHECK(FLAGS_mode == "cycle") << "--trace_file needs --mode=cycle";
+    MemoryTrace::WriterPtr trace_writer =
+        std::make_shared<MemoryTrace::Writer>(FLAGS_trace_file);
+    instr_cache = std::make_shared<TracingMemory>(
+        instr_cache, MemoryTrace::Port::Instruction, trace_writer);
+    data_cache = std::make_shared<TracingMemory>(
+        data_cache, MemoryTrace::Port::Data, trace_writer);
+  }
+
+  CHECK(FLAGS_mode == "functional" || FLAGS_mode == "cycle")
+      << "Unknown simulation mode: " << FLAGS_mode;
+  const SimulationMode MODE{FLAGS_mode == "functional"
+                                ? SimulationMode::Functional
+                                : SimulationMode::Cycle};
 
   // Init CPU
-  CpuPtr cpu = std::make_shared<CPU>(CPU(instr_cache, data_cache));
+  // Behind an L2 the instruction port ends in data memory, but functional
+  // mode still decodes from instruction memory
+  CpuPtr cpu = std::make_shared<CPU>(CPU(instr_cache, data_cache, MODE,
+                                         l2_cache ? instr_mem : nullptr));
+  cpu->GetPC()->SetEntryPoint(entry_point);
+  cpu->SetJitEnabled(FLAGS_jit);
+  if (!FLAGS_restore.empty()) {
+    Checkpoint::Restore(*cpu, FLAGS_restore);
+  }
+
+  if (FLAGS_sample_detailed > 0) {
+    Sampler::Params params;
+    params.fast_forward = FLAGS_sample_fast_forward;
+    params.warm_up = FLAGS_sample_warm_up;
+    params.detailed = FLAGS_sample_detailed;
+    params.max_samples = FLAGS_sample_max;
+    Sampler sampler(cpu, params);
+    Sampler::PrintResults(sampler.Run());
+    DumpEventTrace();
+    return 0;
+  }
 
   // Init interpreter
   CommandInterpreter interpreter(cpu, instr_mem, data_mem);
 
   interpreter.MainLoop();
+  DumpEventTrace();
   return 0;
 }
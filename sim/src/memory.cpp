@@ -1,13 +1,59 @@
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 #include <memory.hpp>
 
+constexpr std::size_t MainMemoryBase::kAddressSpaceSize;
+constexpr unsigned MainMemoryBase::kWrittenPageShift;
+constexpr std::size_t InstructionMemory::kDefaultMemSize;
+constexpr uint32_t CacheBase::kInvalidTag;
+
+namespace {
+
+// Compares tag against the kTagLanes tags starting at tags, returning a mask
+// with bit n set if tags[n] matches
+#if defined(__AVX2__)
+constexpr std::size_t kTagLanes{8};
+
+uint32_t MatchTags(const uint32_t* tags, uint32_t tag) {
+  const __m256i matches = _mm256_cmpeq_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags)),
+      _mm256_set1_epi32(tag));
+  return _mm256_movemask_ps(_mm256_castsi256_ps(matches));
+}
+#elif defined(__SSE2__)
+constexpr std::size_t kTagLanes{4};
+
+uint32_t MatchTags(const uint32_t* tags, uint32_t tag) {
+  const __m128i matches =
+      _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tags)),
+                      _mm_set1_epi32(tag));
+  return _mm_movemask_ps(_mm_castsi128_ps(matches));
+}
+#else
+constexpr std::size_t kTagLanes{1};
+
+uint32_t MatchTags(const uint32_t* tags, uint32_t tag) {
+  return (*tags == tag) ? 1 : 0;
+}
+#endif
+
+}  // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 MemoryBase::MemoryBase(std::size_t size, std::size_t latency)
     : HardwareObject(), size_(size), latency_(latency), last_latency_(0) {}
@@ -21,6 +67,27 @@ void MemoryBase::Reset() {
   HardwareObject::Reset();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void MemoryBase::Flush() {}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryBase* MemoryBase::NextLevel() const { return nullptr; }
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryBase::ReadBlock(mem_addr_t addr, uint8_t* data, std::size_t size) {
+  for (std::size_t offset = 0; offset < size; ++offset) {
+    data[offset] = ReadByte(addr + offset);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryBase::WriteBlock(mem_addr_t addr, const uint8_t* data,
+                            std::size_t size) {
+  for (std::size_t offset = 0; offset < size; ++offset) {
+    WriteByte(addr + offset, data[offset]);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 std::size_t MemoryBase::GetLatency() { return latency_; }
 
@@ -31,7 +98,7 @@ std::size_t MemoryBase::GetAccessLatency() { return last_latency_; }
 void MemoryBase::CoreDump(mem_addr_t start_addr, mem_addr_t end_addr,
                           std::ostream& output_stream, std::size_t width) {
   output_stream << "\n\nMemory Dump\nMemory Size = " << size_ << std::endl;
-  const mem_addr_t actual_end_addr = (end_addr == 0) ? size_ : end_addr;
+  const std::size_t actual_end_addr = (end_addr == 0) ? size_ : end_addr;
   CHECK(start_addr < size_) << "Start address is out of bounds";
   CHECK(end_addr < size_) << "End address is out of bounds";
   const int width_scaler = sizeof(instr_t) * width;
@@ -51,9 +118,38 @@ void MemoryBase::CoreDump(mem_addr_t start_addr, mem_addr_t end_addr,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-MainMemoryBase::MainMemoryBase(std::size_t size, std::size_t first_word_latency)
-    : MemoryBase(size, first_word_latency) {
-  mem_.resize(size_, 0);
+MainMemoryBase::MainMemoryBase(std::size_t size, std::size_t first_word_latency,
+                               mem_addr_t base)
+    : MemoryBase(size, first_word_latency), base_(base) {
+  CHECK(base_ + size_ <= kAddressSpaceSize)
+      << "Memory extends past the address space";
+  if (size_ > 0) {
+    // Fresh anonymous pages read as zero and are only backed once touched
+    void* mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    CHECK(mem != MAP_FAILED) << "Unable to map " << size_ << " bytes of memory";
+    mem_ = static_cast<uint8_t*>(mem);
+  }
+  written_pages_.resize(
+      (size_ + (std::size_t{1} << kWrittenPageShift) - 1) >>
+      kWrittenPageShift);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MainMemoryBase::MainMemoryBase(MainMemoryBase&& other)
+    : MemoryBase(other),
+      mem_(other.mem_),
+      base_(other.base_),
+      written_pages_(std::move(other.written_pages_)) {
+  other.mem_ = nullptr;
+  other.size_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MainMemoryBase::~MainMemoryBase() {
+  if (mem_ != nullptr) {
+    munmap(mem_, size_);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -92,6 +188,91 @@ void MainMemoryBase::WriteWord(mem_addr_t addr, uint32_t data) {
   Write<uint32_t>(addr, data);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void MainMemoryBase::ReadBlock(mem_addr_t addr, uint8_t* data,
+                               std::size_t size) {
+  CheckSpan(addr, size);
+  std::memcpy(data, mem_ + Offset(addr), size);
+  TRACE_EVENT(Mem, MemRead, cycle_counter_, addr, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MainMemoryBase::WriteBlock(mem_addr_t addr, const uint8_t* data,
+                                std::size_t size) {
+  std::memcpy(Span(addr, size), data, size);
+  TRACE_EVENT(Mem, MemWrite, cycle_counter_, addr, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t* MainMemoryBase::Span(mem_addr_t addr, std::size_t size) {
+  CheckSpan(addr, size);
+  if (size > 0) {
+    MarkWritten(addr, size);
+  }
+  return mem_ + Offset(addr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MainMemoryBase::CheckSpan(mem_addr_t addr, std::size_t size) const {
+  CHECK(Offset(addr) < size_ && size <= size_ - Offset(addr))
+      << "Attempting to access invalid block: " << std::hex << std::showbase
+      << addr << " + " << size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::size_t> MainMemoryBase::TouchedPages(
+    std::size_t page_size) const {
+  std::vector<std::size_t> pages;
+  for (std::size_t page = 0; page * page_size < size_; ++page) {
+    const std::size_t page_end = std::min(size_, (page + 1) * page_size);
+    for (std::size_t written = (page * page_size) >> kWrittenPageShift;
+         (written << kWrittenPageShift) < page_end; ++written) {
+      if (written_pages_[written]) {
+        pages.push_back(page);
+        break;
+      }
+    }
+  }
+  return pages;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MainMemoryBase::Clear() {
+  if (mem_ != nullptr) {
+    // Mapping fresh pages over the old ones also drops any image
+    void* mem = mmap(mem_, size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                     -1, 0);
+    CHECK(mem == mem_) << "Unable to release memory";
+  }
+  std::fill(written_pages_.begin(), written_pages_.end(), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MainMemoryBase::MapImage(int fd, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const std::size_t host_page_size = sysconf(_SC_PAGESIZE);
+  const std::size_t mapped_size =
+      (size + host_page_size - 1) / host_page_size * host_page_size;
+  if (mapped_size <= size_) {
+    // Bytes past the end of the file in its last page read as zero
+    void* image = mmap(mem_, mapped_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_FIXED, fd, 0);
+    CHECK(image == mem_) << "Unable to map image";
+  } else {
+    // The memory ends inside the image's last page, so copy it instead
+    for (std::size_t offset = 0; offset < size;) {
+      const ssize_t bytes_read =
+          pread(fd, mem_ + offset, size - offset, offset);
+      CHECK(bytes_read > 0) << "Image read failed!";
+      offset += bytes_read;
+    }
+  }
+  MarkWritten(base_, size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 InstructionMemory::InstructionMemory(const std::string& image_name,
                                      std::size_t latency, std::size_t size)
@@ -99,27 +280,25 @@ InstructionMemory::InstructionMemory(const std::string& image_name,
   LoadImage(image_name);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+InstructionMemory::InstructionMemory(std::size_t latency, std::size_t size,
+                                     mem_addr_t base)
+    : MainMemoryBase(size, latency, base) {}
+
 ////////////////////////////////////////////////////////////////////////////////
 void InstructionMemory::LoadImage(const std::string& image_name) {
   CHECK(!image_name.empty()) << "Please provide image!";
 
-  std::ifstream image_stream =
-      std::ifstream(image_name, (std::ios::in | std::ios::binary));
-  CHECK(image_stream.is_open()) << "Couldn't open image!";
+  const int image_fd = open(image_name.c_str(), O_RDONLY);
+  CHECK(image_fd >= 0) << "Couldn't open image!";
+  struct stat image_stat;
+  CHECK(fstat(image_fd, &image_stat) == 0) << "Couldn't stat image!";
 
-  image_stream.seekg(0, std::ios::end);
-  const std::size_t bin_file_size = image_stream.tellg();
+  const std::size_t bin_file_size = image_stat.st_size;
   VLOG(2) << "Binary file of size: " << bin_file_size;
   CHECK(bin_file_size <= size_) << "Image too large for instruction memory!";
-
-  image_stream.seekg(0, std::ios::beg);
-  for (std::size_t ii = 0; ii < bin_file_size; ++ii) {
-    char buf = 0;
-    CHECK(image_stream.read(&buf, 1)) << "Image stream read failed!";
-    VLOG(5) << std::hex << std::showbase << "Address: " << ii << ": "
-            << static_cast<int>(buf);
-    mem_.at(ii) = buf;
-  }
+  MapImage(image_fd, bin_file_size);
+  close(image_fd);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -130,41 +309,88 @@ DataMemory::DataMemory(std::size_t latency, std::size_t size)
 CacheBase::CacheBase(MemoryPtr mem, std::size_t line_size_bytes,
                      std::size_t num_lines, std::size_t set_associativity,
                      std::size_t latency, std::size_t subsequent_latency,
-                     CacheWritePolicy write_policy)
-    : MemoryBase((line_size_bytes_ * num_lines_), latency),
+                     CacheWritePolicy write_policy,
+                     ReplacementPolicyType replacement_policy)
+    : MemoryBase((line_size_bytes * num_lines), latency),
       main_mem_(mem),
+      next_cache_(dynamic_cast<CacheBase*>(mem.get())),
       line_size_bytes_(line_size_bytes),
       num_lines_(num_lines / set_associativity),
       set_associativity_(set_associativity),
       subsequent_latency_(subsequent_latency),
       write_policy_(write_policy) {
+  CHECK(line_size_bytes_ >= sizeof(word_t))
+      << "Cache lines must hold at least a word";
   swapin_counter_max_ = line_size_bytes / sizeof(word_t) * subsequent_latency;
-  caches_.resize(
-      set_associativity_,
-      std::vector<CacheLine>(num_lines_, CacheLine(line_size_bytes_)));
+  const std::size_t total_lines = num_lines_ * set_associativity_;
+  tags_.resize(total_lines + kTagLanes - 1);
+  dirty_.resize(total_lines);
+  prefetched_.resize(total_lines);
+  fill_starts_.resize(total_lines);
+  data_.resize(total_lines * line_size_bytes_);
+  replacement_policy_ = ReplacementPolicy::Create(
+      replacement_policy, num_lines_, set_associativity_);
+  Reset();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CacheBase::ExecuteCycle() {
-  for (auto& cache : caches_) {
-    for (auto& line : cache) {
-      if (line.swapin_counter < swapin_counter_max_) {
-        ++line.swapin_counter;
-      }
+void CacheBase::Reset() {
+  std::fill(tags_.begin(), tags_.end(), kInvalidTag);
+  std::fill(dirty_.begin(), dirty_.end(), false);
+  ResetTransientState();
+  std::fill(fill_starts_.begin(), fill_starts_.end(), 0);
+  std::fill(data_.begin(), data_.end(), 0);
+  replacement_policy_->Reset();
+  num_hits_ = 0;
+  num_misses_ = 0;
+  num_writebacks_ = 0;
+  num_back_invalidations_ = 0;
+  num_prefetches_ = 0;
+  num_useful_prefetches_ = 0;
+  num_late_prefetches_ = 0;
+  num_mshr_merges_ = 0;
+  num_mshr_stalls_ = 0;
+  request_pc_ = 0;
+  MemoryBase::Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::ResetTransientState() {
+  std::fill(prefetched_.begin(), prefetched_.end(), false);
+  std::fill(prefetch_buffer_.begin(), prefetch_buffer_.end(), BufferedLine{});
+  prefetch_buffer_next_ = 0;
+  if (prefetcher_ != nullptr) {
+    prefetcher_->Reset();
+  }
+  prefetch_pending_ = false;
+  std::fill(mshrs_.begin(), mshrs_.end(), MSHR{});
+  data_latency_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::Flush() {
+  if (next_cache_ != nullptr) {
+    next_cache_->CatchUp(cycle_counter_);
+  }
+  for (std::size_t line = 0; line < dirty_.size(); ++line) {
+    if (LineValid(line) && dirty_[line] &&
+        write_policy_ == CacheWritePolicy::WriteBack) {
+      WriteLine(GetAddress(tags_[line], line / set_associativity_, 0), line);
     }
+    tags_[line] = kInvalidTag;
+    dirty_[line] = false;
   }
-  MemoryBase::ExecuteCycle();
+  std::fill(prefetch_buffer_.begin(), prefetch_buffer_.end(), BufferedLine{});
+  main_mem_->Flush();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CacheBase::Reset() {
-  caches_.clear();
-  caches_.resize(
-      set_associativity_,
-      std::vector<CacheLine>(num_lines_, CacheLine(line_size_bytes_)));
-  num_hits_ = 0;
-  num_misses_ = 0;
-  MemoryBase::Reset();
+MemoryBase* CacheBase::NextLevel() const { return main_mem_.get(); }
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::SetRequestPC(mem_addr_t pc) {
+  request_pc_ = pc;
+  main_mem_->SetRequestPC(pc);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -203,6 +429,150 @@ void CacheBase::WriteWord(mem_addr_t addr, uint32_t data) {
   Write<uint32_t>(addr, data);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::ReadBlock(mem_addr_t addr, uint8_t* data, std::size_t size) {
+  std::size_t block_latency = 0;
+  while (size > 0) {
+    const std::size_t line_offset = GetLineOffset(addr);
+    const std::size_t chunk = std::min(size, line_size_bytes_ - line_offset);
+    std::size_t set = 0;
+    if (inclusion_policy_ != InclusionPolicy::Exclusive) {
+      const std::size_t line = LocateLine(addr);
+      std::memcpy(data, LineData(line) + line_offset, chunk);
+      Prefetch();
+      // Fills of the caches above wait for their data
+      last_latency_ = data_latency_;
+    } else if (FindLine(addr, set)) {
+      // The line moves up, leaving memory to hold it if it is dirty
+      const std::size_t line = LineNumber(set, addr);
+      ++num_hits_;
+      last_latency_ = latency_;
+      if (FillCycles(line) < swapin_counter_max_) {
+        last_latency_ += subsequent_latency_;
+      }
+      TRACE_EVENT(Cache, CacheHit, cycle_counter_, addr, set);
+      std::memcpy(data, LineData(line) + line_offset, chunk);
+      if (dirty_[line]) {
+        WriteLine(addr, line);
+      }
+      tags_[line] = kInvalidTag;
+      dirty_[line] = false;
+    } else {
+      // Misses fill the level above without allocating here
+      ++num_misses_;
+      TRACE_EVENT(Cache, CacheMiss, cycle_counter_, addr, set);
+      if (next_cache_ != nullptr) {
+        next_cache_->CatchUp(cycle_counter_);
+      }
+      main_mem_->ReadBlock(addr, data, chunk);
+      last_latency_ = latency_ + NextLevelLatency();
+    }
+    block_latency += last_latency_;
+    addr += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  last_latency_ = block_latency;
+  data_latency_ = block_latency;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::WriteBlock(mem_addr_t addr, const uint8_t* data,
+                           std::size_t size) {
+  std::size_t block_latency = 0;
+  while (size > 0) {
+    const std::size_t line_offset = GetLineOffset(addr);
+    const std::size_t chunk = std::min(size, line_size_bytes_ - line_offset);
+    if (inclusion_policy_ == InclusionPolicy::Exclusive &&
+        chunk == line_size_bytes_) {
+      InsertVictim(addr, data, true);
+      last_latency_ = latency_;
+    } else {
+      const std::size_t line = LocateLine(addr);
+      last_latency_ = data_latency_;
+      std::memcpy(LineData(line) + line_offset, data, chunk);
+      dirty_[line] = true;
+      if (write_policy_ == CacheWritePolicy::WriteThrough) {
+        if (next_cache_ != nullptr) {
+          next_cache_->CatchUp(cycle_counter_);
+        }
+        main_mem_->WriteBlock(addr, data, chunk);
+      }
+      Prefetch();
+    }
+    block_latency += last_latency_;
+    addr += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  last_latency_ = block_latency;
+  data_latency_ = block_latency;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::SetInclusionPolicy(InclusionPolicy inclusion_policy) {
+  inclusion_policy_ = inclusion_policy;
+  for (const auto& upper_level : upper_levels_) {
+    if (const auto upper = upper_level.lock()) {
+      CHECK(inclusion_policy_ != InclusionPolicy::Exclusive ||
+            (upper->line_size_bytes_ == line_size_bytes_ &&
+             upper->write_policy_ == CacheWritePolicy::WriteBack))
+          << "Caches above an exclusive level must be write back and share "
+             "its line size";
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::AddUpperLevel(const std::shared_ptr<CacheBase>& upper) {
+  CHECK(upper->next_cache_ == this) << "Cache does not miss to this level";
+  CHECK(upper->line_size_bytes_ <= line_size_bytes_)
+      << "Caches above must not have larger lines";
+  upper_levels_.push_back(upper);
+  // Rechecks the new level against the policy
+  SetInclusionPolicy(inclusion_policy_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::SetPrefetcher(PrefetcherPtr prefetcher, PrefetchTarget target,
+                              std::size_t buffer_lines) {
+  CHECK(target == PrefetchTarget::Cache || buffer_lines > 0)
+      << "Prefetch buffers need lines";
+  prefetcher_ = prefetcher;
+  prefetch_target_ = target;
+  prefetch_buffer_.assign(
+      target == PrefetchTarget::Buffer ? buffer_lines : 0, BufferedLine{});
+  prefetch_buffer_data_.assign(prefetch_buffer_.size() * line_size_bytes_, 0);
+  prefetch_buffer_next_ = 0;
+  const MemoryBase* backing = this;
+  while (backing->NextLevel() != nullptr) {
+    backing = backing->NextLevel();
+  }
+  const auto* main_mem = dynamic_cast<const MainMemoryBase*>(backing);
+  prefetch_base_ = (main_mem != nullptr) ? main_mem->GetBase() : 0;
+  prefetch_limit_ = backing->GetSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::SetMSHRs(std::size_t num_mshrs) {
+  mshrs_.assign(num_mshrs, MSHR{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double CacheBase::GetPrefetchAccuracy() const {
+  return (num_prefetches_ == 0) ? 0.0
+                                : static_cast<double>(num_useful_prefetches_) /
+                                      static_cast<double>(num_prefetches_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double CacheBase::GetPrefetchCoverage() const {
+  const std::size_t misses = num_useful_prefetches_ + num_misses_;
+  return (misses == 0) ? 0.0
+                       : static_cast<double>(num_useful_prefetches_) /
+                             static_cast<double>(misses);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 std::size_t CacheBase::GetTag(mem_addr_t addr) const {
   const std::size_t tag_offset = __builtin_ctz(line_size_bytes_ * num_lines_);
@@ -242,94 +612,361 @@ mem_addr_t CacheBase::GetBaseAddress(mem_addr_t mem_addr) const {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-CacheBase::CacheLine& CacheBase::LocateLine(mem_addr_t mem_addr) {
+std::size_t CacheBase::LineNumber(std::size_t set, mem_addr_t mem_addr) const {
+  return GetLineIndex(mem_addr) * set_associativity_ + set;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CacheBase::LocateLine(mem_addr_t mem_addr) {
   std::size_t set = 0;
-  const bool hit = FindLine(mem_addr, set);
-  if (!hit) {
-    VLOG(3) << "Cache miss!";
+  bool miss = !FindLine(mem_addr, set);
+  if (miss && next_cache_ != nullptr) {
+    next_cache_->CatchUp(cycle_counter_);
+  }
+  miss = miss && !FillFromPrefetchBuffer(mem_addr, set);
+  if (miss) {
     set = HandleCacheMiss(mem_addr);
     ++num_misses_;
-    last_latency_ = main_mem_->GetLatency() + latency_;
+    last_latency_ = NextLevelLatency() + latency_;
+    TRACE_EVENT(Cache, CacheMiss, cycle_counter_, mem_addr, set);
   } else {
     ++num_hits_;
     last_latency_ = latency_;
+    TRACE_EVENT(Cache, CacheHit, cycle_counter_, mem_addr, set);
+    replacement_policy_->Touch(GetLineIndex(mem_addr), set);
   }
-  CacheLine& line = Line(set, mem_addr);
-  // Update timestamp (used for LRU)
-  line.timestamp = cycle_counter_;
-  if (line.swapin_counter < swapin_counter_max_) {
-    last_latency_ += subsequent_latency_;
+  const std::size_t line = LineNumber(set, mem_addr);
+  if (miss && !mshrs_.empty()) {
+    // The access completes like a hit while its line is on the way
+    last_latency_ = latency_;
+    fill_starts_[line] =
+        AllocateMSHR(GetBaseAddress(mem_addr), NextLevelLatency());
+  }
+  const bool prefetch_hit = prefetched_[line];
+  const bool arriving = (fill_starts_[line] > cycle_counter_);
+  if (prefetch_hit) {
+    prefetched_[line] = false;
+    ++num_useful_prefetches_;
+    // Demanded before it arrived, waiting out the rest of the fetch
+    num_late_prefetches_ += arriving;
+  } else if (arriving && !miss) {
+    ++num_mshr_merges_;
+  }
+
+  // Blocking caches hold the access until its data arrives. Non-blocking
+  // ones only hold up the data.
+  const std::size_t wait = arriving ? fill_starts_[line] - cycle_counter_ : 0;
+  const std::size_t word_wait =
+      (FillCycles(line) < swapin_counter_max_) ? subsequent_latency_ : 0;
+  if (mshrs_.empty()) {
+    last_latency_ += wait + word_wait;
+    data_latency_ = last_latency_;
+  } else {
+    data_latency_ = std::max(last_latency_, latency_ + wait + word_wait);
+  }
+  if (prefetcher_ != nullptr) {
+    prefetch_access_ =
+        Prefetcher::Access{request_pc_, mem_addr, miss, prefetch_hit};
+    prefetch_pending_ = true;
   }
   return line;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CacheBase::FindLine(mem_addr_t mem_addr, std::size_t& set) const {
-  const std::size_t line_idx = GetLineIndex(mem_addr);
-  const std::size_t tag = GetTag(mem_addr);
-  for (set = 0; set < set_associativity_; ++set) {
-    if (caches_.at(set).at(line_idx).tag == tag &&
-        caches_.at(set).at(line_idx).valid_bit) {
-      break;
+  return FindTag(mem_addr, GetTag(mem_addr), set);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CacheBase::FindTag(mem_addr_t mem_addr, uint32_t tag,
+                        std::size_t& set) const {
+  const uint32_t* index_tags = tags_.data() + LineNumber(0, mem_addr);
+  for (std::size_t first_set = 0; first_set < set_associativity_;
+       first_set += kTagLanes) {
+    uint32_t matches = MatchTags(index_tags + first_set, tag);
+    // Lanes past the last set hold the next index's tags
+    const std::size_t num_sets = set_associativity_ - first_set;
+    if (num_sets < kTagLanes) {
+      matches &= (1u << num_sets) - 1;
+    }
+    if (matches != 0) {
+      set = first_set + __builtin_ctz(matches);
+      return true;
     }
   }
-  return (set != set_associativity_);
+  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-const CacheBase::CacheLine& CacheBase::Line(std::size_t set,
-                                            mem_addr_t mem_addr) const {
-  const std::size_t line_idx = GetLineIndex(mem_addr);
-  return caches_.at(set).at(line_idx);
+std::size_t CacheBase::FillCycles(std::size_t line) const {
+  if (fill_starts_[line] > cycle_counter_) {
+    return 0;
+  }
+  return std::min(swapin_counter_max_, cycle_counter_ - fill_starts_[line]);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-CacheBase::CacheLine& CacheBase::Line(std::size_t set, mem_addr_t mem_addr) {
-  const std::size_t line_idx = GetLineIndex(mem_addr);
-  return caches_.at(set).at(line_idx);
+void CacheBase::ReadLine(mem_addr_t mem_addr, std::size_t line) {
+  // determine base address of line
+  const mem_addr_t line_base_addr = (mem_addr & ~(line_size_bytes_ - 1));
+  main_mem_->ReadBlock(line_base_addr, LineData(line), line_size_bytes_);
+  tags_[line] = GetTag(mem_addr);
+  dirty_[line] = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CacheBase::ReadLine(mem_addr_t mem_addr, CacheLine& cache_line) {
+void CacheBase::WriteLine(mem_addr_t mem_addr, std::size_t line) {
   // determine base address of line
-  //  VLOG(1) << "Read MemAddr: " << mem_addr;
   const mem_addr_t line_base_addr = (mem_addr & ~(line_size_bytes_ - 1));
-  const mem_addr_t line_end_addr = line_base_addr + line_size_bytes_;
-  VLOG(1) << "Reading in line from addresses: " << line_base_addr << " - "
-          << line_end_addr - 1;
-  for (mem_addr_t line_addr = 0; line_addr < line_size_bytes_; ++line_addr) {
-    const uint8_t next_byte = main_mem_->ReadByte(line_addr + line_base_addr);
-    cache_line.line.at(line_addr) = next_byte;
+  TRACE_EVENT(Cache, Writeback, cycle_counter_, line_base_addr,
+              line_size_bytes_);
+  ++num_writebacks_;
+  main_mem_->WriteBlock(line_base_addr, LineData(line), line_size_bytes_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::EvictFromSet(std::size_t set, mem_addr_t new_addr) {
+  const std::size_t line = LineNumber(set, new_addr);
+  if (!LineValid(line)) {
+    return;
+  }
+  const mem_addr_t victim_addr =
+      GetAddress(tags_[line], GetLineIndex(new_addr), 0);
+  if (inclusion_policy_ == InclusionPolicy::Inclusive) {
+    InvalidateAbove(victim_addr, line);
   }
-  cache_line.tag = GetTag(mem_addr);
-  cache_line.dirty_bit = false;
-  cache_line.valid_bit = true;
+  if (next_cache_ != nullptr &&
+      next_cache_->inclusion_policy_ == InclusionPolicy::Exclusive) {
+    ++num_writebacks_;
+    next_cache_->InsertVictim(victim_addr, LineData(line), dirty_[line]);
+  } else if (dirty_[line] && write_policy_ == CacheWritePolicy::WriteBack) {
+    WriteLine(victim_addr, line);
+  }
+  tags_[line] = kInvalidTag;
+  dirty_[line] = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CacheBase::WriteLine(mem_addr_t mem_addr,
-                          const CacheLine& cache_line) const {
-  // determine base address of line
-  mem_addr_t line_addr = (mem_addr & ~(line_size_bytes_ - 1));
-  for (const auto& byte : cache_line.line) {
-    main_mem_->WriteByte(line_addr++, byte);
+void CacheBase::CatchUp(std::size_t cycle) {
+  if (cycle > cycle_counter_) {
+    SkipCycles(cycle - cycle_counter_);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CacheBase::NextLevelLatency() const {
+  // Main memory has a fixed latency and does not track its last access
+  return (next_cache_ != nullptr) ? next_cache_->GetAccessLatency()
+                                  : main_mem_->GetLatency();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CacheBase::BackInvalidate(mem_addr_t addr, uint8_t* data,
+                               std::size_t size) {
+  bool dirty = false;
+  for (std::size_t offset = 0; offset < size; offset += line_size_bytes_) {
+    std::size_t set = 0;
+    if (!FindLine(addr + offset, set)) {
+      continue;
+    }
+    const std::size_t line = LineNumber(set, addr + offset);
+    if (inclusion_policy_ == InclusionPolicy::Inclusive) {
+      InvalidateAbove(addr + offset, line);
+    }
+    // Write through lines already match the level below
+    if (dirty_[line] && write_policy_ == CacheWritePolicy::WriteBack) {
+      std::memcpy(data + offset, LineData(line), line_size_bytes_);
+      dirty = true;
+    }
+    tags_[line] = kInvalidTag;
+    dirty_[line] = false;
+    ++num_back_invalidations_;
   }
+  return dirty;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::InvalidateAbove(mem_addr_t line_addr, std::size_t line) {
+  for (const auto& upper_level : upper_levels_) {
+    if (const auto upper = upper_level.lock()) {
+      if (upper->BackInvalidate(line_addr, LineData(line), line_size_bytes_)) {
+        dirty_[line] = true;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::InsertVictim(mem_addr_t addr, const uint8_t* data,
+                             bool dirty) {
+  // A buffered copy would be older than the victim
+  for (BufferedLine& buffered : prefetch_buffer_) {
+    if (buffered.valid && buffered.addr == (addr & ~(line_size_bytes_ - 1))) {
+      buffered.valid = false;
+    }
+  }
+  std::size_t set = 0;
+  if (FindLine(addr, set)) {
+    replacement_policy_->Touch(GetLineIndex(addr), set);
+  } else {
+    set = EvictLine(addr);
+    tags_[LineNumber(set, addr)] = GetTag(addr);
+    replacement_policy_->Insert(GetLineIndex(addr), set);
+  }
+  const std::size_t line = LineNumber(set, addr);
+  std::memcpy(LineData(line), data, line_size_bytes_);
+  dirty_[line] = dirty_[line] || dirty;
+  prefetched_[line] = false;
+  fill_starts_[line] = cycle_counter_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CacheBase::AllocateMSHR(mem_addr_t line_addr,
+                                    std::size_t latency) {
+  auto first_free = mshrs_.begin();
+  for (auto mshr = mshrs_.begin(); mshr != mshrs_.end(); ++mshr) {
+    if (mshr->ready > cycle_counter_ && mshr->line_addr == line_addr) {
+      ++num_mshr_merges_;
+      return mshr->ready;
+    }
+    if (mshr->ready < first_free->ready) {
+      first_free = mshr;
+    }
+  }
+  std::size_t issue = cycle_counter_;
+  if (first_free->ready > cycle_counter_) {
+    ++num_mshr_stalls_;
+    issue = first_free->ready;
+    last_latency_ += issue - cycle_counter_;
+  }
+  *first_free = MSHR{line_addr, issue + latency};
+  return first_free->ready;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 std::size_t CacheBase::HandleCacheMiss(mem_addr_t mem_addr) {
   std::size_t new_set = EvictLine(mem_addr);
-  CacheLine& new_line = Line(new_set, mem_addr);
-  new_line.swapin_counter = 0;
+  const std::size_t new_line = LineNumber(new_set, mem_addr);
+  fill_starts_[new_line] = cycle_counter_;
   const std::size_t new_tag = GetTag(mem_addr);
   const std::size_t new_line_index = GetLineIndex(mem_addr);
   const std::size_t new_line_offset = 0;
   const mem_addr_t new_mem_addr =
       GetAddress(new_tag, new_line_index, new_line_offset);
   ReadLine(new_mem_addr, new_line);
+  prefetched_[new_line] = false;
+  replacement_policy_->Insert(new_line_index, new_set);
   return new_set;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CacheBase::EvictLine(mem_addr_t new_addr) {
+  const std::size_t set = VictimSet(new_addr);
+  EvictFromSet(set, new_addr);
+  return set;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CacheBase::VictimSet(mem_addr_t new_addr) {
+  std::size_t set = 0;
+  if (!FindTag(new_addr, kInvalidTag, set)) {
+    set = replacement_policy_->Victim(GetLineIndex(new_addr));
+  }
+  return set;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CacheBase::FillFromPrefetchBuffer(mem_addr_t mem_addr, std::size_t& set) {
+  const mem_addr_t line_addr = mem_addr & ~(line_size_bytes_ - 1);
+  for (std::size_t entry = 0; entry < prefetch_buffer_.size(); ++entry) {
+    BufferedLine& buffered = prefetch_buffer_[entry];
+    if (!buffered.valid || buffered.addr != line_addr) {
+      continue;
+    }
+    set = EvictLine(mem_addr);
+    const std::size_t line = LineNumber(set, mem_addr);
+    std::memcpy(LineData(line),
+                prefetch_buffer_data_.data() + entry * line_size_bytes_,
+                line_size_bytes_);
+    tags_[line] = GetTag(mem_addr);
+    dirty_[line] = false;
+    prefetched_[line] = true;
+    fill_starts_[line] = buffered.fill_start;
+    replacement_policy_->Insert(GetLineIndex(mem_addr), set);
+    buffered.valid = false;
+    return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::Prefetch() {
+  if (!prefetch_pending_) {
+    return;
+  }
+  prefetch_pending_ = false;
+  prefetch_addrs_.clear();
+  prefetcher_->Observe(prefetch_access_, prefetch_addrs_);
+  for (const mem_addr_t line_addr : prefetch_addrs_) {
+    IssuePrefetch(line_addr);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CacheBase::IssuePrefetch(mem_addr_t line_addr) {
+  std::size_t set = 0;
+  if (static_cast<std::size_t>(
+          static_cast<mem_addr_t>(line_addr - prefetch_base_)) +
+              line_size_bytes_ >
+          prefetch_limit_ ||
+      FindLine(line_addr, set)) {
+    return;
+  }
+  for (const BufferedLine& buffered : prefetch_buffer_) {
+    if (buffered.valid && buffered.addr == line_addr) {
+      return;
+    }
+  }
+  // Prefetches only take MSHRs left idle by demand misses
+  if (!mshrs_.empty() &&
+      std::none_of(mshrs_.begin(), mshrs_.end(), [&](const MSHR& mshr) {
+        return mshr.ready <= cycle_counter_;
+      })) {
+    return;
+  }
+
+  if (next_cache_ != nullptr) {
+    next_cache_->CatchUp(cycle_counter_);
+  }
+  std::size_t* fill_start = nullptr;
+  if (prefetch_target_ == PrefetchTarget::Cache) {
+    set = EvictLine(line_addr);
+    const std::size_t line = LineNumber(set, line_addr);
+    ReadLine(line_addr, line);
+    prefetched_[line] = true;
+    replacement_policy_->Insert(GetLineIndex(line_addr), set);
+    fill_start = &fill_starts_[line];
+  } else {
+    BufferedLine& buffered = prefetch_buffer_[prefetch_buffer_next_];
+    main_mem_->ReadBlock(line_addr,
+                         prefetch_buffer_data_.data() +
+                             prefetch_buffer_next_ * line_size_bytes_,
+                         line_size_bytes_);
+    buffered.addr = line_addr;
+    buffered.valid = true;
+    prefetch_buffer_next_ =
+        (prefetch_buffer_next_ + 1) % prefetch_buffer_.size();
+    fill_start = &buffered.fill_start;
+  }
+  // The line arrives when a demand miss issued now would have it
+  *fill_start = mshrs_.empty()
+                    ? cycle_counter_ + NextLevelLatency()
+                    : AllocateMSHR(line_addr, NextLevelLatency());
+  ++num_prefetches_;
+  TRACE_EVENT(Cache, Prefetch, cycle_counter_, line_addr,
+              *fill_start - cycle_counter_);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 DirectlyMappedCache::DirectlyMappedCache(MemoryPtr main_mem,
                                          std::size_t line_size_bytes,
@@ -338,22 +975,8 @@ DirectlyMappedCache::DirectlyMappedCache(MemoryPtr main_mem,
                                          std::size_t subsequent_latency,
                                          CacheWritePolicy write_policy)
     : CacheBase(main_mem, line_size_bytes, num_lines, 1, latency,
-                subsequent_latency, write_policy) {}
-
-////////////////////////////////////////////////////////////////////////////////
-std::size_t DirectlyMappedCache::EvictLine(mem_addr_t new_addr) {
-  // Grabs line in first (and only) directly-mapped cache
-  CacheLine& evict_line = Line(0, new_addr);
-  const std::size_t tag = evict_line.tag;
-  const std::size_t line_index = GetLineIndex(new_addr);
-  const std::size_t line_offset = 0;
-  const mem_addr_t wb_mem_addr = GetAddress(tag, line_index, line_offset);
-  if (evict_line.valid_bit && evict_line.dirty_bit &&
-      write_policy_ == CacheWritePolicy::WriteBack) {
-    WriteLine(wb_mem_addr, evict_line);
-  }
-  return 0;
-}
+                subsequent_latency, write_policy,
+                ReplacementPolicyType::LRU) {}
 
 ////////////////////////////////////////////////////////////////////////////////
 LRUCache::LRUCache(MemoryPtr main_mem, std::size_t line_size_bytes,
@@ -361,36 +984,15 @@ LRUCache::LRUCache(MemoryPtr main_mem, std::size_t line_size_bytes,
                    std::size_t latency, std::size_t subsequent_latency,
                    CacheWritePolicy write_policy)
     : CacheBase(main_mem, line_size_bytes, num_lines, set_associativity,
-                latency, subsequent_latency, write_policy) {}
-
-////////////////////////////////////////////////////////////////////////////////
-std::size_t LRUCache::EvictLine(mem_addr_t new_addr) {
-  std::size_t min_set = 0;
-  std::size_t min_ticks = std::numeric_limits<std::size_t>::max();
-
-  for (std::size_t set_idx = 0; set_idx < set_associativity_; ++set_idx) {
-    const std::vector<CacheBase::CacheLine>& next_set = caches_.at(set_idx);
-    const CacheLine& next_min_tick_line =
-        *std::min_element(next_set.cbegin(), next_set.cend(),
-                          [](const CacheLine& lhs, const CacheLine& rhs) {
-                            return lhs.timestamp < rhs.timestamp;
-                          });
-    if (next_min_tick_line.timestamp < min_ticks) {
-      min_ticks = next_min_tick_line.timestamp;
-      min_set = set_idx;
-    }
-  }
-
-  CacheLine& evict_line = Line(min_set, new_addr);
-  const std::size_t tag = evict_line.tag;
-  const std::size_t line_index = GetLineIndex(new_addr);
-  const std::size_t line_offset = 0;
-  const mem_addr_t wb_mem_addr = GetAddress(tag, line_index, line_offset);
-  if (evict_line.valid_bit && evict_line.dirty_bit &&
-      write_policy_ == CacheWritePolicy::WriteBack) {
-    WriteLine(wb_mem_addr, evict_line);
-  }
+                latency, subsequent_latency, write_policy,
+                ReplacementPolicyType::LRU) {}
 
-  VLOG(1) << "Evicting: " << min_set << ", Line index: " << line_index;
-  return min_set;
-}
+////////////////////////////////////////////////////////////////////////////////
+SetAssociativeCache::SetAssociativeCache(
+    MemoryPtr main_mem, std::size_t line_size_bytes, std::size_t num_lines,
+    std::size_t set_associativity, std::size_t latency,
+    std::size_t subsequent_latency, CacheWritePolicy write_policy,
+    ReplacementPolicyType replacement_policy)
+    : CacheBase(main_mem, line_size_bytes, num_lines, set_associativity,
+                latency, subsequent_latency, write_policy,
+                replacement_policy) {}
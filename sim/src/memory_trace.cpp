@@ -0,0 +1,267 @@
+#include <memory_trace.hpp>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+constexpr std::size_t MemoryTrace::kNumPorts;
+constexpr uint32_t MemoryTrace::kVersion;
+
+namespace {
+
+constexpr std::size_t kWriteBufferSize{1 << 16};
+
+// Info byte layout
+constexpr uint8_t kPortBit{0x1};
+constexpr uint8_t kWriteBit{0x2};
+constexpr uint8_t kSizeShift{2};
+
+void AppendVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTrace::Writer::Writer(const std::string& path)
+    : stream_(path, std::ios::out | std::ios::binary) {
+  CHECK(stream_.is_open()) << "Couldn't open trace " << path;
+  const FileHeader header{};
+  stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  buffer_.reserve(kWriteBufferSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTrace::Writer::~Writer() {
+  FlushBuffer();
+  FileHeader header{};
+  for (std::size_t port = 0; port < kNumPorts; ++port) {
+    header.port_sizes[port] = port_sizes_[port];
+  }
+  header.num_accesses = num_accesses_;
+  stream_.seekp(0);
+  stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  VLOG(1) << "Wrote " << num_accesses_ << " accesses to trace";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryTrace::Writer::SetPortSize(Port port, std::size_t size) {
+  port_sizes_[static_cast<std::size_t>(port)] = size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryTrace::Writer::Record(const Access& access) {
+  const std::size_t port = static_cast<std::size_t>(access.port);
+  CHECK(access.cycle >= last_cycle_) << "Trace cycles must not go backwards";
+  buffer_.push_back(static_cast<uint8_t>(
+      (port ? kPortBit : 0) | (access.write ? kWriteBit : 0) |
+      (__builtin_ctz(access.size) << kSizeShift)));
+  AppendVarint(buffer_, access.cycle - last_cycle_);
+  AppendVarint(buffer_,
+               ZigZag(static_cast<int64_t>(access.addr) -
+                      static_cast<int64_t>(last_addr_[port])));
+  last_cycle_ = access.cycle;
+  last_addr_[port] = access.addr;
+  ++num_accesses_;
+  if (buffer_.size() >= kWriteBufferSize) {
+    FlushBuffer();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MemoryTrace::Writer::FlushBuffer() {
+  stream_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+  buffer_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MemoryTrace::Cursor::Next(Access& access) {
+  if (pos_ == end_) {
+    return false;
+  }
+  const uint8_t info = *pos_++;
+  const std::size_t port = info & kPortBit;
+  access.port = static_cast<Port>(port);
+  access.write = (info & kWriteBit) != 0;
+  access.size = static_cast<uint8_t>(1 << (info >> kSizeShift));
+  last_cycle_ += ReadVarint();
+  last_addr_[port] = static_cast<mem_addr_t>(
+      static_cast<int64_t>(last_addr_[port]) + UnZigZag(ReadVarint()));
+  access.cycle = last_cycle_;
+  access.addr = last_addr_[port];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t MemoryTrace::Cursor::ReadVarint() {
+  uint64_t value = 0;
+  for (std::size_t shift = 0;; shift += 7) {
+    CHECK(pos_ != end_) << "Truncated trace";
+    const uint8_t byte = *pos_++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTrace::MemoryTrace(const std::string& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  CHECK(stream.is_open()) << "Couldn't open trace " << path;
+  stream.seekg(0, std::ios::end);
+  const std::size_t file_size = stream.tellg();
+  stream.seekg(0, std::ios::beg);
+
+  FileHeader header;
+  CHECK(file_size >= sizeof(header)) << path << " is not a memory trace";
+  stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+  const FileHeader expected{};
+  CHECK(std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0)
+      << path << " is not a memory trace";
+  CHECK(header.version == kVersion)
+      << "Unsupported trace version " << header.version;
+  for (std::size_t port = 0; port < kNumPorts; ++port) {
+    port_sizes_[port] = header.port_sizes[port];
+  }
+  num_accesses_ = header.num_accesses;
+
+  records_.resize(file_size - sizeof(header));
+  stream.read(reinterpret_cast<char*>(records_.data()), records_.size());
+  CHECK(stream.good()) << "Failed to read trace " << path;
+  VLOG(1) << "Loaded " << num_accesses_ << " accesses in " << records_.size()
+          << " bytes";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTrace::Cursor MemoryTrace::Begin() const {
+  return Cursor(records_.data(), records_.data() + records_.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TracingMemory::TracingMemory(MemoryPtr mem, MemoryTrace::Port port,
+                             MemoryTrace::WriterPtr writer)
+    : MemoryBase(mem->GetSize(), mem->GetLatency()),
+      mem_(mem),
+      port_(port),
+      writer_(writer) {
+  // Replay needs the extent of the main memory behind any caches
+  MemoryBase* level = mem_.get();
+  while (level->NextLevel() != nullptr) {
+    level = level->NextLevel();
+  }
+  const auto* main_mem = dynamic_cast<const MainMemoryBase*>(level);
+  const std::size_t base = (main_mem != nullptr) ? main_mem->GetBase() : 0;
+  writer_->SetPortSize(port_, base + level->GetSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::ExecuteCycle() {
+  mem_->ExecuteCycle();
+  MemoryBase::ExecuteCycle();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::Reset() {
+  mem_->Reset();
+  last_latency_ = 0;
+  total_latency_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t TracingMemory::CyclesUntilEvent() const {
+  return mem_->CyclesUntilEvent();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::SkipCycles(std::size_t num_cycles) {
+  mem_->SkipCycles(num_cycles);
+  MemoryBase::SkipCycles(num_cycles);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::Flush() { mem_->Flush(); }
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryBase* TracingMemory::NextLevel() const { return mem_.get(); }
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::SetRequestPC(mem_addr_t pc) { mem_->SetRequestPC(pc); }
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t TracingMemory::GetDataLatency() { return mem_->GetDataLatency(); }
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t TracingMemory::ReadByte(mem_addr_t addr) {
+  Record(addr, sizeof(uint8_t), false);
+  const uint8_t data = mem_->ReadByte(addr);
+  CompleteAccess();
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::WriteByte(mem_addr_t addr, uint8_t data) {
+  Record(addr, sizeof(uint8_t), true);
+  mem_->WriteByte(addr, data);
+  CompleteAccess();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint16_t TracingMemory::ReadHalfWord(mem_addr_t addr) {
+  Record(addr, sizeof(uint16_t), false);
+  const uint16_t data = mem_->ReadHalfWord(addr);
+  CompleteAccess();
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::WriteHalfWord(mem_addr_t addr, uint16_t data) {
+  Record(addr, sizeof(uint16_t), true);
+  mem_->WriteHalfWord(addr, data);
+  CompleteAccess();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t TracingMemory::ReadWord(mem_addr_t addr) {
+  Record(addr, sizeof(uint32_t), false);
+  const uint32_t data = mem_->ReadWord(addr);
+  CompleteAccess();
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::WriteWord(mem_addr_t addr, uint32_t data) {
+  Record(addr, sizeof(uint32_t), true);
+  mem_->WriteWord(addr, data);
+  CompleteAccess();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::Record(mem_addr_t addr, uint8_t size, bool write) {
+  MemoryTrace::Access access;
+  access.cycle = cycle_counter_;
+  access.addr = addr;
+  access.size = size;
+  access.port = port_;
+  access.write = write;
+  writer_->Record(access);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TracingMemory::CompleteAccess() {
+  last_latency_ = mem_->GetAccessLatency();
+  total_latency_ += last_latency_;
+}
@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <event_trace.hpp>
 #include <instructions.hpp>
 #include <memory.hpp>
 
@@ -12,18 +13,25 @@ Pipeline::Pipeline(RegFilePtr reg_file, PcPtr pc, MemoryPtr instr_mem,
       pc_(pc),
       instr_mem_(instr_mem),
       data_mem_(data_mem),
-      instruction_factory_(reg_file, pc_, data_mem_) {
-  InstructionPtr nop_instr = std::make_shared<NopInstruction>(NopInstruction());
+      decoded_instr_cache_(reg_file, pc_, data_mem_) {
+  slots_.fill(&nop_);
   for (std::size_t ii = 0; ii < NumStages; ++ii) {
-    instruction_queue_.push_back(nop_instr);
+    nop_.EnterPipeline();
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+InstructionInterface*& Pipeline::Slot(std::size_t stage) {
+  return slots_[(head_ + stage) % NumStages];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Pipeline::Flush(std::size_t n) {
-  InstructionPtr nop_instr = std::make_shared<NopInstruction>(NopInstruction());
   for (std::size_t ii = 0; ii <= n; ++ii) {
-    instruction_queue_.at(ii) = nop_instr;
+    InstructionInterface*& slot = Slot(ii);
+    slot->LeavePipeline();
+    slot = &nop_;
+    nop_.EnterPipeline();
   }
 }
 
@@ -31,86 +39,120 @@ void Pipeline::Flush(std::size_t n) {
 bool Pipeline::CheckHazards() const { return (latency_counter_ == 0); }
 
 ////////////////////////////////////////////////////////////////////////////////
-const InstructionPtr& Pipeline::Instruction(enum Stages pipeline_stage) const {
-  return instruction_queue_.at(pipeline_stage);
+void Pipeline::SetFetchEnabled(bool fetch_enabled) {
+  fetch_enabled_ = fetch_enabled;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-InstructionPtr& Pipeline::Instruction(enum Stages pipeline_stage) {
-  return instruction_queue_.at(pipeline_stage);
+bool Pipeline::IsEmpty() const {
+  return (latency_counter_ == 0) &&
+         std::all_of(slots_.cbegin(), slots_.cend(),
+                     [](const InstructionInterface* instr) {
+                       return instr->InstructionType() ==
+                              InstructionTypes::NoType;
+                     });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+InstructionInterface* Pipeline::Instruction(enum Stages pipeline_stage) const {
+  CHECK(pipeline_stage < NumStages) << "Invalid pipeline stage";
+  return slots_[(head_ + pipeline_stage) % NumStages];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void Pipeline::InsertDelay(Stages stage) {
-  instruction_queue_.insert(instruction_queue_.cbegin() + stage,
-                            std::make_shared<NopInstruction>());
+  // One bubble covers any stall, even when both sources hit the same load
+  if (delay_inserted_) {
+    return;
+  }
+  // The instruction that just wrote back retires now; younger ones from stage
+  // onwards move down behind the bubble while earlier stages hold still.
+  Slot(WriteBackStage)->LeavePipeline();
+  for (std::size_t ii = WriteBackStage; ii > stage; --ii) {
+    Slot(ii) = Slot(ii - 1);
+  }
+  Slot(stage) = &nop_;
+  nop_.EnterPipeline();
   delay_inserted_ = true;
-  VLOG(1) << "Delay inserted";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void Pipeline::ExecuteCycle() {
-#if (__INSTRUCTION_ACCURATE__ == 1)
-  const InstructionPtr instr_ptr = Fetch();
-  instr_ptr->ExecuteCycle(0);
-#else
-
-  VLOG(4) << "Latency Counter: " << latency_counter_;
   if (latency_counter_ == 0) {
-    VLOG(1) << "##################### Start of cycle #####################";
-
-    // Remove oldest instruction in pipeline
-    instruction_queue_.pop_back();
-
-    if (!delay_inserted_) {
-      // Fetch instruction and prepend to instruction queue.
-      const mem_addr_t instruction_pointer = pc_->InstructionPointer();
-      VLOG(1) << "Program Counter: " << std::showbase << std::hex
-              << instruction_pointer;
-      const instr_t instr = instr_mem_->ReadWord(instruction_pointer);
-      latency_counter_ = instr_mem_->GetAccessLatency();
-      const InstructionPtr fetched_instr = instruction_factory_.Create(instr);
-      instruction_queue_.push_front(fetched_instr);
-      // Increment instruction pointer.
-      pc_->ExecuteCycle();
-    } else {
+    if (delay_inserted_) {
+      // InsertDelay already advanced the stalled stages
       delay_inserted_ = false;
+    } else {
+      // Oldest instruction leaves; its slot becomes the fetch stage
+      head_ = (head_ + NumStages - 1) % NumStages;
+      InstructionInterface*& fetch_slot = Slot(FetchStage);
+      fetch_slot->LeavePipeline();
+      if (!fetch_enabled_) {
+        fetch_slot = &nop_;
+      } else {
+        // Fetch instruction into the first stage.
+        const mem_addr_t instruction_pointer = pc_->InstructionPointer();
+        instr_mem_->SetRequestPC(instruction_pointer);
+        const instr_t instr = instr_mem_->ReadWord(instruction_pointer);
+        TRACE_EVENT(Fetch, Fetch, cycle_counter_, instruction_pointer, instr);
+        latency_counter_ = instr_mem_->GetAccessLatency();
+        fetch_slot = decoded_instr_cache_.Fetch(instruction_pointer, instr);
+        // Increment instruction pointer.
+        pc_->ExecuteCycle();
+      }
+      fetch_slot->EnterPipeline();
     }
 
     for (int stage_idx = WriteBackStage; stage_idx >= FetchStage; --stage_idx) {
-      const InstructionPtr& next_instr =
+      InstructionInterface* next_instr =
           Instruction(static_cast<Stages>(stage_idx));
+      if (stage_idx == MemoryAccessStage) {
+        data_mem_->SetRequestPC(next_instr->InstructionAddress());
+      }
       next_instr->ExecuteCycle(stage_idx);
       const std::size_t instr_latency = next_instr->GetCyclesForStage();
       latency_counter_ = std::max(latency_counter_, instr_latency);
     }
 
-    if (Instruction(Pipeline::Stages::WriteBackStage)->InstructionType() !=
-        InstructionTypes::NoType) {
+    const InstructionInterface* retired_instr =
+        Instruction(Pipeline::Stages::WriteBackStage);
+    if (retired_instr->InstructionType() != InstructionTypes::NoType) {
       ++instructions_completed_;
-      // VLOG(1) << write_back_stage->InstructionName();
+      TRACE_EVENT(Fetch, Retire, cycle_counter_,
+                  retired_instr->InstructionAddress(),
+                  retired_instr->InstructionWord());
     }
   } else {
     --latency_counter_;
   }
-#endif
   HardwareObject::ExecuteCycle();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::SkipCycles(std::size_t num_cycles) {
+  CHECK(num_cycles <= latency_counter_) << "Skipping past pipeline activity";
+  latency_counter_ -= num_cycles;
+  HardwareObject::SkipCycles(num_cycles);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Pipeline::Reset() {
   Flush();
+  decoded_instr_cache_.Clear();
   instructions_completed_ = 0;
   branches_taken_ = 0;
   delay_inserted_ = false;
+  fetch_enabled_ = true;
+  latency_counter_ = 0;
   HardwareObject::Reset();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 std::vector<std::string> Pipeline::InstructionNames() const {
   std::vector<std::string> instruction_names;
-  for (const auto& instruction : instruction_queue_) {
-    instruction_names.push_back(instruction->InstructionName());
+  for (std::size_t stage = 0; stage < NumStages; ++stage) {
+    instruction_names.push_back(
+        Instruction(static_cast<Stages>(stage))->InstructionName());
   }
   return instruction_names;
 }
@@ -0,0 +1,141 @@
+#include <prefetcher.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <glog/logging.h>
+
+constexpr uint8_t StridePrefetcher::kMaxConfidence;
+constexpr uint8_t StridePrefetcher::kPrefetchConfidence;
+
+////////////////////////////////////////////////////////////////////////////////
+PrefetcherPtr Prefetcher::Create(PrefetcherType type, const Params& params) {
+  CHECK(params.line_size != 0 &&
+        (params.line_size & (params.line_size - 1)) == 0)
+      << "Prefetchers need power of two lines";
+  switch (type) {
+    case PrefetcherType::None:
+      return nullptr;
+    case PrefetcherType::NextLine:
+      return std::make_shared<NextLinePrefetcher>(params);
+    case PrefetcherType::Stride:
+      return std::make_shared<StridePrefetcher>(params);
+    case PrefetcherType::Stream:
+      return std::make_shared<StreamPrefetcher>(params);
+  }
+  LOG(FATAL) << "Unknown prefetcher";
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+PrefetcherType Prefetcher::TypeFromName(const std::string& name) {
+  static const std::map<std::string, PrefetcherType> kTypes{
+      {"none", PrefetcherType::None},
+      {"next_line", PrefetcherType::NextLine},
+      {"stride", PrefetcherType::Stride},
+      {"stream", PrefetcherType::Stream}};
+  const auto type = kTypes.find(name);
+  CHECK(type != kTypes.end()) << "Unknown prefetcher: " << name;
+  return type->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NextLinePrefetcher::NextLinePrefetcher(const Params& params)
+    : Prefetcher(params) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void NextLinePrefetcher::Observe(const Access& access,
+                                 std::vector<mem_addr_t>& line_addrs) {
+  if (!access.miss && !access.prefetch_hit) {
+    return;
+  }
+  const mem_addr_t line_addr = LineAddress(access.addr);
+  for (std::size_t ii = 1; ii <= params_.degree; ++ii) {
+    line_addrs.push_back(line_addr + ii * params_.line_size);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StridePrefetcher::StridePrefetcher(const Params& params)
+    : Prefetcher(params), table_(params.table_size) {
+  CHECK(!table_.empty()) << "Stride prefetchers need a table";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StridePrefetcher::Observe(const Access& access,
+                               std::vector<mem_addr_t>& line_addrs) {
+  Entry& entry = table_[(access.pc / sizeof(instr_t)) % table_.size()];
+  if (!entry.valid || entry.pc != access.pc) {
+    entry = Entry{access.pc, access.addr, 0, 0, true};
+    return;
+  }
+
+  const int32_t stride = static_cast<int32_t>(access.addr - entry.last_addr);
+  entry.last_addr = access.addr;
+  if (stride == entry.stride) {
+    entry.confidence = std::min<uint8_t>(entry.confidence + 1, kMaxConfidence);
+  } else if (entry.confidence > 0) {
+    --entry.confidence;
+  } else {
+    entry.stride = stride;
+  }
+  if (entry.confidence < kPrefetchConfidence || entry.stride == 0) {
+    return;
+  }
+
+  // Strides under a line fetch each line they move into only once
+  mem_addr_t last_line = LineAddress(access.addr);
+  for (std::size_t ii = 1; ii <= params_.degree; ++ii) {
+    const mem_addr_t line_addr =
+        LineAddress(access.addr + static_cast<mem_addr_t>(ii * entry.stride));
+    if (line_addr != last_line) {
+      line_addrs.push_back(line_addr);
+      last_line = line_addr;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StridePrefetcher::Reset() {
+  std::fill(table_.begin(), table_.end(), Entry{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StreamPrefetcher::StreamPrefetcher(const Params& params)
+    : Prefetcher(params), streams_(params.num_streams) {
+  CHECK(!streams_.empty()) << "Stream prefetchers need streams";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StreamPrefetcher::Observe(const Access& access,
+                               std::vector<mem_addr_t>& line_addrs) {
+  if (!access.miss && !access.prefetch_hit) {
+    return;
+  }
+  ++num_triggers_;
+  const mem_addr_t line_addr = LineAddress(access.addr);
+  const mem_addr_t window = params_.degree * params_.line_size;
+  auto stream = std::find_if(
+      streams_.begin(), streams_.end(), [&](const Stream& candidate) {
+        return candidate.valid && line_addr - candidate.head - 1 < window;
+      });
+  if (stream == streams_.end()) {
+    if (!access.miss) {
+      return;
+    }
+    stream = std::min_element(streams_.begin(), streams_.end(),
+                              [](const Stream& lhs, const Stream& rhs) {
+                                return lhs.last_use < rhs.last_use;
+                              });
+  }
+  *stream = Stream{line_addr, num_triggers_, true};
+  for (std::size_t ii = 1; ii <= params_.degree; ++ii) {
+    line_addrs.push_back(line_addr + ii * params_.line_size);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StreamPrefetcher::Reset() {
+  std::fill(streams_.begin(), streams_.end(), Stream{});
+  num_triggers_ = 0;
+}
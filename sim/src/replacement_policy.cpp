@@ -0,0 +1,238 @@
+#include <replacement_policy.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <glog/logging.h>
+
+constexpr uint32_t RRIPPolicy::kDistant;
+constexpr uint32_t RRIPPolicy::kLong;
+constexpr uint32_t RRIPPolicy::kBimodalPeriod;
+constexpr uint32_t RandomPolicy::kSeed;
+
+////////////////////////////////////////////////////////////////////////////////
+ReplacementPolicyPtr ReplacementPolicy::Create(ReplacementPolicyType type,
+                                               std::size_t num_sets,
+                                               std::size_t ways) {
+  ReplacementPolicyPtr policy;
+  switch (type) {
+    case ReplacementPolicyType::LRU:
+      policy = std::make_shared<LRUPolicy>(num_sets, ways);
+      break;
+    case ReplacementPolicyType::TreePLRU:
+      policy = std::make_shared<TreePLRUPolicy>(num_sets, ways);
+      break;
+    case ReplacementPolicyType::SRRIP:
+      policy = std::make_shared<RRIPPolicy>(num_sets, ways, false);
+      break;
+    case ReplacementPolicyType::BRRIP:
+      policy = std::make_shared<RRIPPolicy>(num_sets, ways, true);
+      break;
+    case ReplacementPolicyType::FIFO:
+      policy = std::make_shared<FIFOPolicy>(num_sets, ways);
+      break;
+    case ReplacementPolicyType::Random:
+      policy = std::make_shared<RandomPolicy>(num_sets, ways);
+      break;
+  }
+  CHECK(policy != nullptr) << "Unknown replacement policy";
+  policy->type_ = type;
+  return policy;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ReplacementPolicyType ReplacementPolicy::TypeFromName(
+    const std::string& name) {
+  static const std::map<std::string, ReplacementPolicyType> kTypes{
+      {"lru", ReplacementPolicyType::LRU},
+      {"plru", ReplacementPolicyType::TreePLRU},
+      {"srrip", ReplacementPolicyType::SRRIP},
+      {"brrip", ReplacementPolicyType::BRRIP},
+      {"fifo", ReplacementPolicyType::FIFO},
+      {"random", ReplacementPolicyType::Random}};
+  const auto type = kTypes.find(name);
+  CHECK(type != kTypes.end()) << "Unknown replacement policy: " << name;
+  return type->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* ReplacementPolicy::TypeName(ReplacementPolicyType type) {
+  switch (type) {
+    case ReplacementPolicyType::LRU:
+      return "lru";
+    case ReplacementPolicyType::TreePLRU:
+      return "plru";
+    case ReplacementPolicyType::SRRIP:
+      return "srrip";
+    case ReplacementPolicyType::BRRIP:
+      return "brrip";
+    case ReplacementPolicyType::FIFO:
+      return "fifo";
+    case ReplacementPolicyType::Random:
+      return "random";
+  }
+  return "unknown";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReplacementPolicy::Supports(ReplacementPolicyType type,
+                                 std::size_t ways) {
+  if (type == ReplacementPolicyType::TreePLRU) {
+    return ways != 0 && (ways & (ways - 1)) == 0 && ways <= 32;
+  }
+  return ways != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ReplacementPolicy::ReplacementPolicy(std::size_t num_sets, std::size_t ways,
+                                     std::size_t words_per_set)
+    : ways_(ways),
+      words_per_set_(words_per_set),
+      state_(num_sets * words_per_set) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void ReplacementPolicy::Reset() {
+  std::fill(state_.begin(), state_.end(), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+LRUPolicy::LRUPolicy(std::size_t num_sets, std::size_t ways)
+    : ReplacementPolicy(num_sets, ways, ways) {
+  Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LRUPolicy::Touch(std::size_t set, std::size_t way) {
+  uint32_t* const ranks = SetState(set);
+  const uint32_t rank = ranks[way];
+  for (std::size_t ii = 0; ii < ways_; ++ii) {
+    ranks[ii] += (ranks[ii] < rank);
+  }
+  ranks[way] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t LRUPolicy::Victim(std::size_t set) {
+  const uint32_t* const ranks = SetState(set);
+  return std::max_element(ranks, ranks + ways_) - ranks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LRUPolicy::Reset() {
+  // Ranks must stay a permutation, lower ways starting out more recent
+  for (std::size_t ii = 0; ii < state_.size(); ++ii) {
+    state_[ii] = ii % ways_;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TreePLRUPolicy::TreePLRUPolicy(std::size_t num_sets, std::size_t ways)
+    : ReplacementPolicy(num_sets, ways, 1),
+      levels_(__builtin_ctz(ways)) {
+  CHECK(Supports(ReplacementPolicyType::TreePLRU, ways))
+      << "Tree PLRU needs a power of two ways, at most 32";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TreePLRUPolicy::Touch(std::size_t set, std::size_t way) {
+  // Node n's children are 2n + 1 and 2n + 2; a set bit points right
+  uint32_t& tree = *SetState(set);
+  std::size_t node = 0;
+  for (std::size_t level = levels_; level-- > 0;) {
+    const uint32_t right = (way >> level) & 1;
+    tree = (tree & ~(1u << node)) | ((right ^ 1) << node);
+    node = 2 * node + 1 + right;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t TreePLRUPolicy::Victim(std::size_t set) {
+  const uint32_t tree = *SetState(set);
+  std::size_t node = 0;
+  std::size_t way = 0;
+  for (std::size_t level = 0; level < levels_; ++level) {
+    const uint32_t right = (tree >> node) & 1;
+    way = 2 * way + right;
+    node = 2 * node + 1 + right;
+  }
+  return way;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RRIPPolicy::RRIPPolicy(std::size_t num_sets, std::size_t ways, bool bimodal)
+    : ReplacementPolicy(num_sets, ways, ways),
+      bimodal_(bimodal),
+      fill_counter_word_(state_.size()) {
+  state_.push_back(0);
+  Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RRIPPolicy::Touch(std::size_t set, std::size_t way) {
+  SetState(set)[way] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RRIPPolicy::Insert(std::size_t set, std::size_t way) {
+  uint32_t prediction = kLong;
+  if (bimodal_) {
+    uint32_t& fills = state_[fill_counter_word_];
+    fills = (fills + 1) % kBimodalPeriod;
+    prediction = (fills == 0) ? kLong : kDistant;
+  }
+  SetState(set)[way] = prediction;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t RRIPPolicy::Victim(std::size_t set) {
+  uint32_t* const predictions = SetState(set);
+  // Ages every way at once by as much as the oldest needs to become distant
+  const uint32_t oldest = *std::max_element(predictions, predictions + ways_);
+  const std::size_t victim =
+      std::max_element(predictions, predictions + ways_) - predictions;
+  if (oldest < kDistant) {
+    for (std::size_t ii = 0; ii < ways_; ++ii) {
+      predictions[ii] += kDistant - oldest;
+    }
+  }
+  return victim;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RRIPPolicy::Reset() {
+  std::fill(state_.begin(), state_.end(), kDistant);
+  state_[fill_counter_word_] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FIFOPolicy::FIFOPolicy(std::size_t num_sets, std::size_t ways)
+    : ReplacementPolicy(num_sets, ways, 1) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void FIFOPolicy::Insert(std::size_t set, std::size_t way) {
+  uint32_t& oldest = *SetState(set);
+  if (way == oldest) {
+    oldest = (oldest + 1) % ways_;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t FIFOPolicy::Victim(std::size_t set) { return *SetState(set); }
+
+////////////////////////////////////////////////////////////////////////////////
+RandomPolicy::RandomPolicy(std::size_t num_sets, std::size_t ways)
+    : ReplacementPolicy(0, ways, 0) {
+  state_.push_back(kSeed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t RandomPolicy::Victim(std::size_t set) {
+  uint32_t& random = state_.front();
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  return random % ways_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RandomPolicy::Reset() { state_.front() = kSeed; }
@@ -0,0 +1,133 @@
+#include <sampler.hpp>
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace {
+
+// Two sided 95% Student t critical values for 1-30 degrees of freedom. Larger
+// sample counts use the normal approximation.
+double TCritical95(std::size_t degrees_of_freedom) {
+  static const double kTable[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  constexpr std::size_t kTableSize = sizeof(kTable) / sizeof(kTable[0]);
+  if (degrees_of_freedom == 0) {
+    return 0.0;
+  }
+  if (degrees_of_freedom <= kTableSize) {
+    return kTable[degrees_of_freedom - 1];
+  }
+  return 1.960;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+Sampler::Sampler(CpuPtr cpu, const Params& params)
+    : cpu_(cpu), params_(params) {
+  CHECK(params_.detailed > 0) << "Detailed window must be non-empty";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Sampler::Continues(FunctionalCore::StopReason stop_reason) {
+  return (stop_reason == FunctionalCore::StopReason::InstructionLimit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Sampler::Results Sampler::Run() {
+  window_cpis_.clear();
+  detailed_instructions_ = 0;
+
+  FunctionalCore::StopReason stop_reason =
+      FunctionalCore::StopReason::InstructionLimit;
+  while (params_.max_samples == 0 ||
+         window_cpis_.size() < params_.max_samples) {
+    cpu_->SetMode(SimulationMode::Functional);
+    if (params_.fast_forward > 0) {
+      stop_reason = cpu_->Run(params_.fast_forward);
+      if (!Continues(stop_reason)) {
+        break;
+      }
+    }
+
+    stop_reason = cpu_->WarmUp(params_.warm_up);
+    if (!Continues(stop_reason)) {
+      break;
+    }
+
+    const std::size_t start_cycles = cpu_->GetCycles();
+    const std::size_t start_instructions = cpu_->InstructionsCompleted();
+    stop_reason = cpu_->Run(params_.detailed);
+    const std::size_t window_cycles = cpu_->GetCycles() - start_cycles;
+    const std::size_t window_instructions =
+        cpu_->InstructionsCompleted() - start_instructions;
+    if (window_instructions > 0) {
+      window_cpis_.push_back(static_cast<double>(window_cycles) /
+                             static_cast<double>(window_instructions));
+      detailed_instructions_ += window_instructions;
+      VLOG(1) << "Sample " << window_cpis_.size()
+              << " CPI: " << window_cpis_.back();
+    }
+    if (!Continues(stop_reason)) {
+      break;
+    }
+  }
+
+  // Leave the architectural state coherent in main memory
+  cpu_->SetMode(SimulationMode::Functional);
+  return Summarize(stop_reason);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Sampler::Results Sampler::Summarize(
+    FunctionalCore::StopReason stop_reason) const {
+  Results results;
+  results.stop_reason = stop_reason;
+  results.num_samples = window_cpis_.size();
+  results.total_instructions = cpu_->InstructionsCompleted();
+  results.detailed_instructions = detailed_instructions_;
+  if (window_cpis_.empty()) {
+    return results;
+  }
+
+  double cpi_sum = 0.0;
+  for (const double cpi : window_cpis_) {
+    cpi_sum += cpi;
+  }
+  results.mean_cpi = cpi_sum / window_cpis_.size();
+
+  if (window_cpis_.size() > 1) {
+    double squared_error_sum = 0.0;
+    for (const double cpi : window_cpis_) {
+      squared_error_sum += (cpi - results.mean_cpi) * (cpi - results.mean_cpi);
+    }
+    results.cpi_stddev =
+        std::sqrt(squared_error_sum / (window_cpis_.size() - 1));
+    results.cpi_confidence_95 = TCritical95(window_cpis_.size() - 1) *
+                                results.cpi_stddev /
+                                std::sqrt(window_cpis_.size());
+  }
+  results.extrapolated_cycles =
+      results.mean_cpi * static_cast<double>(results.total_instructions);
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Sampler::PrintResults(const Results& results,
+                           std::ostream& output_stream) {
+  output_stream << "Samples: " << results.num_samples << std::endl
+                << "Instructions Executed: " << results.total_instructions
+                << std::endl
+                << "Instructions Simulated In Detail: "
+                << results.detailed_instructions << std::endl
+                << "CPI: " << results.mean_cpi << " +/- "
+                << results.cpi_confidence_95 << " (95% confidence)"
+                << std::endl
+                << "CPI Standard Deviation: " << results.cpi_stddev
+                << std::endl
+                << "Extrapolated Cycles: " << results.extrapolated_cycles
+                << std::endl;
+}
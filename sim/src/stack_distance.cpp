@@ -0,0 +1,241 @@
+#include <stack_distance.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+#include <glog/logging.h>
+
+constexpr uint64_t StackDistance::kNoLine;
+constexpr uint64_t StackDistance::kHashModulus;
+
+namespace {
+
+constexpr std::size_t kMinSetCapacity{16};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::FenwickTree::Add(std::size_t index, int32_t delta) {
+  for (++index; index < tree_.size(); index += index & (~index + 1)) {
+    tree_[index] += delta;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int64_t StackDistance::FenwickTree::Prefix(std::size_t index) const {
+  int64_t sum = 0;
+  for (; index > 0; index -= index & (~index + 1)) {
+    sum += tree_[index];
+  }
+  return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StackDistance::StackDistance(const Params& params)
+    : line_shift_(__builtin_ctzll(params.line_size)),
+      max_sampled_lines_(params.max_sampled_lines) {
+  CHECK(params.line_size != 0 &&
+        (params.line_size & (params.line_size - 1)) == 0)
+      << "Line size must be a power of two";
+  CHECK(params.sampling_rate > 0.0 && params.sampling_rate <= 1.0)
+      << "Sampling rate must be in (0, 1]";
+  threshold_ = std::max<uint64_t>(
+      1, static_cast<uint64_t>(params.sampling_rate * kHashModulus));
+  weight_ = 1.0 / SamplingRate();
+
+  for (const std::size_t num_sets : params.num_sets) {
+    CHECK(num_sets != 0 && (num_sets & (num_sets - 1)) == 0)
+        << "Number of sets must be a power of two";
+    Geometry geometry;
+    geometry.num_sets = num_sets;
+    geometry.sets.resize(num_sets);
+    geometries_.push_back(std::move(geometry));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::Access(mem_addr_t addr) {
+  ++num_accesses_;
+  const uint64_t line = addr >> line_shift_;
+  if (threshold_ < kHashModulus || max_sampled_lines_ != 0) {
+    const uint64_t hash = Hash(line);
+    if (hash >= threshold_) {
+      return;
+    }
+    if (max_sampled_lines_ != 0 && sampled_.emplace(hash, line).second &&
+        sampled_.size() > max_sampled_lines_) {
+      LowerThreshold();
+      if (hash >= threshold_) {
+        return;
+      }
+    }
+  }
+  for (Geometry& geometry : geometries_) {
+    Record(geometry, line, weight_);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StackDistance::MissRatio(std::size_t num_sets,
+                                std::size_t set_associativity) const {
+  for (const Geometry& geometry : geometries_) {
+    if (geometry.num_sets != num_sets) {
+      continue;
+    }
+    double total = geometry.cold;
+    double misses = geometry.cold;
+    for (std::size_t distance = 0; distance < geometry.histogram.size();
+         ++distance) {
+      total += geometry.histogram[distance];
+      if (distance >= set_associativity) {
+        misses += geometry.histogram[distance];
+      }
+    }
+    return (total > 0.0) ? misses / total : 0.0;
+  }
+  LOG(FATAL) << "Set count " << num_sets << " is not tracked";
+  return 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<StackDistance::CurvePoint> StackDistance::MissRatioCurve() const {
+  std::vector<CurvePoint> curve;
+  for (const Geometry& geometry : geometries_) {
+    double total = geometry.cold;
+    for (const double count : geometry.histogram) {
+      total += count;
+    }
+    // Misses at associativity ways are the accesses at distance >= ways
+    double misses = total;
+    for (std::size_t ways = 1; ways <= geometry.histogram.size(); ++ways) {
+      misses -= geometry.histogram[ways - 1];
+      CurvePoint point;
+      point.num_sets = geometry.num_sets;
+      point.set_associativity = ways;
+      point.capacity = (geometry.num_sets * ways) << line_shift_;
+      point.miss_ratio = (total > 0.0) ? std::max(misses, 0.0) / total : 0.0;
+      curve.push_back(point);
+    }
+  }
+  return curve;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StackDistance::SamplingRate() const {
+  return static_cast<double>(threshold_) / static_cast<double>(kHashModulus);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::WriteCsvHeader(std::ostream& csv_stream) {
+  csv_stream << "name,line_size,num_sets,set_associativity,capacity,"
+                "miss_ratio,sampling_rate"
+             << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::WriteCsv(const std::string& name,
+                             std::ostream& csv_stream) const {
+  for (const CurvePoint& point : MissRatioCurve()) {
+    csv_stream << std::dec << name << ',' << (1ull << line_shift_) << ','
+               << point.num_sets << ',' << point.set_associativity << ','
+               << point.capacity << ',' << point.miss_ratio << ','
+               << SamplingRate() << '\n';
+  }
+  csv_stream.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t StackDistance::Hash(uint64_t line) {
+  // splitmix64 finalizer
+  line += 0x9e3779b97f4a7c15ull;
+  line = (line ^ (line >> 30)) * 0xbf58476d1ce4e5b9ull;
+  line = (line ^ (line >> 27)) * 0x94d049bb133111ebull;
+  return (line ^ (line >> 31)) % kHashModulus;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::Record(Geometry& geometry, uint64_t line, double weight) {
+  SetStack& set = geometry.sets[line & (geometry.num_sets - 1)];
+  const auto last = geometry.last_access.find(line);
+  if (last == geometry.last_access.end()) {
+    geometry.cold += weight;
+  } else {
+    // Lines touched since the last access each hold one mark after it
+    const uint64_t time = last->second;
+    const int64_t distance =
+        set.marks.Prefix(set.clock) - set.marks.Prefix(time + 1);
+    const std::size_t bucket =
+        static_cast<std::size_t>(static_cast<double>(distance) * weight);
+    if (bucket >= geometry.histogram.size()) {
+      geometry.histogram.resize(bucket + 1, 0.0);
+    }
+    geometry.histogram[bucket] += weight;
+    set.marks.Add(time, -1);
+    set.lines[time] = kNoLine;
+    --set.live;
+  }
+
+  if (set.clock == set.lines.size()) {
+    Compact(geometry, set);
+  }
+  const uint64_t time = set.clock++;
+  set.marks.Add(time, 1);
+  set.lines[time] = line;
+  ++set.live;
+  geometry.last_access[line] = time;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::Forget(Geometry& geometry, uint64_t line) {
+  const auto last = geometry.last_access.find(line);
+  if (last == geometry.last_access.end()) {
+    return;
+  }
+  SetStack& set = geometry.sets[line & (geometry.num_sets - 1)];
+  set.marks.Add(last->second, -1);
+  set.lines[last->second] = kNoLine;
+  --set.live;
+  geometry.last_access.erase(last);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::Compact(Geometry& geometry, SetStack& set) {
+  // Renumber the live lines from zero, keeping their order, in a tree with
+  // room for as many accesses again
+  std::vector<uint64_t> lines;
+  lines.reserve(set.live);
+  for (const uint64_t line : set.lines) {
+    if (line != kNoLine) {
+      lines.push_back(line);
+    }
+  }
+  const std::size_t capacity = std::max(kMinSetCapacity, 2 * lines.size());
+  set.marks.Resize(capacity);
+  set.lines.assign(capacity, kNoLine);
+  for (std::size_t time = 0; time < lines.size(); ++time) {
+    set.marks.Add(time, 1);
+    set.lines[time] = lines[time];
+    geometry.last_access[lines[time]] = time;
+  }
+  set.clock = lines.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StackDistance::LowerThreshold() {
+  const auto largest = std::prev(sampled_.end());
+  threshold_ = largest->first;
+  for (Geometry& geometry : geometries_) {
+    Forget(geometry, largest->second);
+  }
+  sampled_.erase(largest);
+  // Other lines sharing the evicted hash fall out of the sample too
+  while (!sampled_.empty() && sampled_.rbegin()->first >= threshold_) {
+    const auto next = std::prev(sampled_.end());
+    for (Geometry& geometry : geometries_) {
+      Forget(geometry, next->second);
+    }
+    sampled_.erase(next);
+  }
+  weight_ = 1.0 / SamplingRate();
+  VLOG(2) << "Sampling rate lowered to " << SamplingRate();
+}
@@ -0,0 +1,270 @@
+#include <store_buffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+////////////////////////////////////////////////////////////////////////////////
+StoreBuffer::StoreBuffer(MemoryPtr mem, std::size_t num_entries,
+                         std::size_t line_size)
+    : MemoryBase(mem->GetSize(), mem->GetLatency()),
+      mem_(mem),
+      line_size_(line_size),
+      entries_(num_entries) {
+  CHECK(num_entries > 0) << "Store buffers need entries";
+  CHECK(line_size_ >= sizeof(word_t) && (line_size_ & (line_size_ - 1)) == 0)
+      << "Store buffer lines must be a power of two words";
+  for (Entry& entry : entries_) {
+    entry.data.resize(line_size_);
+    entry.valid.resize(line_size_);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::ExecuteCycle() {
+  mem_->ExecuteCycle();
+  MemoryBase::ExecuteCycle();
+  DrainUntil(cycle_counter_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::Reset() {
+  Discard();
+  request_pc_ = 0;
+  num_stores_ = 0;
+  num_coalesced_ = 0;
+  num_forwarded_ = 0;
+  num_full_stalls_ = 0;
+  mem_->Reset();
+  MemoryBase::Reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StoreBuffer::CyclesUntilEvent() const {
+  if (num_buffered_ == 0) {
+    return mem_->CyclesUntilEvent();
+  }
+  // The next drain happens in the cycle it may start
+  const std::size_t start = std::max(mem_free_, entries_[head_].buffered);
+  if (start <= cycle_counter_ + 1) {
+    return 0;
+  }
+  return std::min(start - cycle_counter_ - 1, mem_->CyclesUntilEvent());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::SkipCycles(std::size_t num_cycles) {
+  mem_->SkipCycles(num_cycles);
+  MemoryBase::SkipCycles(num_cycles);
+  DrainUntil(cycle_counter_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::Flush() {
+  Drain();
+  mem_->Flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryBase* StoreBuffer::NextLevel() const { return mem_.get(); }
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::SetRequestPC(mem_addr_t pc) {
+  request_pc_ = pc;
+  mem_->SetRequestPC(pc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint8_t StoreBuffer::ReadByte(mem_addr_t addr) { return Load<uint8_t>(addr); }
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::WriteByte(mem_addr_t addr, uint8_t data) {
+  Store<uint8_t>(addr, data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint16_t StoreBuffer::ReadHalfWord(mem_addr_t addr) {
+  return Load<uint16_t>(addr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::WriteHalfWord(mem_addr_t addr, uint16_t data) {
+  Store<uint16_t>(addr, data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t StoreBuffer::ReadWord(mem_addr_t addr) {
+  return Load<uint32_t>(addr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::WriteWord(mem_addr_t addr, uint32_t data) {
+  Store<uint32_t>(addr, data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::Drain() {
+  while (num_buffered_ > 0) {
+    DrainOldest(std::max(mem_free_, cycle_counter_));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::Discard() {
+  for (Entry& entry : entries_) {
+    std::fill(entry.valid.begin(), entry.valid.end(), false);
+  }
+  head_ = 0;
+  num_buffered_ = 0;
+  mem_free_ = 0;
+  data_latency_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename data_t>
+data_t StoreBuffer::Load(mem_addr_t addr) {
+  uint8_t bytes[sizeof(data_t)] = {};
+  bool buffered[sizeof(data_t)];
+  std::size_t num_buffered_bytes = 0;
+  for (std::size_t ii = 0; ii < sizeof(data_t); ++ii) {
+    const mem_addr_t byte_addr = addr + ii;
+    const Entry* entry = FindEntry(byte_addr & ~(line_size_ - 1));
+    const std::size_t offset = byte_addr & (line_size_ - 1);
+    buffered[ii] = (entry != nullptr && entry->valid[offset]);
+    if (buffered[ii]) {
+      bytes[ii] = entry->data[offset];
+      ++num_buffered_bytes;
+    }
+  }
+
+  if (num_buffered_bytes == sizeof(data_t)) {
+    ++num_forwarded_;
+    last_latency_ = latency_;
+    data_latency_ = latency_;
+  } else {
+    // Waits for the memory to finish taking an entry
+    const std::size_t wait =
+        (mem_free_ > cycle_counter_) ? mem_free_ - cycle_counter_ : 0;
+    data_t mem_data;
+    switch (sizeof(data_t)) {
+      case sizeof(uint8_t):
+        mem_data = static_cast<data_t>(mem_->ReadByte(addr));
+        break;
+      case sizeof(uint16_t):
+        mem_data = static_cast<data_t>(mem_->ReadHalfWord(addr));
+        break;
+      default:
+        mem_data = static_cast<data_t>(mem_->ReadWord(addr));
+        break;
+    }
+    uint8_t mem_bytes[sizeof(data_t)];
+    std::memcpy(mem_bytes, &mem_data, sizeof(data_t));
+    for (std::size_t ii = 0; ii < sizeof(data_t); ++ii) {
+      if (!buffered[ii]) {
+        bytes[ii] = mem_bytes[ii];
+      }
+    }
+    last_latency_ = wait + mem_->GetAccessLatency();
+    data_latency_ = wait + mem_->GetDataLatency();
+    mem_free_ = cycle_counter_ + last_latency_;
+  }
+
+  data_t data;
+  std::memcpy(&data, bytes, sizeof(data_t));
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <typename data_t>
+void StoreBuffer::Store(mem_addr_t addr, data_t data) {
+  uint8_t bytes[sizeof(data_t)];
+  std::memcpy(bytes, &data, sizeof(data_t));
+  std::size_t wait = 0;
+  bool coalesced = true;
+  bool stalled = false;
+  for (std::size_t ii = 0; ii < sizeof(data_t); ++ii) {
+    const mem_addr_t byte_addr = addr + ii;
+    const mem_addr_t line_addr = byte_addr & ~(line_size_ - 1);
+    Entry* entry = FindEntry(line_addr);
+    if (entry == nullptr) {
+      coalesced = false;
+      if (num_buffered_ == entries_.size()) {
+        // Room is made once the memory has taken the oldest entry
+        stalled = true;
+        DrainOldest(std::max(mem_free_, cycle_counter_));
+        wait = std::max(wait, mem_free_ - cycle_counter_);
+      }
+      entry = &AllocateEntry(line_addr, cycle_counter_ + wait);
+    }
+    const std::size_t offset = byte_addr & (line_size_ - 1);
+    entry->data[offset] = bytes[ii];
+    entry->valid[offset] = true;
+  }
+  ++num_stores_;
+  num_coalesced_ += coalesced;
+  num_full_stalls_ += stalled;
+  last_latency_ = wait + latency_;
+  data_latency_ = last_latency_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StoreBuffer::Entry* StoreBuffer::FindEntry(mem_addr_t line_addr) {
+  for (std::size_t ii = 0; ii < num_buffered_; ++ii) {
+    Entry& entry = entries_[(head_ + ii) % entries_.size()];
+    if (entry.line_addr == line_addr) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StoreBuffer::Entry& StoreBuffer::AllocateEntry(mem_addr_t line_addr,
+                                               std::size_t cycle) {
+  CHECK(num_buffered_ < entries_.size()) << "Store buffer overflow";
+  Entry& entry = entries_[(head_ + num_buffered_) % entries_.size()];
+  entry.line_addr = line_addr;
+  entry.pc = request_pc_;
+  entry.buffered = cycle;
+  ++num_buffered_;
+  return entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::DrainOldest(std::size_t start) {
+  Entry& entry = Oldest();
+  // Prefetchers behind the buffer see the store's PC
+  mem_->SetRequestPC(entry.pc);
+  std::size_t latency = 0;
+  std::size_t offset = 0;
+  while (offset < line_size_) {
+    if (!entry.valid[offset]) {
+      ++offset;
+      continue;
+    }
+    std::size_t end = offset;
+    while (end < line_size_ && entry.valid[end]) {
+      entry.valid[end++] = false;
+    }
+    mem_->WriteBlock(entry.line_addr + offset, entry.data.data() + offset,
+                     end - offset);
+    latency += mem_->GetAccessLatency();
+    offset = end;
+  }
+  mem_->SetRequestPC(request_pc_);
+  mem_free_ = start + latency;
+  head_ = (head_ + 1) % entries_.size();
+  --num_buffered_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoreBuffer::DrainUntil(std::size_t cycle) {
+  while (num_buffered_ > 0) {
+    const std::size_t start = std::max(mem_free_, Oldest().buffered);
+    if (start > cycle) {
+      break;
+    }
+    DrainOldest(start);
+  }
+}
@@ -0,0 +1,186 @@
+#include <sweep.hpp>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include <glog/logging.h>
+
+#include <cpu.hpp>
+#include <elf_loader.hpp>
+#include <work_stealing_pool.hpp>
+
+namespace {
+
+const char* StopReasonName(FunctionalCore::StopReason stop_reason) {
+  switch (stop_reason) {
+    case FunctionalCore::StopReason::InstructionLimit:
+      return "instruction_limit";
+    case FunctionalCore::StopReason::Breakpoint:
+      return "breakpoint";
+    case FunctionalCore::StopReason::Halt:
+      return "halt";
+    case FunctionalCore::StopReason::IllegalInstruction:
+      return "illegal_instruction";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+Sweep::Sweep(const std::string& riscv_binary, const Ranges& ranges,
+             std::size_t max_instructions)
+    : riscv_binary_(riscv_binary),
+      max_instructions_(max_instructions),
+      configs_(Expand(ranges)) {}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Sweep::Config> Sweep::Expand(const Ranges& ranges) {
+  std::vector<Config> configs;
+  Config config;
+  for (const std::size_t line_size : ranges.line_sizes) {
+    config.line_size = line_size;
+    for (const std::size_t num_lines : ranges.num_lines) {
+      config.num_lines = num_lines;
+      for (const std::size_t set_associativity : ranges.set_associativities) {
+        config.set_associativity = set_associativity;
+        for (const std::size_t cache_latency : ranges.cache_latencies) {
+          config.cache_latency = cache_latency;
+          for (const std::size_t first_word_latency :
+               ranges.first_word_latencies) {
+            config.first_word_latency = first_word_latency;
+            for (const std::size_t subsequent_word_latency :
+                 ranges.subsequent_word_latencies) {
+              config.subsequent_word_latency = subsequent_word_latency;
+              for (const CacheWritePolicy write_policy :
+                   ranges.write_policies) {
+                config.write_policy = write_policy;
+                for (const ReplacementPolicyType replacement_policy :
+                     ranges.replacement_policies) {
+                  config.replacement_policy = replacement_policy;
+                  if (ValidConfiguration(config)) {
+                    configs.push_back(config);
+                  } else {
+                    VLOG(1) << "Skipping " << num_lines << " lines of "
+                            << line_size << " bytes, " << set_associativity
+                            << " way, "
+                            << ReplacementPolicy::TypeName(replacement_policy);
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return configs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Sweep::ValidConfiguration(const Config& config) {
+  const auto power_of_two = [](std::size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+  };
+  return power_of_two(config.line_size) && config.line_size >= sizeof(word_t) &&
+         config.set_associativity != 0 &&
+         config.num_lines % config.set_associativity == 0 &&
+         power_of_two(config.num_lines / config.set_associativity) &&
+         ReplacementPolicy::Supports(config.replacement_policy,
+                                     config.set_associativity);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Sweep::Result Sweep::RunConfiguration(const std::string& riscv_binary,
+                                      const Config& config,
+                                      std::size_t max_instructions) {
+  const auto start = std::chrono::steady_clock::now();
+
+  auto data = std::make_shared<DataMemory>(DataMemory(
+      config.first_word_latency, MainMemoryBase::kAddressSpaceSize));
+  MemoryPtr data_mem = data;
+  mem_addr_t entry_point = 0;
+  MemoryPtr instr_mem = ElfImage::LoadProgram(
+      riscv_binary, config.first_word_latency, *data, entry_point);
+  MemoryPtr instr_cache = std::make_shared<SetAssociativeCache>(
+      SetAssociativeCache(instr_mem, config.line_size, config.num_lines,
+                          config.set_associativity, config.cache_latency,
+                          config.subsequent_word_latency, config.write_policy,
+                          config.replacement_policy));
+  MemoryPtr data_cache = std::make_shared<SetAssociativeCache>(
+      SetAssociativeCache(data_mem, config.line_size, config.num_lines,
+                          config.set_associativity, config.cache_latency,
+                          config.subsequent_word_latency, config.write_policy,
+                          config.replacement_policy));
+  CpuPtr cpu = std::make_shared<CPU>(CPU(instr_cache, data_cache));
+  cpu->GetPC()->SetEntryPoint(entry_point);
+
+  Result result;
+  result.config = config;
+  result.stop_reason = cpu->Run(max_instructions);
+  result.instructions = cpu->InstructionsCompleted();
+  result.cycles = cpu->GetCycles();
+  result.cpi = cpu->GetCPI();
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Sweep::Result> Sweep::Run(std::size_t num_threads,
+                                      std::ostream& csv_stream) {
+  std::vector<Result> results;
+  results.reserve(configs_.size());
+  std::mutex results_mutex;
+
+  WriteCsvHeader(csv_stream);
+  WorkStealingPool pool(num_threads);
+  VLOG(1) << "Sweeping " << configs_.size() << " configurations on "
+          << pool.NumThreads() << " threads";
+  for (const Config& config : configs_) {
+    pool.Submit([&, config] {
+      const Result result =
+          RunConfiguration(riscv_binary_, config, max_instructions_);
+      std::lock_guard<std::mutex> lock(results_mutex);
+      WriteCsvRow(result, csv_stream);
+      results.push_back(result);
+    });
+  }
+  pool.Wait();
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Sweep::WriteCsvHeader(std::ostream& csv_stream) {
+  WriteConfigCsvHeader(csv_stream);
+  csv_stream << ",stop_reason,instructions,cycles,cpi,seconds" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Sweep::WriteCsvRow(const Result& result, std::ostream& csv_stream) {
+  WriteConfigCsv(result.config, csv_stream);
+  csv_stream << ',' << StopReasonName(result.stop_reason) << ','
+             << result.instructions << ',' << result.cycles << ','
+             << result.cpi << ',' << result.seconds << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Sweep::WriteConfigCsvHeader(std::ostream& csv_stream) {
+  csv_stream << "line_size,num_lines,set_associativity,cache_latency,"
+                "first_word_latency,subsequent_word_latency,write_policy,"
+                "replacement_policy";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Sweep::WriteConfigCsv(const Config& config, std::ostream& csv_stream) {
+  csv_stream << std::dec << config.line_size << ',' << config.num_lines << ','
+             << config.set_associativity << ',' << config.cache_latency << ','
+             << config.first_word_latency << ','
+             << config.subsequent_word_latency << ','
+             << (config.write_policy == CacheWritePolicy::WriteBack
+                     ? "write_back"
+                     : "write_through")
+             << ',' << ReplacementPolicy::TypeName(config.replacement_policy);
+}
@@ -0,0 +1,168 @@
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cache_replay.hpp>
+#include <memory.hpp>
+#include <memory_trace.hpp>
+#include <stack_distance.hpp>
+#include <sweep.hpp>
+#include <work_stealing_pool.hpp>
+
+// Program to execute for every configuration, or a trace recorded with
+// riscv_sim --trace_file to replay through the caches alone
+DEFINE_string(riscv_binary, "", "Program to run in simulator");
+DEFINE_string(trace, "", "Memory access trace to replay instead of running");
+
+// Parameter ranges, each a comma separated list
+DEFINE_string(cache_line_sizes, "4", "Cache line sizes in words");
+DEFINE_string(set_associativities, "1,2,4", "Set associativities of cache");
+DEFINE_string(num_cache_lines, "4,8,16,32", "Numbers of lines in cache");
+DEFINE_string(cache_latencies, "1", "Numbers of cycles for cache hit");
+DEFINE_string(first_word_latencies, "10",
+              "Numbers of cycles needed to access first word in a line from "
+              "memory");
+DEFINE_string(subsequent_word_latencies, "1",
+              "Numbers of cycles needed to access subsequent words in a line "
+              "from memory");
+DEFINE_string(write_policies, "write_back,write_through",
+              "Write policies for caches");
+DEFINE_string(replacement_policies, "lru",
+              "Replacement policies for caches: lru, plru, srrip, brrip, "
+              "fifo or random");
+
+// Miss ratio curves from a trace in place of replaying each configuration.
+// Curves cover every associativity for each set count at each line size.
+DEFINE_bool(miss_ratio_curves, false,
+            "Compute LRU miss ratio curves from --trace in one pass");
+DEFINE_string(num_sets, "1", "Set counts to compute curves for (1 = fully "
+              "associative)");
+DEFINE_double(sampling_rate, 1.0, "Fraction of lines sampled for curves");
+DEFINE_uint64(max_sampled_lines, 0,
+              "Bound on lines sampled for curves (0 = no bound)");
+
+// Sweep execution
+DEFINE_uint32(threads, 0, "Worker threads (0 = one per hardware thread)");
+DEFINE_uint64(max_instructions, 0,
+              "Instructions to simulate per configuration (0 = until halt)");
+DEFINE_string(output, "", "CSV file to write results to (default stdout)");
+
+namespace {
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  CHECK(!items.empty()) << "Empty parameter list: " << list;
+  return items;
+}
+
+std::vector<std::size_t> ParseSizes(const std::string& list,
+                                    std::size_t scale = 1) {
+  std::vector<std::size_t> values;
+  for (const std::string& item : SplitList(list)) {
+    values.push_back(std::stoul(item) * scale);
+  }
+  return values;
+}
+
+std::vector<CacheWritePolicy> ParsePolicies(const std::string& list) {
+  std::vector<CacheWritePolicy> policies;
+  for (const std::string& item : SplitList(list)) {
+    CHECK(item == "write_back" || item == "write_through")
+        << "Unknown/Unsupported write policy: " << item;
+    policies.push_back(item == "write_back" ? CacheWritePolicy::WriteBack
+                                            : CacheWritePolicy::WriteThrough);
+  }
+  return policies;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  CHECK(FLAGS_riscv_binary.empty() != FLAGS_trace.empty())
+      << "Exactly one of --riscv_binary and --trace is required";
+
+  Sweep::Ranges ranges;
+  ranges.line_sizes = ParseSizes(FLAGS_cache_line_sizes, sizeof(word_t));
+  ranges.num_lines = ParseSizes(FLAGS_num_cache_lines);
+  ranges.set_associativities = ParseSizes(FLAGS_set_associativities);
+  ranges.cache_latencies = ParseSizes(FLAGS_cache_latencies);
+  ranges.first_word_latencies = ParseSizes(FLAGS_first_word_latencies);
+  ranges.subsequent_word_latencies =
+      ParseSizes(FLAGS_subsequent_word_latencies);
+  ranges.write_policies = ParsePolicies(FLAGS_write_policies);
+  ranges.replacement_policies.clear();
+  for (const std::string& item : SplitList(FLAGS_replacement_policies)) {
+    ranges.replacement_policies.push_back(
+        ReplacementPolicy::TypeFromName(item));
+  }
+
+  std::ofstream output_file;
+  if (!FLAGS_output.empty()) {
+    output_file.open(FLAGS_output);
+    CHECK(output_file.good()) << "Failed to open " << FLAGS_output;
+  }
+  std::ostream& csv = FLAGS_output.empty() ? std::cout : output_file;
+
+  if (FLAGS_miss_ratio_curves) {
+    CHECK(!FLAGS_trace.empty()) << "--miss_ratio_curves requires --trace";
+    const MemoryTrace trace(FLAGS_trace);
+    std::mutex csv_mutex;
+    StackDistance::WriteCsvHeader(csv);
+    WorkStealingPool pool(FLAGS_threads);
+    for (const std::size_t line_size : ranges.line_sizes) {
+      pool.Submit([&, line_size] {
+        StackDistance::Params params;
+        params.line_size = line_size;
+        params.num_sets = ParseSizes(FLAGS_num_sets);
+        params.sampling_rate = FLAGS_sampling_rate;
+        params.max_sampled_lines = FLAGS_max_sampled_lines;
+        StackDistance instr(params);
+        StackDistance data(params);
+        MemoryTrace::Access access;
+        for (auto cursor = trace.Begin(); cursor.Next(access);) {
+          (access.port == MemoryTrace::Port::Instruction ? instr : data)
+              .Access(access.addr);
+        }
+        std::lock_guard<std::mutex> lock(csv_mutex);
+        instr.WriteCsv("instr", csv);
+        data.WriteCsv("data", csv);
+      });
+    }
+    pool.Wait();
+    return 0;
+  }
+
+  if (!FLAGS_trace.empty()) {
+    CacheReplay replay(std::make_shared<MemoryTrace>(FLAGS_trace), ranges);
+    LOG(INFO) << "Replaying " << replay.Configurations().size()
+              << " configurations";
+    replay.Run(FLAGS_threads, csv);
+    return 0;
+  }
+
+  const std::size_t MAX_INSTRUCTIONS{
+      FLAGS_max_instructions == 0 ? std::numeric_limits<std::size_t>::max()
+                                  : FLAGS_max_instructions};
+  Sweep sweep(FLAGS_riscv_binary, ranges, MAX_INSTRUCTIONS);
+  LOG(INFO) << "Sweeping " << sweep.Configurations().size()
+            << " configurations";
+  sweep.Run(FLAGS_threads, csv);
+  return 0;
+}
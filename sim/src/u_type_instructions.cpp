@@ -4,41 +4,37 @@
 UTypeInstructionInterface::UTypeInstructionInterface(instr_t instr,
                                                      RegFilePtr reg_file)
     : InstructionInterface(instr), reg_file_(reg_file) {
-  name_ = "U Type Instruction";
   instruction_type_ = InstructionTypes::UType;
-}
 
-////////////////////////////////////////////////////////////////////////////////
-void UTypeInstructionInterface::Decode() {
   UTypeInstructionFormat u_type_format;
   u_type_format.word = instr_;
 
   const int rd_num = u_type_format.rd;
-  Rd_ = std::make_shared<Register>(Register(rd_num));
-  reg_file_->Read(*Rd_);
+  Rd_ = Register(rd_num);
 
   imm_ = static_cast<uint32_t>(u_type_format.imm31_12);
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void UTypeInstructionInterface::Decode() {
+  reg_file_->Read(Rd_);
   InstructionInterface::Decode();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void UTypeInstructionInterface::Execute() {
-  Rd_->Data() = (imm_ << 12);
   InstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void UTypeInstructionInterface::WriteBack() {
-  reg_file_->Write(*Rd_);
+  reg_file_->Write(Rd_);
   InstructionInterface::WriteBack();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void UTypeInstructionInterface::SetInstructionName() {
-  std::stringstream instruction_stream;
-  instruction_stream << name_ << " x" << Rd_->Number() << ", " << imm_;
-  instruction_ = instruction_stream.str();
+void UTypeInstructionInterface::Disassemble(std::ostream& stream) const {
+  stream << mnemonic_ << " x" << Rd_.Number() << ", " << imm_;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -51,26 +47,24 @@ std::string UTypeInstructionInterface::RegistersString() {
 ////////////////////////////////////////////////////////////////////////////////
 LuiInstruction::LuiInstruction(instr_t instr, RegFilePtr reg_file)
     : UTypeInstructionInterface(instr, reg_file) {
-  name_ = "lui";
+  mnemonic_ = Mnemonic::Lui;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void LuiInstruction::Execute() {
-  Rd_->Data() = imm_;
+  Rd_.Data() = (imm_ << 12);
   UTypeInstructionInterface::Execute();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 AuipcInstruction::AuipcInstruction(instr_t instr, RegFilePtr reg_file, PcPtr pc)
     : UTypeInstructionInterface(instr, reg_file), pc_(pc) {
-  name_ = "auipc";
+  mnemonic_ = Mnemonic::Auipc;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void AuipcInstruction::Execute() {
-  reg_data_t pc_offset = static_cast<reg_data_t>(
-      static_cast<int>(pc_->InstructionPointer()) + static_cast<int>(imm_));
-  VLOG(3) << "Execute: computed pc offset address " << pc_offset;
-  Rd_->Data() = pc_offset;
+  const reg_data_t pc_offset = instr_addr_ + (imm_ << 12);
+  Rd_.Data() = pc_offset;
   UTypeInstructionInterface::Execute();
 }
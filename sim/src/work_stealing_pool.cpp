@@ -0,0 +1,116 @@
+#include <work_stealing_pool.hpp>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace {
+
+// Pool and worker index of the worker running on this thread, if any
+thread_local const void* tls_pool = nullptr;
+thread_local std::size_t tls_worker_index = 0;
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+WorkStealingPool::WorkStealingPool(std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  for (std::size_t ii = 0; ii < num_threads; ++ii) {
+    workers_.emplace_back(new Worker());
+  }
+  for (std::size_t ii = 0; ii < num_threads; ++ii) {
+    threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, ii);
+  }
+  VLOG(1) << "Started work stealing pool with " << num_threads << " threads";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+WorkStealingPool::~WorkStealingPool() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WorkStealingPool::Submit(Task task) {
+  const std::size_t index =
+      (tls_pool == this) ? tls_worker_index
+                         : next_worker_.fetch_add(1) % workers_.size();
+  ++pending_;
+  {
+    // Counted before it is queued so queued_ never drops below zero. Taking
+    // the lock orders this against a worker deciding to sleep.
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++queued_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(std::move(task));
+  }
+  work_available_.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WorkStealingPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  all_done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WorkStealingPool::PopLocal(std::size_t index, Task& task) {
+  Worker& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  --queued_;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WorkStealingPool::Steal(std::size_t thief, Task& task) {
+  for (std::size_t offset = 1; offset < workers_.size(); ++offset) {
+    Worker& victim = *workers_[(thief + offset) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WorkStealingPool::WorkerLoop(std::size_t index) {
+  tls_pool = this;
+  tls_worker_index = index;
+  while (true) {
+    Task task;
+    if (PopLocal(index, task) || Steal(index, task)) {
+      task();
+      if (--pending_ == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_done_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_available_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+    if (stopping_ && queued_ == 0) {
+      return;
+    }
+  }
+}
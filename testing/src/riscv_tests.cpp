@@ -1,4 +1,12 @@
+#include <elf.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -6,14 +14,29 @@
 #include <chrono>
 #include <random>
 
+#include <cache_replay.hpp>
+#include <checkpoint.hpp>
 #include <command_interpreter.hpp>
 #include <commands.hpp>
 #include <cpu.hpp>
+#include <decoded_instruction_cache.hpp>
+#include <elf_loader.hpp>
+#include <event_trace.hpp>
+#include <functional_core.hpp>
 #include <instruction_factory.hpp>
 #include <instructions.hpp>
+#include <jit_translator.hpp>
 #include <memory.hpp>
+#include <memory_trace.hpp>
+#include <prefetcher.hpp>
 #include <r_type_instructions.hpp>
 #include <register_file.hpp>
+#include <replacement_policy.hpp>
+#include <sampler.hpp>
+#include <stack_distance.hpp>
+#include <store_buffer.hpp>
+#include <sweep.hpp>
+#include <work_stealing_pool.hpp>
 
 DEFINE_uint32(cache_line_size, 4, "Cache line size in words");
 DEFINE_uint32(set_associativity, 2, "Set associativity of cache");
@@ -43,6 +66,242 @@ TEST(memory_tests, mem_load_image_test) {
   mem->CoreDump(100);
 }
 
+//
+// Checks a memory spanning the address space only commits the pages that
+// are written, and that clearing it zeroes them
+//
+TEST(memory_tests, sparse_memory_test) {
+  DataMemory mem(0, MainMemoryBase::kAddressSpaceSize);
+  mem.WriteWord(0xfffffffc, 0x12345678);
+  mem.WriteByte(0x10, 0xab);
+  const std::vector<std::size_t> pages = mem.TouchedPages(4096);
+  CHECK(pages.size() == 2) << pages.size();
+  CHECK(pages.front() == 0 && pages.back() == 0xfffff) << pages.back();
+  CHECK(mem.ReadWord(0xfffffffc) == 0x12345678);
+  CHECK(mem.ReadWord(0x80000000) == 0);
+
+  mem.Clear();
+  CHECK(mem.ReadWord(0xfffffffc) == 0);
+  CHECK(mem.ReadByte(0x10) == 0);
+}
+
+//
+// Checks an image is loaded whether or not its last page fits in memory,
+// that writes stay private to the memory, and that clearing drops it
+//
+TEST(memory_tests, image_mapping_test) {
+  const std::string path = "image_mapping_test.bin";
+  std::vector<uint8_t> image(5000);
+  for (std::size_t ii = 0; ii < image.size(); ++ii) {
+    image[ii] = static_cast<uint8_t>(ii * 7 + 1);
+  }
+  {
+    std::ofstream image_stream(path, std::ios::out | std::ios::binary);
+    image_stream.write(reinterpret_cast<const char*>(image.data()),
+                       image.size());
+  }
+
+  // Mapped, then copied as the memory ends inside the image's last page
+  InstructionMemory mapped(path, 0);
+  InstructionMemory copied(path, 0, 5004);
+  for (MainMemoryBase* mem : {static_cast<MainMemoryBase*>(&mapped),
+                              static_cast<MainMemoryBase*>(&copied)}) {
+    CHECK(std::equal(image.cbegin(), image.cend(), mem->Data()));
+    CHECK(mem->ReadWord(5000) == 0);
+    CHECK(mem->TouchedPages(4096).size() >= 2);
+  }
+
+  mapped.WriteWord(0, 0xffffffff);
+  InstructionMemory reloaded(path, 0);
+  std::remove(path.c_str());
+  CHECK(reloaded.ReadWord(0) == 0x160f0801) << reloaded.ReadWord(0);
+
+  mapped.Clear();
+  CHECK(mapped.TouchedPages(4096).empty());
+  CHECK(mapped.ReadWord(0) == 0 && mapped.ReadWord(4096) == 0);
+}
+
+//
+// Checks an ELF executable's segments land at their addresses, with .bss
+// zeroed, and that it starts from its entry point with its symbols kept
+//
+TEST(elf_tests, load_segments_test) {
+  const uint32_t code[] = {0x00500093, 0x00108113};  // addi x1, 5; addi x2
+  const uint32_t data = 0xdeadbeef;
+  const char names[] = "\0_start\0table";
+
+  std::vector<uint8_t> file(324);
+  auto put = [&](std::size_t offset, const void* src, std::size_t size) {
+    std::memcpy(file.data() + offset, src, size);
+  };
+  Elf32_Ehdr header{};
+  std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+  header.e_ident[EI_CLASS] = ELFCLASS32;
+  header.e_ident[EI_DATA] = ELFDATA2LSB;
+  header.e_type = ET_EXEC;
+  header.e_machine = 243;  // EM_RISCV
+  header.e_entry = 0x100;
+  header.e_phoff = sizeof(Elf32_Ehdr);
+  header.e_phentsize = sizeof(Elf32_Phdr);
+  header.e_phnum = 2;
+  header.e_shoff = 204;
+  header.e_shentsize = sizeof(Elf32_Shdr);
+  header.e_shnum = 3;
+  put(0, &header, sizeof(header));
+
+  const Elf32_Phdr text{PT_LOAD, 128, 0x100, 0x100, 8, 8, PF_R | PF_X, 4};
+  const Elf32_Phdr bss{PT_LOAD, 136, 0x2000, 0x2000, 4, 16, PF_R | PF_W, 4};
+  put(52, &text, sizeof(text));
+  put(84, &bss, sizeof(bss));
+  put(128, code, sizeof(code));
+  put(136, &data, sizeof(data));
+  put(140, names, sizeof(names));
+
+  const Elf32_Sym symbols[] = {
+      {},
+      {1, 0x100, 0, ELF32_ST_INFO(STB_GLOBAL, STT_NOTYPE), 0, 1},
+      {8, 0x2000, 16, ELF32_ST_INFO(STB_GLOBAL, STT_OBJECT), 0, 2}};
+  put(156, symbols, sizeof(symbols));
+  const Elf32_Shdr sections[] = {
+      {},
+      {0, SHT_SYMTAB, 0, 0, 156, sizeof(symbols), 2, 1, 4, sizeof(Elf32_Sym)},
+      {0, SHT_STRTAB, 0, 0, 140, sizeof(names), 0, 0, 1, 0}};
+  put(204, sections, sizeof(sections));
+
+  const std::string path = "load_segments_test.out";
+  {
+    std::ofstream elf_stream(path, std::ios::out | std::ios::binary);
+    elf_stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+  }
+
+  DataMemory data_mem(0, 0x4000);
+  data_mem.WriteWord(0x2004, 0xffffffff);
+  mem_addr_t entry_point = 0;
+  MemoryPtr instr_mem =
+      ElfImage::LoadProgram(path, 0, data_mem, entry_point);
+  const ElfImage image(path);
+  std::remove(path.c_str());
+
+  CHECK(entry_point == 0x100) << entry_point;
+  CHECK(instr_mem->ReadWord(0x100) == code[0]);
+  CHECK(instr_mem->ReadWord(0x104) == code[1]);
+  CHECK(data_mem.ReadWord(0x100) == code[0]);
+  CHECK(data_mem.ReadWord(0x2000) == data);
+  CHECK(data_mem.ReadWord(0x2004) == 0) << data_mem.ReadWord(0x2004);
+
+  CHECK(image.Symbols().size() == 2);
+  CHECK(image.SymbolAt(0x100)->name == "_start");
+  CHECK(image.SymbolAt(0x104) == nullptr);
+  CHECK(image.SymbolAt(0x200c)->name == "table");
+  CHECK(image.FindSymbol("table")->size == 16);
+
+  ProgramCounter pc;
+  pc.SetEntryPoint(entry_point);
+  pc.SetInstructionPointer(0x200);
+  pc.Reset();
+  CHECK(pc.InstructionPointer() == 0x100) << pc.InstructionPointer();
+}
+
+//
+// Loads an ELF linked high in the address space and checks its instruction
+// memory only spans the code, while cycle mode, the interpreter and the JIT
+// still run a call and return through it from the entry point
+//
+TEST(elf_tests, high_linked_test) {
+  const uint32_t code[] = {
+      0x00500093,  // addi x1, x0, 5
+      0x00c002ef,  // jal x5, func
+      0x06410113,  // addi x2, x2, 100
+      0x0000006f,  // end: j end
+      0x00700113,  // func: addi x2, x0, 7
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ce3,  // bne x1, x0, func
+      0x00028067,  // jalr x0, 0(x5)
+  };
+  const mem_addr_t kCodeAddr = 0x80000000;
+
+  std::vector<uint8_t> file(sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr) +
+                            sizeof(code));
+  Elf32_Ehdr header{};
+  std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+  header.e_ident[EI_CLASS] = ELFCLASS32;
+  header.e_ident[EI_DATA] = ELFDATA2LSB;
+  header.e_type = ET_EXEC;
+  header.e_machine = 243;  // EM_RISCV
+  header.e_entry = kCodeAddr;
+  header.e_phoff = sizeof(Elf32_Ehdr);
+  header.e_phentsize = sizeof(Elf32_Phdr);
+  header.e_phnum = 1;
+  const Elf32_Phdr text{PT_LOAD,      84,           kCodeAddr,   kCodeAddr,
+                        sizeof(code), sizeof(code), PF_R | PF_X, 4};
+  std::memcpy(file.data(), &header, sizeof(header));
+  std::memcpy(file.data() + 52, &text, sizeof(text));
+  std::memcpy(file.data() + 84, code, sizeof(code));
+
+  const std::string path = "high_linked_test.out";
+  {
+    std::ofstream elf_stream(path, std::ios::out | std::ios::binary);
+    elf_stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+  }
+
+  // Cycle mode, then the interpreter and the JIT
+  for (int run = 0; run < 3; ++run) {
+    auto data_mem = std::make_shared<DataMemory>(
+        DataMemory(0, MainMemoryBase::kAddressSpaceSize));
+    mem_addr_t entry_point = 0;
+    MemoryPtr instr_mem =
+        ElfImage::LoadProgram(path, 0, *data_mem, entry_point);
+    CHECK(entry_point == kCodeAddr) << entry_point;
+    CHECK(instr_mem->GetSize() == InstructionMemory::kDefaultMemSize)
+        << instr_mem->GetSize();
+    CHECK(instr_mem->ReadWord(kCodeAddr + 4) == code[1]);
+    CHECK(data_mem->ReadWord(kCodeAddr + 4) == code[1]);
+
+    CPU cpu(instr_mem, data_mem,
+            run == 0 ? SimulationMode::Cycle : SimulationMode::Functional);
+    cpu.GetPC()->SetEntryPoint(entry_point);
+    cpu.SetJitEnabled(run == 2 && JitTranslator::Supported());
+
+    CHECK(cpu.Run() == FunctionalCore::StopReason::Halt);
+    CHECK(cpu.GetPC()->InstructionPointer() == kCodeAddr + 0xc)
+        << std::hex << cpu.GetPC()->InstructionPointer();
+    CHECK(cpu.GetRegFile()->Read(RegisterFile::Registers::X2) == 107)
+        << "Run " << run << ": "
+        << cpu.GetRegFile()->Read(RegisterFile::Registers::X2);
+    CHECK(cpu.InstructionsCompleted() == 20)
+        << "Run " << run << " retired " << cpu.InstructionsCompleted();
+  }
+  std::remove(path.c_str());
+}
+
+//
+// Checks a line moves to and from main memory as one block on a miss and on
+// a writeback, matching the memory's word accesses
+//
+TEST(memory_tests, block_transfer_test) {
+  auto main_mem = std::make_shared<DataMemory>(DataMemory(10, 256));
+  std::vector<uint8_t> block(64);
+  for (std::size_t ii = 0; ii < block.size(); ++ii) {
+    block[ii] = static_cast<uint8_t>(ii * 3);
+  }
+  main_mem->WriteBlock(64, block.data(), block.size());
+  CHECK(main_mem->ReadWord(64) == 0x09060300) << main_mem->ReadWord(64);
+
+  MemoryPtr cache = std::make_shared<DirectlyMappedCache>(DirectlyMappedCache(
+      main_mem, 64, 2, 1, 1, CacheWritePolicy::WriteBack));
+  CHECK(cache->ReadWord(124) == main_mem->ReadWord(124));
+  // Hit latency, the first word and one subsequent word while the line fills
+  CHECK(cache->GetAccessLatency() == 1 + 10 + 1) << cache->GetAccessLatency();
+  cache->WriteWord(72, 0xdeadbeef);
+  cache->Flush();
+
+  std::vector<uint8_t> read_back(block.size());
+  main_mem->ReadBlock(64, read_back.data(), read_back.size());
+  CHECK(main_mem->ReadWord(72) == 0xdeadbeef);
+  CHECK(std::equal(read_back.cbegin() + 12, read_back.cend(),
+                   block.cbegin() + 12));
+}
+
 TEST(pipeline_tests, addi_test) {
   const std::string addi_test_bin = "asm/addi.bin";
   std::shared_ptr<MemoryBase> mem = std::make_shared<InstructionMemory>(
@@ -56,6 +315,641 @@ TEST(pipeline_tests, addi_test) {
   instr_ptr->ExecuteCycle(0);
 }
 
+TEST(pipeline_tests, decoded_instruction_cache_test) {
+  constexpr instr_t ADDI_X1_X0_24{0x01800093};
+  constexpr instr_t ADD_X2_X1_X1{0x00108133};
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(0));
+  PcPtr pc = std::make_shared<ProgramCounter>(ProgramCounter());
+  RegFilePtr reg_file = std::make_shared<RegisterFile>(RegisterFile());
+  DecodedInstructionCache decoded_cache(reg_file, pc, data_mem);
+
+  // Steady state fetches of the same PC reuse the decoded object
+  const InstructionInterface* first = decoded_cache.Fetch(0x0, ADDI_X1_X0_24);
+  const InstructionInterface* second = decoded_cache.Fetch(0x0, ADDI_X1_X0_24);
+  CHECK(first == second) << "Decoded instruction was not reused";
+  CHECK(decoded_cache.Hits() == 1) << "Expected a decoded cache hit";
+
+  // A different word at the same PC (store into instruction memory) misses
+  InstructionInterface* modified = decoded_cache.Fetch(0x0, ADD_X2_X1_X1);
+  CHECK(modified->GetOpCode() == OpCode::RTypeArithmeticAndLogical)
+      << "Stale decoded instruction returned";
+
+  // An in flight object is never handed out twice
+  modified->EnterPipeline();
+  InstructionInterface* in_flight = decoded_cache.Fetch(0x0, ADD_X2_X1_X1);
+  CHECK(in_flight != modified) << "In flight object reused";
+
+  // Once it leaves the pipeline its copy is pooled again
+  modified->LeavePipeline();
+  CHECK(decoded_cache.Fetch(0x0, ADD_X2_X1_X1) == modified)
+      << "Pooled copy was not reused";
+
+  // Replacing the entry keeps in flight objects alive
+  in_flight->EnterPipeline();
+  decoded_cache.Fetch(0x0, ADDI_X1_X0_24);
+  CHECK(in_flight->GetOpCode() == OpCode::RTypeArithmeticAndLogical);
+  in_flight->LeavePipeline();
+}
+
+//
+// Stalls on a load feeding both sources of the next instruction, which
+// inserts two delays in one cycle, and checks no write back is lost
+//
+TEST(pipeline_tests, load_use_both_sources_test) {
+  const std::vector<instr_t> program = {
+      0x00500093,  // addi x1, x0, 5
+      0x10002403,  // loop: lw x8, 0x100(x0)
+      0x00840533,  // add x10, x8, x8
+      0x00a585b3,  // add x11, x11, x10
+      0xfff08093,  // addi x1, x1, -1
+      0xfe0098e3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(0));
+  for (std::size_t ii = 0; ii < program.size(); ++ii) {
+    instr_mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+  }
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(0));
+  data_mem->WriteWord(0x100, 0x1356);
+
+  CPU cpu(instr_mem, data_mem, SimulationMode::Cycle);
+  CHECK(cpu.Run() == FunctionalCore::StopReason::Halt);
+  RegFilePtr reg_file = cpu.GetRegFile();
+  CHECK(reg_file->Read(RegisterFile::Registers::X8) == 0x1356)
+      << std::hex << reg_file->Read(RegisterFile::Registers::X8);
+  CHECK(reg_file->Read(RegisterFile::Registers::X10) == 0x26ac)
+      << std::hex << reg_file->Read(RegisterFile::Registers::X10);
+  CHECK(reg_file->Read(RegisterFile::Registers::X11) == 5 * 0x26ac)
+      << std::hex << reg_file->Read(RegisterFile::Registers::X11);
+  CHECK(cpu.InstructionsCompleted() == 27) << cpu.InstructionsCompleted();
+  CHECK(cpu.GetCycles() == 49) << cpu.GetCycles();
+}
+
+//
+// Disassembly is formatted on demand from the decoded operands
+//
+TEST(pipeline_tests, disassembly_test) {
+  constexpr instr_t ADDI_X1_X0_24{0x01800093};
+  constexpr instr_t ADD_X2_X1_X1{0x00108133};
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(0));
+  PcPtr pc = std::make_shared<ProgramCounter>(ProgramCounter());
+  RegFilePtr reg_file = std::make_shared<RegisterFile>(RegisterFile());
+  InstructionFactory factory(reg_file, pc, data_mem);
+
+  const InstructionPtr addi = factory.Create(ADDI_X1_X0_24);
+  CHECK(addi->GetMnemonic() == Mnemonic::Addi);
+  CHECK(addi->InstructionName() == "addi x1, x0, 24")
+      << "Unexpected disassembly " << addi->InstructionName();
+
+  const InstructionPtr add = factory.Create(ADD_X2_X1_X1);
+  CHECK(add->GetMnemonic() == Mnemonic::Add);
+  CHECK(add->InstructionName() == "add x2, x1, x1")
+      << "Unexpected disassembly " << add->InstructionName();
+
+  CHECK(NopInstruction().InstructionName() == "nop");
+}
+
+//
+// Runs a small countdown loop on the functional core, first stopping at a
+// breakpoint inside the loop and then running to the jump to self at the end
+//
+TEST(functional_core_tests, countdown_loop_test) {
+  const std::vector<instr_t> program = {
+      0x00500093,  // addi x1, x0, 5
+      0x00310113,  // loop: addi x2, x2, 3
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ce3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(0));
+  for (std::size_t ii = 0; ii < program.size(); ++ii) {
+    mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+  }
+  PcPtr pc = std::make_shared<ProgramCounter>(ProgramCounter());
+  RegFilePtr reg_file = std::make_shared<RegisterFile>(RegisterFile());
+  FunctionalCore core(reg_file, pc, mem, mem);
+
+  core.SetBreakpoint(0x8);
+  CHECK(core.Run() == FunctionalCore::StopReason::Breakpoint);
+  CHECK(pc->InstructionPointer() == 0x8);
+  CHECK(reg_file->Read(RegisterFile::Registers::X2) == 3);
+
+  core.ClearBreakpoint(0x8);
+  CHECK(core.Run() == FunctionalCore::StopReason::Halt);
+  CHECK(pc->InstructionPointer() == 0x10);
+  CHECK(reg_file->Read(RegisterFile::Registers::X1) == 0);
+  CHECK(reg_file->Read(RegisterFile::Registers::X2) == 15);
+  CHECK(core.InstructionsRetired() == 17)
+      << "Retired " << core.InstructionsRetired();
+}
+
+//
+// Runs a loop that patches its own body on the JIT and checks the store drops
+// the stale translation
+//
+TEST(functional_core_tests, jit_self_modifying_code_test) {
+  if (!JitTranslator::Supported()) {
+    return;
+  }
+  const std::vector<instr_t> program = {
+      0x00200093,  // addi x1, x0, 2
+      0x00310113,  // loop: addi x2, x2, 3
+      0x01802203,  // lw x4, 0x18(x0)
+      0x00402223,  // sw x4, 0x4(x0)
+      0xfff08093,  // addi x1, x1, -1
+      0xfe0098e3,  // bne x1, x0, loop
+      0x06410113,  // addi x2, x2, 100
+      0x0000006f,  // end: j end
+  };
+  MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(0));
+  for (std::size_t ii = 0; ii < program.size(); ++ii) {
+    mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+  }
+  PcPtr pc = std::make_shared<ProgramCounter>(ProgramCounter());
+  RegFilePtr reg_file = std::make_shared<RegisterFile>(RegisterFile());
+  FunctionalCore core(reg_file, pc, mem, mem);
+  core.SetJitEnabled(true);
+
+  CHECK(core.Run() == FunctionalCore::StopReason::Halt);
+  CHECK(pc->InstructionPointer() == 0x1c);
+  CHECK(reg_file->Read(RegisterFile::Registers::X2) == 203)
+      << "X2 " << reg_file->Read(RegisterFile::Registers::X2);
+  CHECK(core.InstructionsRetired() == 13)
+      << "Retired " << core.InstructionsRetired();
+}
+
+//
+// Checks stores made straight to the backing store by the interpreter and
+// the JIT flag their pages as written, including both pages of a store
+// straddling them, while reads flag nothing
+//
+TEST(functional_core_tests, written_pages_test) {
+  const std::vector<instr_t> program = {
+      0x000030b7,  // lui x1, 0x3
+      0x00700113,  // addi x2, x0, 7
+      0x0020a023,  // sw x2, 0(x1)
+      0xfe20af23,  // sw x2, -2(x1)
+      0x0050a183,  // lw x3, 5(x1)
+      0x0000006f,  // end: j end
+  };
+  for (const bool jit : {false, true}) {
+    auto mem = std::make_shared<DataMemory>(DataMemory(0, 0x10000));
+    for (std::size_t ii = 0; ii < program.size(); ++ii) {
+      mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+    }
+    mem->ReadWord(0x8000);
+    PcPtr pc = std::make_shared<ProgramCounter>(ProgramCounter());
+    RegFilePtr reg_file = std::make_shared<RegisterFile>(RegisterFile());
+    FunctionalCore core(reg_file, pc, mem, mem);
+    core.SetJitEnabled(jit && JitTranslator::Supported());
+
+    CHECK(core.Run() == FunctionalCore::StopReason::Halt);
+    CHECK(mem->ReadWord(0x2ffe) == 7 && mem->ReadWord(0x3000) == 0);
+    const std::vector<std::size_t> pages = mem->TouchedPages(4096);
+    CHECK((pages == std::vector<std::size_t>{0, 2, 3}))
+        << (jit ? "JIT: " : "Interpreter: ") << pages.size() << " pages";
+  }
+}
+
+//
+// Starts the countdown loop in cycle mode, switches to functional mode part
+// way through and checks both modes agree on the final state
+//
+TEST(cpu_tests, mode_switch_test) {
+  const std::vector<instr_t> program = {
+      0x00500093,  // addi x1, x0, 5
+      0x00310113,  // loop: addi x2, x2, 3
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ce3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(0));
+  for (std::size_t ii = 0; ii < program.size(); ++ii) {
+    instr_mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+  }
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(0));
+
+  for (const auto mode : {SimulationMode::Cycle, SimulationMode::Functional}) {
+    CPU cpu(instr_mem, data_mem, mode);
+    CHECK(cpu.Run(4) == FunctionalCore::StopReason::InstructionLimit);
+    cpu.SetMode(mode == SimulationMode::Cycle ? SimulationMode::Functional
+                                              : SimulationMode::Cycle);
+    CHECK(cpu.Run() == FunctionalCore::StopReason::Halt);
+    CHECK(cpu.GetPC()->InstructionPointer() == 0x10);
+    CHECK(cpu.GetRegFile()->Read(RegisterFile::Registers::X1) == 0);
+    CHECK(cpu.GetRegFile()->Read(RegisterFile::Registers::X2) == 15);
+  }
+}
+
+//
+// Runs a loop with slow memory both by skipping idle cycles and by ticking
+// every cycle, and checks the cycle counts agree
+//
+TEST(cpu_tests, idle_cycle_skip_test) {
+  const std::vector<instr_t> program = {
+      0x0c800093,  // addi x1, x0, 200
+      0x00310113,  // loop: addi x2, x2, 3
+      0x04202023,  // sw x2, 0x40(x0)
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ae3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  std::vector<CpuPtr> cpus;
+  for (std::size_t ii = 0; ii < 2; ++ii) {
+    MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(50));
+    for (std::size_t jj = 0; jj < program.size(); ++jj) {
+      instr_mem->WriteWord(jj * sizeof(instr_t), program[jj]);
+    }
+    MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(50));
+    MemoryPtr instr_cache = std::make_shared<LRUCache>(LRUCache(
+        instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    MemoryPtr data_cache = std::make_shared<LRUCache>(
+        LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    cpus.push_back(std::make_shared<CPU>(CPU(instr_cache, data_cache)));
+  }
+
+  CHECK(cpus[0]->Run(300) == FunctionalCore::StopReason::InstructionLimit);
+  while (cpus[1]->InstructionsCompleted() < 300) {
+    cpus[1]->ExecuteCycle();
+  }
+  CHECK(cpus[0]->GetCycles() == cpus[1]->GetCycles())
+      << cpus[0]->GetCycles() << " != " << cpus[1]->GetCycles();
+  CHECK(cpus[0]->GetRegFile()->Read(RegisterFile::Registers::X2) ==
+        cpus[1]->GetRegFile()->Read(RegisterFile::Registers::X2));
+}
+
+//
+// Samples a longer countdown loop through caches and checks the program still
+// completes with the right result and every instruction accounted for
+//
+TEST(sampler_tests, countdown_sampling_test) {
+  const std::vector<instr_t> program = {
+      0x0c800093,  // addi x1, x0, 200
+      0x00310113,  // loop: addi x2, x2, 3
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ce3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+  for (std::size_t ii = 0; ii < program.size(); ++ii) {
+    instr_mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+  }
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  MemoryPtr instr_cache = std::make_shared<LRUCache>(LRUCache(
+      instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  MemoryPtr data_cache = std::make_shared<LRUCache>(
+      LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  CpuPtr cpu = std::make_shared<CPU>(CPU(instr_cache, data_cache));
+
+  Sampler::Params params;
+  params.fast_forward = 50;
+  params.warm_up = 10;
+  params.detailed = 20;
+  Sampler sampler(cpu, params);
+  const Sampler::Results results = sampler.Run();
+
+  CHECK(results.stop_reason == FunctionalCore::StopReason::Halt);
+  CHECK(results.num_samples > 1);
+  CHECK(results.mean_cpi >= 1.0) << "CPI: " << results.mean_cpi;
+  CHECK(results.total_instructions == 602)
+      << "Instructions: " << results.total_instructions;
+  CHECK(cpu->GetRegFile()->Read(RegisterFile::Registers::X2) == 600);
+}
+
+//
+// Checkpoints a looping program part way through in cycle mode, restores it
+// into a fresh CPU and checks both finish in exactly the same state
+//
+TEST(checkpoint_tests, save_restore_test) {
+  const std::vector<instr_t> program = {
+      0x0c800093,  // addi x1, x0, 200
+      0x00310113,  // loop: addi x2, x2, 3
+      0x04202023,  // sw x2, 0x40(x0)
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ae3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  const auto make_cpu = [&](MemoryPtr data_mem) {
+    MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+    for (std::size_t ii = 0; ii < program.size(); ++ii) {
+      instr_mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+    }
+    MemoryPtr instr_cache = std::make_shared<LRUCache>(LRUCache(
+        instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    MemoryPtr data_cache = std::make_shared<LRUCache>(
+        LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    return std::make_shared<CPU>(CPU(instr_cache, data_cache));
+  };
+  const std::string path = "save_restore_test.ckpt";
+
+  MemoryPtr saved_data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  CpuPtr saved_cpu = make_cpu(saved_data_mem);
+  CHECK(saved_cpu->Run(301) == FunctionalCore::StopReason::InstructionLimit);
+  Checkpoint::Save(*saved_cpu, path);
+  CHECK(saved_cpu->Run() == FunctionalCore::StopReason::Halt);
+  saved_cpu->SetMode(SimulationMode::Functional);
+
+  MemoryPtr restored_data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  CpuPtr restored_cpu = make_cpu(restored_data_mem);
+  Checkpoint::Restore(*restored_cpu, path);
+  std::remove(path.c_str());
+  CHECK(restored_cpu->Run() == FunctionalCore::StopReason::Halt);
+  restored_cpu->SetMode(SimulationMode::Functional);
+
+  CHECK(restored_cpu->GetCycles() == saved_cpu->GetCycles())
+      << restored_cpu->GetCycles() << " != " << saved_cpu->GetCycles();
+  CHECK(restored_cpu->InstructionsCompleted() ==
+        saved_cpu->InstructionsCompleted());
+  CHECK(restored_cpu->GetPC()->InstructionPointer() == 0x14);
+  CHECK(restored_cpu->GetRegFile()->Read(RegisterFile::Registers::X2) == 600);
+  CHECK(restored_data_mem->ReadWord(0x40) == 600);
+  CHECK(saved_data_mem->ReadWord(0x40) == 600);
+}
+
+//
+// Prefetches a line into a cache's prefetch buffer after a checkpoint is
+// saved and checks restoring the checkpoint drops it, so the line is read
+// again from the restored memory
+//
+TEST(checkpoint_tests, restore_prefetch_buffer_test) {
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+  instr_mem->WriteWord(0, 0x0000006f);  // end: j end
+  MemoryPtr instr_cache = std::make_shared<LRUCache>(
+      LRUCache(instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  auto data_cache = std::make_shared<LRUCache>(
+      LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  Prefetcher::Params params;
+  params.line_size = 16;
+  data_cache->SetPrefetcher(
+      Prefetcher::Create(PrefetcherType::NextLine, params),
+      PrefetchTarget::Buffer, 2);
+  CPU cpu(instr_cache, data_cache);
+  const std::string path = "restore_prefetch_buffer_test.ckpt";
+  Checkpoint::Save(cpu, path);
+
+  data_mem->WriteWord(0x10, 5);
+  data_cache->ReadWord(0);
+  data_cache->SkipCycles(20);
+  CHECK(data_cache->GetPrefetches() == 1);
+
+  Checkpoint::Restore(cpu, path);
+  std::remove(path.c_str());
+  CHECK(data_mem->ReadWord(0x10) == 0);
+  CHECK(data_cache->ReadWord(0x10) == 0) << data_cache->ReadWord(0x10);
+  CHECK(data_cache->GetUsefulPrefetches() == 0);
+}
+
+//
+// Misses in a non-blocking cache with one MSHR after a checkpoint is saved
+// and checks the restored cache has it free again for the next miss
+//
+TEST(checkpoint_tests, restore_mshr_test) {
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+  instr_mem->WriteWord(0, 0x0000006f);  // end: j end
+  MemoryPtr instr_cache = std::make_shared<LRUCache>(
+      LRUCache(instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  auto data_cache = std::make_shared<LRUCache>(
+      LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  data_cache->SetMSHRs(1);
+  CPU cpu(instr_cache, data_cache);
+  const std::string path = "restore_mshr_test.ckpt";
+  Checkpoint::Save(cpu, path);
+
+  data_cache->ReadWord(0x40);
+  CHECK(data_cache->GetDataLatency() == 12) << data_cache->GetDataLatency();
+
+  Checkpoint::Restore(cpu, path);
+  std::remove(path.c_str());
+  CHECK(data_cache->GetDataLatency() == 0);
+  data_cache->ReadWord(0x80);
+  CHECK(data_cache->GetMSHRStalls() == 0 &&
+        data_cache->GetAccessLatency() == 1 &&
+        data_cache->GetDataLatency() == 12)
+      << data_cache->GetAccessLatency() << " "
+      << data_cache->GetDataLatency();
+}
+
+//
+// Buffers a store after a checkpoint is saved and checks restoring the
+// checkpoint drops it instead of forwarding it or writing it back later
+//
+TEST(checkpoint_tests, restore_store_buffer_test) {
+  MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+  instr_mem->WriteWord(0, 0x0000006f);  // end: j end
+  MemoryPtr instr_cache = std::make_shared<LRUCache>(
+      LRUCache(instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(10));
+  MemoryPtr data_cache = std::make_shared<LRUCache>(
+      LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+  auto store_buffer = std::make_shared<StoreBuffer>(data_cache, 2, 16);
+  CPU cpu(instr_cache, store_buffer);
+  const std::string path = "restore_store_buffer_test.ckpt";
+  Checkpoint::Save(cpu, path);
+
+  store_buffer->WriteWord(0x40, 0x1234);
+  CHECK(store_buffer->ReadWord(0x40) == 0x1234);
+
+  Checkpoint::Restore(cpu, path);
+  std::remove(path.c_str());
+  CHECK(store_buffer->ReadWord(0x40) == 0) << store_buffer->ReadWord(0x40);
+  CHECK(store_buffer->CyclesUntilEvent() == data_cache->CyclesUntilEvent());
+  store_buffer->Flush();
+  CHECK(data_mem->ReadWord(0x40) == 0) << data_mem->ReadWord(0x40);
+}
+
+//
+// Sweeps a countdown loop over several cache geometries on a work stealing
+// pool and checks every valid configuration ran to completion with one row
+//
+TEST(sweep_tests, countdown_sweep_test) {
+  const std::vector<instr_t> program = {
+      0x0c800093,  // addi x1, x0, 200
+      0x00310113,  // loop: addi x2, x2, 3
+      0x04202023,  // sw x2, 0x40(x0)
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ae3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  const std::string path = "countdown_sweep_test.bin";
+  {
+    std::ofstream image(path, std::ios::out | std::ios::binary);
+    image.write(reinterpret_cast<const char*>(program.data()),
+                program.size() * sizeof(instr_t));
+  }
+
+  Sweep::Ranges ranges;
+  ranges.line_sizes = {8, 16};
+  ranges.num_lines = {4, 8, 6};  // 6 lines only divide into 2 sets of 3
+  ranges.set_associativities = {1, 2, 3};
+  ranges.cache_latencies = {1};
+  ranges.first_word_latencies = {10};
+  ranges.subsequent_word_latencies = {1};
+  ranges.write_policies = {CacheWritePolicy::WriteBack,
+                           CacheWritePolicy::WriteThrough};
+  Sweep sweep(path, ranges);
+  CHECK(sweep.Configurations().size() == 2 * 5 * 2)
+      << sweep.Configurations().size();
+
+  std::stringstream csv;
+  const std::vector<Sweep::Result> results = sweep.Run(3, csv);
+  std::remove(path.c_str());
+
+  CHECK(results.size() == sweep.Configurations().size());
+  for (const Sweep::Result& result : results) {
+    CHECK(result.stop_reason == FunctionalCore::StopReason::Halt);
+    CHECK(result.instructions == results.front().instructions);
+    CHECK(result.cpi >= 1.0) << "CPI: " << result.cpi;
+  }
+  const std::string rows = csv.str();
+  CHECK(std::count(rows.begin(), rows.end(), '\n') ==
+        static_cast<long>(results.size() + 1));
+}
+
+//
+// Records the accesses of a cycle accurate run and checks replaying them
+// through the same cache configuration gives the same hits, misses and
+// latencies without a CPU
+//
+TEST(sweep_tests, trace_replay_test) {
+  const std::vector<instr_t> program = {
+      0x0c800093,  // addi x1, x0, 200
+      0x00310113,  // loop: addi x2, x2, 3
+      0x04202023,  // sw x2, 0x40(x0)
+      0xfff08093,  // addi x1, x1, -1
+      0xfe009ae3,  // bne x1, x0, loop
+      0x0000006f,  // end: j end
+  };
+  const std::string path = "trace_replay_test.trace";
+  Sweep::Config config;
+  config.line_size = 16;
+  config.num_lines = 4;
+  config.set_associativity = 2;
+  config.cache_latency = 1;
+  config.first_word_latency = 10;
+  config.subsequent_word_latency = 1;
+
+  std::shared_ptr<CacheBase> instr_cache;
+  std::shared_ptr<CacheBase> data_cache;
+  std::size_t instr_latency = 0;
+  std::size_t data_latency = 0;
+  {
+    MemoryPtr instr_mem = std::make_shared<DataMemory>(DataMemory(10));
+    for (std::size_t ii = 0; ii < program.size(); ++ii) {
+      instr_mem->WriteWord(ii * sizeof(instr_t), program[ii]);
+    }
+    MemoryPtr data_mem = std::make_shared<DataMemory>(DataMemory(10));
+    instr_cache = std::make_shared<LRUCache>(LRUCache(
+        instr_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    data_cache = std::make_shared<LRUCache>(
+        LRUCache(data_mem, 16, 4, 2, 1, 1, CacheWritePolicy::WriteBack));
+    MemoryTrace::WriterPtr writer =
+        std::make_shared<MemoryTrace::Writer>(path);
+    auto instr_tracer = std::make_shared<TracingMemory>(
+        instr_cache, MemoryTrace::Port::Instruction, writer);
+    auto data_tracer = std::make_shared<TracingMemory>(
+        data_cache, MemoryTrace::Port::Data, writer);
+    CPU cpu(instr_tracer, data_tracer);
+    CHECK(cpu.Run() == FunctionalCore::StopReason::Halt);
+    instr_latency = instr_tracer->GetTotalLatency();
+    data_latency = data_tracer->GetTotalLatency();
+  }
+
+  const MemoryTrace trace(path);
+  std::remove(path.c_str());
+  const CacheReplay::Result result =
+      CacheReplay::ReplayConfiguration(trace, config);
+  CHECK(result.instr.accesses + result.data.accesses == trace.NumAccesses());
+  CHECK(result.data.accesses == 200) << result.data.accesses;
+  CHECK(result.instr.hits == instr_cache->GetHits());
+  CHECK(result.instr.misses == instr_cache->GetMisses());
+  CHECK(result.data.hits == data_cache->GetHits());
+  CHECK(result.data.misses == data_cache->GetMisses());
+  CHECK(result.instr.latency == instr_latency)
+      << result.instr.latency << " != " << instr_latency;
+  CHECK(result.data.latency == data_latency)
+      << result.data.latency << " != " << data_latency;
+}
+
+//
+// Records events past the end of the ring, then checks the dump keeps only
+// the newest records, oldest first, and decodes instruction words
+//
+TEST(trace_tests, event_ring_test) {
+  const std::string path = "event_ring_test.evt";
+  Tracer::Clear();
+  Tracer::Record(TraceCategory::Cache, TraceEvent::CacheMiss, 0, 0x40, 1);
+  for (std::size_t cycle = 1; cycle < Tracer::kRingSize; ++cycle) {
+    Tracer::Record(TraceCategory::Hazard, TraceEvent::Forward, cycle, 0x8, 2);
+  }
+  Tracer::Record(TraceCategory::Fetch, TraceEvent::Retire, Tracer::kRingSize,
+                 0x4, 0x01800093);
+  Tracer::Dump(path);
+  Tracer::Clear();
+
+  std::stringstream decoded;
+  Tracer::Decode(path, decoded);
+  std::remove(path.c_str());
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(decoded, line);) {
+    lines.push_back(line);
+  }
+  CHECK(lines.size() == Tracer::kRingSize + 1) << lines.size();
+  CHECK(lines.front().find("thread") == 0) << lines.front();
+  CHECK(lines[1].find("forward") != std::string::npos) << lines[1];
+  CHECK(lines.back().find("retire") != std::string::npos) << lines.back();
+  CHECK(lines.back().find("addi x1, x0, 24") != std::string::npos)
+      << lines.back();
+}
+
+//
+// Checks single pass stack distance miss ratios match fully associative LRU
+// caches of each size fed the same stream, and that bounded sampling lowers
+// its rate as the line count grows
+//
+TEST(stack_distance_tests, fully_associative_miss_ratio_test) {
+  std::vector<mem_addr_t> addrs;
+  uint32_t state = 12345;
+  for (std::size_t ii = 0; ii < 4000; ++ii) {
+    state = state * 1103515245 + 12345;
+    // Mostly a small hot region with occasional wider accesses
+    const uint32_t range = ((state >> 28) % 4 == 0) ? 1024 : 128;
+    addrs.push_back((state >> 8) % range & ~0x3u);
+  }
+
+  StackDistance::Params params;
+  params.line_size = 16;
+  StackDistance stack_distance(params);
+  for (const mem_addr_t addr : addrs) {
+    stack_distance.Access(addr);
+  }
+
+  for (const std::size_t ways : {1, 2, 4, 8, 16}) {
+    MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10));
+    LRUCache cache(mem, 16, ways, ways, 1, 1, CacheWritePolicy::WriteBack);
+    for (const mem_addr_t addr : addrs) {
+      cache.ExecuteCycle();
+      cache.ReadWord(addr);
+    }
+    const double expected = static_cast<double>(cache.GetMisses()) /
+                            static_cast<double>(addrs.size());
+    const double miss_ratio = stack_distance.MissRatio(1, ways);
+    CHECK(std::abs(miss_ratio - expected) < 1e-9)
+        << ways << " ways: " << miss_ratio << " != " << expected;
+  }
+
+  params.max_sampled_lines = 16;
+  StackDistance sampled(params);
+  for (const mem_addr_t addr : addrs) {
+    sampled.Access(addr);
+  }
+  CHECK(sampled.SamplingRate() < 1.0);
+  for (const StackDistance::CurvePoint& point : sampled.MissRatioCurve()) {
+    CHECK(point.miss_ratio >= 0.0 && point.miss_ratio <= 1.0);
+  }
+}
+
 //
 // Tests directly_mapped_cache implementation by filling memory, reading values
 // through cache, writing new values to cache, and then checking memory
@@ -271,6 +1165,299 @@ TEST(cache_tests, write_through_test) {
   }
 }
 
+//
+// Checks a unified L2 under two L1 caches: misses pay for both levels, an
+// inclusive L2 invalidates lines above it and an exclusive one hands lines up
+//
+TEST(cache_tests, l2_inclusion_test) {
+  for (const InclusionPolicy policy :
+       {InclusionPolicy::Inclusive, InclusionPolicy::Exclusive}) {
+    auto main_mem = std::make_shared<DataMemory>(DataMemory(10, 4096));
+    auto l2 = std::make_shared<DirectlyMappedCache>(DirectlyMappedCache(
+        main_mem, 16, 8, 4, 0, CacheWritePolicy::WriteBack));
+    auto l1_instr = std::make_shared<DirectlyMappedCache>(DirectlyMappedCache(
+        l2, 16, 2, 1, 0, CacheWritePolicy::WriteBack));
+    auto l1_data = std::make_shared<DirectlyMappedCache>(DirectlyMappedCache(
+        l2, 16, 2, 1, 0, CacheWritePolicy::WriteBack));
+    l2->SetInclusionPolicy(policy);
+    l2->AddUpperLevel(l1_instr);
+    l2->AddUpperLevel(l1_data);
+
+    l1_data->ReadWord(0x00);
+    CHECK(l1_data->GetAccessLatency() == 1 + 4 + 10)
+        << l1_data->GetAccessLatency();
+    l1_data->WriteWord(0x10, 0x12345678);
+
+    if (policy == InclusionPolicy::Inclusive) {
+      // 0x80 shares an L2 line with 0x00, taking it from the data cache
+      l1_instr->ReadWord(0x80);
+      CHECK(l1_data->GetBackInvalidations() == 1);
+      l1_data->ReadWord(0x00);
+      CHECK(l1_data->GetAccessLatency() == 1 + 4 + 10);
+      // The dirty line at 0x10 is merged on its way out of the L2
+      l1_instr->ReadWord(0x90);
+      CHECK(main_mem->ReadWord(0x10) == 0x12345678);
+      CHECK(l2->GetHits() == 0 && l2->GetMisses() == 5)
+          << l2->GetHits() << " " << l2->GetMisses();
+    } else {
+      // The data cache's victims fill the L2, which hands them back up
+      l1_data->ReadWord(0x30);
+      CHECK(l1_instr->ReadWord(0x10) == 0x12345678);
+      CHECK(l1_instr->GetAccessLatency() == 1 + 4)
+          << l1_instr->GetAccessLatency();
+      CHECK(main_mem->ReadWord(0x10) == 0x12345678);
+      l1_data->ReadWord(0x10);
+      CHECK(l2->GetHits() == 1 && l2->GetMisses() == 4)
+          << l2->GetHits() << " " << l2->GetMisses();
+    }
+  }
+}
+
+//
+// Checks that each replacement policy evicts its own victim from the indexed
+// set only, after filling a 4 way set and then hitting on its first line
+//
+TEST(cache_tests, replacement_policy_test) {
+  const std::map<ReplacementPolicyType, mem_addr_t> victims{
+      {ReplacementPolicyType::LRU, 0x20},
+      {ReplacementPolicyType::TreePLRU, 0x40},
+      {ReplacementPolicyType::SRRIP, 0x20},
+      {ReplacementPolicyType::BRRIP, 0x20},
+      {ReplacementPolicyType::FIFO, 0x00}};
+  for (const auto& victim : victims) {
+    MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10));
+    // Two indices of 4 ways, 0x10 being the only line at index 1
+    SetAssociativeCache cache(mem, 16, 8, 4, 1, 1,
+                              CacheWritePolicy::WriteBack, victim.first);
+    for (const mem_addr_t addr : {0x10, 0x00, 0x20, 0x40, 0x60, 0x00}) {
+      cache.ReadWord(addr);
+    }
+    CHECK(cache.GetMisses() == 5 && cache.GetHits() == 1);
+    cache.ReadWord(0x80);
+
+    for (const mem_addr_t addr : {0x10, 0x00, 0x20, 0x40, 0x60, 0x80}) {
+      const std::size_t misses = cache.GetMisses();
+      if (addr != victim.second) {
+        cache.ReadWord(addr);
+        CHECK(cache.GetMisses() == misses)
+            << ReplacementPolicy::TypeName(victim.first) << " evicted "
+            << std::hex << addr;
+      }
+    }
+    cache.ReadWord(victim.second);
+    CHECK(cache.GetMisses() == 7)
+        << ReplacementPolicy::TypeName(victim.first) << " kept " << std::hex
+        << victim.second;
+  }
+}
+
+//
+// Checks next line, stride and stream prefetchers and their counters: a
+// sequential sweep only misses once, a prefetch demanded before it arrives is
+// late, and stream buffers hand lines to the cache only when demanded
+//
+TEST(cache_tests, prefetcher_test) {
+  Prefetcher::Params params;
+  params.line_size = 16;
+  auto make_cache = [] {
+    MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10, 4096));
+    return std::make_shared<LRUCache>(
+        LRUCache(mem, 16, 8, 2, 1, 1, CacheWritePolicy::WriteBack));
+  };
+
+  auto cache = make_cache();
+  cache->SetPrefetcher(
+      Prefetcher::Create(PrefetcherType::NextLine, params));
+  for (mem_addr_t addr = 0; addr < 0x100; addr += sizeof(word_t)) {
+    cache->ReadWord(addr);
+    cache->SkipCycles(20);
+  }
+  CHECK(cache->GetMisses() == 1 && cache->GetUsefulPrefetches() == 15 &&
+        cache->GetPrefetches() == 16 && cache->GetLatePrefetches() == 0)
+      << cache->GetMisses() << " " << cache->GetUsefulPrefetches() << " "
+      << cache->GetPrefetches() << " " << cache->GetLatePrefetches();
+  cache->ReadWord(0x100);
+  cache->ReadWord(0x110);
+  CHECK(cache->GetLatePrefetches() == 1);
+  CHECK(cache->GetAccessLatency() > 1) << cache->GetAccessLatency();
+
+  cache = make_cache();
+  cache->SetPrefetcher(Prefetcher::Create(PrefetcherType::Stride, params));
+  cache->SetRequestPC(0x40);
+  for (mem_addr_t addr = 0; addr < 0x100; addr += 0x40) {
+    cache->ReadWord(addr);
+    cache->SkipCycles(20);
+  }
+  CHECK(cache->GetPrefetches() == 1 && cache->GetMisses() == 4);
+  // Other instructions keep their own strides
+  cache->SetRequestPC(0x44);
+  cache->ReadWord(0x300);
+  cache->SetRequestPC(0x40);
+  cache->ReadWord(0x100);
+  CHECK(cache->GetUsefulPrefetches() == 1 && cache->GetMisses() == 5);
+
+  params.degree = 2;
+  cache = make_cache();
+  cache->SetPrefetcher(Prefetcher::Create(PrefetcherType::Stream, params),
+                       PrefetchTarget::Buffer, 2);
+  cache->ReadWord(0x200);
+  cache->SkipCycles(20);
+  CHECK(cache->GetPrefetches() == 2 && cache->GetHits() == 0);
+  cache->ReadWord(0x210);
+  CHECK(cache->GetHits() == 1 && cache->GetUsefulPrefetches() == 1);
+  // The stream advances, fetching 0x230 into the slot 0x210 left
+  CHECK(cache->GetPrefetches() == 3);
+  cache->ReadWord(0x220);
+  cache->ReadWord(0x230);
+  CHECK(cache->GetMisses() == 1 && cache->GetUsefulPrefetches() == 3);
+}
+
+//
+// Checks that a non-blocking cache completes misses at the hit latency while
+// their data arrives later, merges accesses to lines on the way and waits
+// for an MSHR only once all are busy
+//
+TEST(cache_tests, mshr_test) {
+  MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10, 4096));
+  auto cache = std::make_shared<LRUCache>(
+      LRUCache(mem, 16, 8, 2, 1, 1, CacheWritePolicy::WriteBack));
+  cache->SetMSHRs(2);
+
+  cache->WriteWord(0x04, 0xdeadbeef);
+  CHECK(cache->GetAccessLatency() == 1 && cache->GetDataLatency() == 12)
+      << cache->GetAccessLatency() << " " << cache->GetDataLatency();
+  CHECK(cache->ReadWord(0x04) == 0xdeadbeef);
+  CHECK(cache->GetAccessLatency() == 1 && cache->GetDataLatency() == 12);
+  CHECK(cache->GetMSHRMerges() == 1 && cache->GetMisses() == 1);
+
+  // Hit under both misses
+  cache->ReadWord(0x40);
+  cache->ExecuteCycle();
+  cache->ReadWord(0x44);
+  CHECK(cache->GetDataLatency() == 11);
+  cache->ReadWord(0x90);
+  CHECK(cache->GetMSHRStalls() == 1 && cache->GetAccessLatency() == 10)
+      << cache->GetAccessLatency();
+  CHECK(cache->GetDataLatency() == 21) << cache->GetDataLatency();
+
+  cache->SkipCycles(100);
+  CHECK(cache->ReadWord(0x04) == 0xdeadbeef);
+  CHECK(cache->GetAccessLatency() == 1 && cache->GetDataLatency() == 1);
+  CHECK(cache->GetMisses() == 3 && cache->GetMSHRMerges() == 2);
+}
+
+//
+// Checks that a store buffer coalesces stores by line, forwards them to loads,
+// makes stores wait only once full and drains everything on a flush
+//
+TEST(cache_tests, store_buffer_test) {
+  MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10, 4096));
+  MemoryPtr cache = std::make_shared<LRUCache>(
+      LRUCache(mem, 16, 8, 2, 1, 1, CacheWritePolicy::WriteThrough));
+  auto store_buffer = std::make_shared<StoreBuffer>(cache, 2, 16);
+
+  store_buffer->WriteWord(0x100, 0x11223344);
+  CHECK(store_buffer->GetAccessLatency() == 1);
+  store_buffer->WriteHalfWord(0x104, 0x5566);
+  CHECK(store_buffer->GetCoalescedStores() == 1);
+  CHECK(store_buffer->ReadWord(0x100) == 0x11223344);
+  CHECK(store_buffer->GetForwardedLoads() == 1 &&
+        store_buffer->GetAccessLatency() == 1);
+  // Bytes not buffered come from the cache
+  CHECK(store_buffer->ReadWord(0x104) == 0x5566);
+  CHECK(store_buffer->GetForwardedLoads() == 1 &&
+        store_buffer->GetAccessLatency() > 1);
+
+  store_buffer->WriteWord(0x200, 1);
+  CHECK(store_buffer->GetFullStalls() == 0);
+  store_buffer->WriteWord(0x300, 2);
+  CHECK(store_buffer->GetFullStalls() == 1 &&
+        store_buffer->GetAccessLatency() > 1);
+  CHECK(mem->ReadWord(0x100) == 0x11223344 && mem->ReadWord(0x200) == 0);
+
+  store_buffer->Flush();
+  CHECK(mem->ReadWord(0x104) == 0x5566 && mem->ReadWord(0x200) == 1 &&
+        mem->ReadWord(0x300) == 2);
+  CHECK(store_buffer->GetStores() == 4);
+
+  // Write through caches pass whole words on
+  cache->WriteWord(0x400, 0xdeadbeef);
+  CHECK(mem->ReadWord(0x400) == 0xdeadbeef);
+}
+
+//
+// Checks lazily derived line fill progress charges what per-cycle swap-in
+// counters did: a full miss, then the subsequent word latency on every access
+// until all 4 words * 2 cycles of the line have had time to arrive
+//
+TEST(cache_tests, line_fill_timing_test) {
+  MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(10, 4096));
+  MemoryPtr cache = std::make_shared<DirectlyMappedCache>(
+      DirectlyMappedCache(mem, 16, 4, 1, 2, CacheWritePolicy::WriteBack));
+
+  cache->ReadWord(0x00);
+  CHECK(cache->GetAccessLatency() == 13) << cache->GetAccessLatency();
+  for (std::size_t cycle = 1; cycle <= 10; ++cycle) {
+    cache->ExecuteCycle();
+    cache->ReadWord((cycle % 4) * sizeof(word_t));
+    const std::size_t expected = (cycle < 8) ? 3 : 1;
+    CHECK(cache->GetAccessLatency() == expected)
+        << "cycle " << cycle << ": " << cache->GetAccessLatency();
+  }
+
+  // Skipped cycles count like executed ones, and a refill starts over
+  cache->ReadWord(0x40);
+  CHECK(cache->GetAccessLatency() == 13) << cache->GetAccessLatency();
+  cache->SkipCycles(7);
+  cache->ReadWord(0x4c);
+  CHECK(cache->GetAccessLatency() == 3) << cache->GetAccessLatency();
+  cache->SkipCycles(1);
+  cache->ReadWord(0x48);
+  CHECK(cache->GetAccessLatency() == 1) << cache->GetAccessLatency();
+  cache->ReadWord(0x00);
+  CHECK(cache->GetAccessLatency() == 13) << cache->GetAccessLatency();
+}
+
+//
+// Checks tag probes of the last index, which read past its sets into the
+// padding, and of the index before it, whose lanes past its sets see the
+// last index's tags, for ways below and not a multiple of the lane count
+//
+TEST(cache_tests, tag_probe_test) {
+  constexpr std::size_t kLineSize{16};
+  constexpr std::size_t kIndices{4};
+  // Addresses kTagStride apart share an index but not a tag
+  constexpr mem_addr_t kTagStride{kLineSize * kIndices};
+  constexpr mem_addr_t kLastIndex{(kIndices - 1) * kLineSize};
+  for (const std::size_t ways : {1, 2, 3, 5, 9}) {
+    MemoryPtr mem = std::make_shared<DataMemory>(DataMemory(0, 4096));
+    SetAssociativeCache cache(mem, kLineSize, kIndices * ways, ways, 1, 0,
+                              CacheWritePolicy::WriteBack,
+                              ReplacementPolicyType::LRU);
+    // Both indices hold the same tags
+    for (std::size_t way = 0; way < ways; ++way) {
+      mem->WriteWord(kLastIndex + way * kTagStride, way + 1);
+      cache.ReadWord(kLastIndex + way * kTagStride);
+      cache.ReadWord(kLastIndex - kLineSize + way * kTagStride);
+    }
+    CHECK(cache.GetMisses() == 2 * ways && cache.GetHits() == 0);
+    for (std::size_t way = 0; way < ways; ++way) {
+      CHECK(cache.ReadWord(kLastIndex + way * kTagStride) == way + 1);
+    }
+    CHECK(cache.GetHits() == ways) << ways << " ways: " << cache.GetHits();
+
+    // Misses in the full last index evict one of its own sets
+    mem->WriteWord(kLastIndex + ways * kTagStride, 0xabcd);
+    CHECK(cache.ReadWord(kLastIndex + ways * kTagStride) == 0xabcd);
+    CHECK(cache.GetMisses() == 2 * ways + 1) << ways << " ways";
+    CHECK(cache.ReadWord(kLastIndex + ways * kTagStride) == 0xabcd);
+    CHECK(cache.GetHits() == ways + 1) << ways << " ways";
+    // The tag just placed in the last index is not in the one before
+    cache.ReadWord(kLastIndex - kLineSize + ways * kTagStride);
+    CHECK(cache.GetMisses() == 2 * ways + 2) << ways << " ways";
+  }
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   google::ParseCommandLineFlags(&argc, &argv, true);